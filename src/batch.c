@@ -0,0 +1,544 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include "batch.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define PARALLEL_BATCH
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
+#include "redirect.h"
+
+// バッチ実行(-batch)
+//   マニフェストファイルに1行ずつ書かれたコマンドラインを、同じプロセス内で
+//   順に実行する。ジョブごとにマシンの状態は初期化される。
+//   Windows以外では、マシンを作成した後でワーカープロセスを複数forkし、
+//   各ワーカーが共有メモリ上のカウンタから次のジョブを取って実行する。
+//   カレントディレクトリと標準入出力はプロセス単位なので、スレッドではなく
+//   プロセスで並列化している。ワーカーは終了するまで同じマシンを使い回す。
+//
+//   行の書式：
+//     [cwd=<dir>] [stdin=<file>] [stdout=<file>] [stderr=<file>]
+//     [env=<NAME=VALUE>]... [--] [run68のオプション] <実行ファイル> [引数]...
+//   空行と#で始まる行は無視する。空白を含む引数は"で囲む。
+//   ファイル名はcwdで指定したディレクトリからの相対パスになる。
+//
+//   サマリファイルにはジョブごとに行番号、終了コード、経過時間、CPU時間
+//   (秒)をマニフェストの順に出力する。
+
+#define MAX_LINE 4096
+#define MAX_ARGS 256
+#define MAX_ENVS 64
+
+typedef struct {
+  const char* cwd;
+  const char* stdinPath;
+  const char* stdoutPath;
+  const char* stderrPath;
+  const char* env[MAX_ENVS + 1];
+  int envCount;
+  char* argv[MAX_ARGS + 1];
+  int argc;
+} Job;
+
+// 行を空白で区切って引数に分ける。
+//   "で囲まれた部分は空白も引数に含める("は取り除く)。
+//   戻り値は引数の数(-1 = 多すぎる)。
+static int splitLine(char* line, char** tokens, int max) {
+  int count = 0;
+  char* p = line;
+
+  for (;;) {
+    while (*p == ' ' || *p == '\t') p += 1;
+    if (*p == '\0') break;
+    if (count >= max) return -1;
+
+    char* dst = p;
+    tokens[count++] = dst;
+    bool quoted = false;
+    for (; *p; p += 1) {
+      if (*p == '"') {
+        quoted = !quoted;
+        continue;
+      }
+      if (!quoted && (*p == ' ' || *p == '\t')) {
+        p += 1;
+        break;
+      }
+      *dst++ = *p;
+    }
+    *dst = '\0';
+  }
+  return count;
+}
+
+// 引数がキーワードで始まっていれば、その後の文字列を返す。
+static const char* getValue(const char* token, const char* key) {
+  size_t len = strlen(key);
+  return (strncmp(token, key, len) == 0) ? token + len : NULL;
+}
+
+// 行を解析してジョブを作成する。
+static bool parseJob(char* line, const char* run68Path, Job* job) {
+  char* tokens[MAX_ARGS + MAX_ENVS + 8];
+  const int maxTokens = (int)(sizeof(tokens) / sizeof(tokens[0]));
+  int count = splitLine(line, tokens, maxTokens);
+  if (count < 0) {
+    fprintf(stderr, "run68:引数が多すぎます。\n");
+    return false;
+  }
+
+  *job = (Job){0};
+  int i = 0;
+  for (; i < count; i += 1) {
+    const char* t = tokens[i];
+    const char* v;
+    if ((v = getValue(t, "cwd=")) != NULL) {
+      job->cwd = v;
+    } else if ((v = getValue(t, "stdin=")) != NULL) {
+      job->stdinPath = v;
+    } else if ((v = getValue(t, "stdout=")) != NULL) {
+      job->stdoutPath = v;
+    } else if ((v = getValue(t, "stderr=")) != NULL) {
+      job->stderrPath = v;
+    } else if ((v = getValue(t, "env=")) != NULL) {
+      if (job->envCount >= MAX_ENVS) {
+        fprintf(stderr, "run68:環境変数が多すぎます。\n");
+        return false;
+      }
+      job->env[job->envCount++] = v;
+    } else {
+      if (strcmp(t, "--") == 0) i += 1;
+      break;
+    }
+  }
+
+  if (i >= count) {
+    fprintf(stderr, "run68:実行ファイルが指定されていません。\n");
+    return false;
+  }
+  if (count - i > MAX_ARGS) {
+    fprintf(stderr, "run68:引数が多すぎます。\n");
+    return false;
+  }
+
+  job->argv[job->argc++] = (char*)run68Path;
+  for (; i < count; i += 1) job->argv[job->argc++] = tokens[i];
+  job->argv[job->argc] = NULL;
+  return true;
+}
+
+// 標準入出力をファイルに付け替える。
+//   戻り値は元のファイルディスクリプタの複製(-1 = 失敗)。
+static int redirect(FILE* stream, const char* path, bool output) {
+  int file = output ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)
+                    : open(path, O_RDONLY);
+  if (file < 0) {
+    fprintf(stderr, "run68:ファイルがオープンできません。(\"%s\")\n", path);
+    return -1;
+  }
+
+  int saved = RedirectStream(stream, file);
+  close(file);
+  return saved;
+}
+
+static double wallClock(void) {
+  struct timespec ts;
+  if (timespec_get(&ts, TIME_UTC) == 0) return 0;
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double cpuClock(void) { return (double)clock() / CLOCKS_PER_SEC; }
+
+// ジョブを実行する。
+//   戻り値：true = 実行した(終了コードは*exitCode)
+//           false = 実行する前に失敗した
+static bool runJob(Run68Machine* machine, const Job* job, const char* startDir,
+                   int* exitCode) {
+  if (job->cwd && chdir(job->cwd) != 0) {
+    fprintf(stderr, "run68:ディレクトリに移動できません。(\"%s\")\n",
+            job->cwd);
+    return false;
+  }
+
+  int savedIn = -1, savedOut = -1, savedErr = -1;
+  bool ok = true;
+  if (job->stdinPath) {
+    savedIn = redirect(stdin, job->stdinPath, false);
+    if (savedIn < 0) ok = false;
+  }
+  if (ok && job->stdoutPath) {
+    savedOut = redirect(stdout, job->stdoutPath, true);
+    if (savedOut < 0) ok = false;
+  }
+  if (ok && job->stderrPath) {
+    savedErr = redirect(stderr, job->stderrPath, true);
+    if (savedErr < 0) ok = false;
+  }
+
+  if (ok) {
+    Run68SetEnvironment(machine, job->envCount ? job->env : NULL);
+    *exitCode = Run68Execute(machine, job->argc, (char**)job->argv);
+    Run68SetEnvironment(machine, NULL);
+  }
+
+  RestoreStream(stderr, savedErr);
+  RestoreStream(stdout, savedOut);
+  RestoreStream(stdin, savedIn);
+  if (job->cwd && chdir(startDir) != 0) {
+    fprintf(stderr, "run68:ディレクトリに戻れません。(\"%s\")\n", startDir);
+  }
+  return ok;
+}
+
+// 行末の改行を取り除く。
+//   戻り値：false = 行が長すぎる
+static bool chompLine(char* line, FILE* fp) {
+  size_t len = strlen(line);
+  bool complete = (len > 0 && line[len - 1] == '\n') || feof(fp);
+
+  while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+    line[--len] = '\0';
+  }
+  if (complete) return true;
+
+  // 行の残りを読み飛ばす
+  int c;
+  while ((c = fgetc(fp)) != EOF && c != '\n') {
+  }
+  return false;
+}
+
+// マニフェストの1行(空行とコメントを除く)
+typedef struct {
+  int lineNo;
+  bool lengthOk;
+  char* command;
+} Entry;
+
+// ジョブの実行結果
+//   並列実行ではワーカーが共有メモリに書き込む。
+typedef struct {
+  bool done;  // false = 実行中にワーカーが異常終了した
+  bool ok;    // false = 実行する前に失敗した
+  int exitCode;
+  double wall;
+  double cpu;
+} JobResult;
+
+static void freeEntries(Entry* entries, int count) {
+  for (int i = 0; i < count; i += 1) free(entries[i].command);
+  free(entries);
+}
+
+// マニフェストを全て読み込む。
+//   戻り値はジョブの数(-1 = メモリ不足)。
+static int readManifest(FILE* manifest, Entry** result) {
+  static char line[MAX_LINE];
+  Entry* entries = NULL;
+  int count = 0, capacity = 0;
+
+  for (int lineNo = 1; fgets(line, sizeof(line), manifest); lineNo += 1) {
+    bool lengthOk = chompLine(line, manifest);
+    const char* p = line + strspn(line, " \t");
+    if (*p == '\0' || *p == '#') continue;
+
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      Entry* grown = realloc(entries, sizeof(Entry) * (size_t)capacity);
+      if (!grown) break;
+      entries = grown;
+    }
+    char* command = malloc(strlen(p) + 1);
+    if (!command) break;
+    strcpy(command, p);
+    entries[count++] = (Entry){lineNo, lengthOk, command};
+  }
+
+  if (!feof(manifest)) {
+    fprintf(stderr, "run68:メモリが不足しています。\n");
+    freeEntries(entries, count);
+    return -1;
+  }
+  *result = entries;
+  return count;
+}
+
+// マニフェストの1行を実行する。
+static void runEntry(Run68Machine* machine, const char* run68Path,
+                     const char* manifestPath, const char* startDir,
+                     const Entry* entry, JobResult* result) {
+  static char line[MAX_LINE];
+  Job job;
+  int exitCode = 0;
+  double wall = wallClock();
+  double cpu = cpuClock();
+
+  bool ok = false;
+  if (!entry->lengthOk) {
+    fprintf(stderr, "run68:%s:%d:行が長すぎます。\n", manifestPath,
+            entry->lineNo);
+  } else {
+    strcpy(line, entry->command);
+    if (!parseJob(line, run68Path, &job)) {
+      fprintf(stderr, "run68:%s:%d:行の書式が正しくありません。\n",
+              manifestPath, entry->lineNo);
+    } else {
+      ok = runJob(machine, &job, startDir, &exitCode);
+    }
+  }
+
+  result->wall = wallClock() - wall;
+  result->cpu = cpuClock() - cpu;
+  result->exitCode = exitCode;
+  result->ok = ok;
+  result->done = true;
+}
+
+// サマリファイルにジョブの実行結果を出力する。
+static void writeResult(FILE* summary, const Entry* entry,
+                        const JobResult* result) {
+  if (result->done && result->ok) {
+    fprintf(summary, "%d\t%d\t%.3f\t%.3f\t%s\n", entry->lineNo,
+            result->exitCode, result->wall, result->cpu, entry->command);
+  } else {
+    fprintf(summary, "%d\terror\t%.3f\t%.3f\t%s\n", entry->lineNo,
+            result->wall, result->cpu, entry->command);
+  }
+  fflush(summary);
+}
+
+// ジョブを1つずつ実行する。
+static void runSequential(Run68Machine* machine, const char* run68Path,
+                          const char* manifestPath, const char* startDir,
+                          const Entry* entries, int count, JobResult* results,
+                          FILE* summary) {
+  for (int i = 0; i < count; i += 1) {
+    runEntry(machine, run68Path, manifestPath, startDir, &entries[i],
+             &results[i]);
+    writeResult(summary, &entries[i], &results[i]);
+  }
+}
+
+#ifdef PARALLEL_BATCH
+
+// ワーカー間で共有するメモリ
+typedef struct {
+  atomic_int next;  // 次に実行するジョブの番号
+  JobResult results[];
+} SharedState;
+
+// ワーカープロセスの処理
+//   ジョブがなくなるまで、共有カウンタから取ったジョブを実行する。
+static void runWorker(Run68Machine* machine, const char* run68Path,
+                      const char* manifestPath, const char* startDir,
+                      const Entry* entries, int count, SharedState* shared) {
+  int i;
+  while ((i = atomic_fetch_add(&shared->next, 1)) < count) {
+    runEntry(machine, run68Path, manifestPath, startDir, &entries[i],
+             &shared->results[i]);
+  }
+  fflush(stdout);
+  fflush(stderr);
+  _exit(EXIT_SUCCESS);
+}
+
+// ワーカープロセスを起動する。
+static bool spawnWorker(Run68Machine* machine, const char* run68Path,
+                        const char* manifestPath, const char* startDir,
+                        const Entry* entries, int count,
+                        SharedState* shared) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("run68:fork");
+    return false;
+  }
+  if (pid == 0) {
+    runWorker(machine, run68Path, manifestPath, startDir, entries, count,
+              shared);
+  }
+  return true;
+}
+
+// ジョブを複数のワーカープロセスで並列に実行する。
+//   ジョブの実行中にワーカーが異常終了した場合、そのジョブはエラーとし、
+//   残りのジョブを実行するワーカーを起動し直す。
+//   戻り値：false = 共有メモリの確保、ワーカーの起動に失敗した
+static bool runParallel(Run68Machine* machine, const char* run68Path,
+                        const char* manifestPath, const char* startDir,
+                        const Entry* entries, int count, int workers,
+                        JobResult* results) {
+  size_t size =
+      offsetof(SharedState, results) + sizeof(JobResult) * (size_t)count;
+  SharedState* shared = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED) {
+    perror("run68:mmap");
+    return false;
+  }
+  atomic_init(&shared->next, 0);
+
+  // 子プロセスが親のバッファを重複して出力しないようにする
+  fflush(stdout);
+  fflush(stderr);
+
+  int running = 0;
+  for (; running < workers; running += 1) {
+    if (!spawnWorker(machine, run68Path, manifestPath, startDir, entries,
+                     count, shared))
+      break;
+  }
+
+  while (running > 0) {
+    if (wait(NULL) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    running -= 1;
+    if (atomic_load(&shared->next) < count &&
+        spawnWorker(machine, run68Path, manifestPath, startDir, entries,
+                    count, shared)) {
+      running += 1;
+    }
+  }
+
+  bool ok = running == 0 && atomic_load(&shared->next) >= count;
+  memcpy(results, shared->results, sizeof(JobResult) * (size_t)count);
+  munmap(shared, size);
+  return ok;
+}
+
+#endif
+
+// ワーカーの数の既定値(ホストのCPUコア数)
+static int defaultWorkers(void) {
+#ifdef PARALLEL_BATCH
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0) return (n < MAX_BATCH_JOBS) ? (int)n : MAX_BATCH_JOBS;
+#endif
+  return 1;
+}
+
+/*
+   機能：
+     マニフェストファイルに書かれたコマンドラインを実行する
+   パラメータ：
+     Run68Machine*  machine       <in>  実行に使うマシン
+     const char*    run68Path     <in>  run68自身のパス名(絶対パス)
+     const char*    manifestPath  <in>  マニフェストファイル
+     const char*    summaryPath   <in>  サマリファイル(NULL = 標準エラー出力)
+     int            workers       <in>  同時に実行するジョブの数
+                                        (0 = ホストのCPUコア数)
+   戻り値：
+     EXIT_SUCCESS = 全てのジョブが終了コード0で終了した
+*/
+int RunBatch(Run68Machine* machine, const char* run68Path,
+             const char* manifestPath, const char* summaryPath,
+             int workers) {
+  static char startDir[MAX_LINE];
+
+  if (getcwd(startDir, sizeof(startDir)) == NULL) {
+    fprintf(stderr, "run68:カレントディレクトリが取得できません。\n");
+    return EXIT_FAILURE;
+  }
+
+  FILE* manifest = fopen(manifestPath, "r");
+  if (!manifest) {
+    fprintf(stderr, "run68:ファイルがオープンできません。(\"%s\")\n",
+            manifestPath);
+    return EXIT_FAILURE;
+  }
+  Entry* entries = NULL;
+  int count = readManifest(manifest, &entries);
+  fclose(manifest);
+  if (count < 0) return EXIT_FAILURE;
+
+  JobResult* results = calloc((size_t)count + 1, sizeof(JobResult));
+  if (!results) {
+    fprintf(stderr, "run68:メモリが不足しています。\n");
+    freeEntries(entries, count);
+    return EXIT_FAILURE;
+  }
+
+  FILE* summary = summaryPath ? fopen(summaryPath, "w") : stderr;
+  if (!summary) {
+    fprintf(stderr, "run68:ファイルが作成できません。(\"%s\")\n",
+            summaryPath);
+    free(results);
+    freeEntries(entries, count);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(summary, "# line\texit\twall\tcpu\tcommand\n");
+  fflush(summary);
+  if (workers <= 0) workers = defaultWorkers();
+  if (workers > count) workers = (count > 0) ? count : 1;
+  double wall = wallClock();
+  bool completed = true;
+
+#ifdef PARALLEL_BATCH
+  if (workers > 1) {
+    completed = runParallel(machine, run68Path, manifestPath, startDir,
+                            entries, count, workers, results);
+    for (int i = 0; i < count; i += 1) {
+      writeResult(summary, &entries[i], &results[i]);
+    }
+  } else {
+    runSequential(machine, run68Path, manifestPath, startDir, entries, count,
+                  results, summary);
+  }
+#else
+  runSequential(machine, run68Path, manifestPath, startDir, entries, count,
+                results, summary);
+#endif
+
+  int failed = 0;
+  double totalCpu = 0;
+  for (int i = 0; i < count; i += 1) {
+    const JobResult* r = &results[i];
+    if (!r->done || !r->ok || r->exitCode != 0) failed += 1;
+    totalCpu += r->cpu;
+  }
+  fprintf(summary, "# jobs=%d failed=%d wall=%.3f cpu=%.3f workers=%d\n",
+          count, failed, wallClock() - wall, totalCpu, workers);
+
+  if (summaryPath) fclose(summary);
+  free(results);
+  freeEntries(entries, count);
+  return (completed && failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
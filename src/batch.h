@@ -0,0 +1,31 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "librun68.h"
+
+// 同時に実行するジョブの数の上限
+#define MAX_BATCH_JOBS 256
+
+int RunBatch(Run68Machine* machine, const char* run68Path,
+             const char* manifestPath, const char* summaryPath,
+             int workers);
+
+#endif
@@ -0,0 +1,80 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#ifndef BCD_H
+#define BCD_H
+
+#include <stdbool.h>
+
+#include "m68k.h"
+#include "run68.h"
+
+// BCD(2進化10進数)の演算
+//   abcd、sbcd、nbcd命令とIOCSの日付・時刻の変換で共有する。
+//   加減算はMakoto Kamada氏のXEiJ (https://stdkmd.net/xeij/)
+//   MC68000.javaを参考にしています。BCDとして不正な値の演算結果と、
+//   MC68000では未定義のN、Vフラグも含めて同じ値になる。
+//   桁ごとの補正は比較結果をそのまま掛けて求め、条件分岐はしない。
+
+extern const UByte bcdDigits[100];
+
+// 0～99の整数をBCDに変換する。
+static inline int ToBcd(int n) { return bcdDigits[n]; }
+
+// BCD演算のコンディションコードを求める。
+//   Zは結果が0以外の時だけクリアし、0なら変化しない。
+static inline UWord bcdConditions(UWord ccr, Long t, Long result,
+                                  bool carry) {
+  Long a = result - t;
+  ccr &= ~(CCR_X | CCR_N | CCR_V | CCR_C);
+  ccr &= (result != 0) ? ~CCR_Z : 0xffff;
+  ccr |= carry ? (CCR_X | CCR_C) : 0;
+  ccr |= (result & 0x80) ? CCR_N : 0;
+  ccr |= (((t ^ result) & (a ^ result)) & 0x80) ? CCR_V : 0;
+  return ccr;
+}
+
+// BCD加算(x + y + X)を行い、結果を返す。
+//   *ccrには演算前のCCRを渡し、演算後のCCRを受け取る。
+static inline Long AddBcd(Long x, Long y, UWord* ccr) {
+  Long ccrX = (*ccr & CCR_X) ? 1 : 0;
+  Long t = (x & 0xff) + (y & 0xff) + ccrX;
+
+  Long result = t + (10 <= (x & 0x0f) + (y & 0x0f) + ccrX) * (0x10 - 10);
+  bool carry = (10 << 4) <= result;
+  result = (result + carry * (0x100 - (10 << 4))) & 0xff;
+
+  *ccr = bcdConditions(*ccr, t, result, carry);
+  return result;
+}
+
+// BCD減算(x - y - X)を行い、結果を返す。
+//   *ccrには演算前のCCRを渡し、演算後のCCRを受け取る。
+static inline Long SubBcd(Long x, Long y, UWord* ccr) {
+  Long ccrX = (*ccr & CCR_X) ? 1 : 0;
+  Long t = (x & 0xff) - (y & 0xff) - ccrX;
+
+  Long result = t - ((x & 0x0f) < (y & 0x0f) + ccrX) * (0x10 - 10);
+  bool borrow = result < 0;
+  result = (result - (borrow && t < 0) * (0x100 - (10 << 4))) & 0xff;
+
+  *ccr = bcdConditions(*ccr, t, result, borrow);
+  return result;
+}
+
+#endif
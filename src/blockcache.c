@@ -0,0 +1,181 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#include "blockcache.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "hle.h"
+#include "mem.h"
+#include "run68.h"
+
+// ブロックキャッシュ
+//   実行した命令の並びを、分岐するまでを1ブロックとしてデコード済みの形で
+//   記録しておき、次回からは命令の読み込みと振り分けを省略する。
+//   ブロックはブロック先頭のPCをキーとするダイレクトマップ方式で管理する。
+//
+//   実行時には命令ごとにPCとホストメモリ上の命令コードを照合するため、
+//   プログラムの読み込みや自己書き換え等でメモリが書き換えられた場合は
+//   その命令から通常の読み込みに戻る(ブロックは記録し直される)。
+//   拡張ワードは命令ハンドラがその都度メモリから読み込むので、
+//   命令コード以外の書き換えを検出する必要はない。
+
+#define BLOCK_CACHE_SIZE 4096  // ブロック数(2のべき乗)
+#define BLOCK_MAX_INSTRUCTIONS 32
+#define MAX_INSTRUCTION_LENGTH 10  // MC68000の最大命令長(バイト)
+
+typedef struct {
+  int count;  // 記録済みの命令数(0なら未使用)
+
+  // 記録済みの命令の直後は番兵(どの命令とも一致しない)
+  DecodedInstruction insts[BLOCK_MAX_INSTRUCTIONS + 1];
+} Block;
+
+struct BlockCache {
+  Block blocks[BLOCK_CACHE_SIZE];
+};
+
+static THREAD_LOCAL Block* blocks;  // 実行中のマシンのブロックキャッシュ
+
+static char sentinelCode[2];
+static const DecodedInstruction sentinel = {0xffffffff, 0xffff, sentinelCode,
+                                            NULL};
+
+static THREAD_LOCAL Block* currentBlock;  // 実行中のブロック
+
+// 次に実行する(と予想される)命令
+THREAD_LOCAL const DecodedInstruction* nextInstruction = &sentinel;
+
+// マシンごとのブロックキャッシュを作成する。
+//   内容は実行を開始する時にClearBlockCache()で消去する。
+//   NULLならメモリ不足。
+BlockCache* CreateBlockCache(void) { return malloc(sizeof(BlockCache)); }
+
+void DestroyBlockCache(BlockCache* cache) { free(cache); }
+
+// ブロックキャッシュを実行するスレッドに結び付ける。
+void AttachBlockCache(BlockCache* cache) {
+  blocks = cache->blocks;
+  currentBlock = NULL;
+  nextInstruction = &sentinel;
+}
+
+// ブロックキャッシュをスレッドから切り離す。
+void DetachBlockCache(void) {
+  blocks = NULL;
+  currentBlock = NULL;
+  nextInstruction = &sentinel;
+}
+
+// ブロックキャッシュを消去する。
+//   メモリを確保し直した場合はホストメモリ上のアドレスが無効になるので
+//   必ず呼び出すこと。
+void ClearBlockCache(void) {
+  for (int i = 0; i < BLOCK_CACHE_SIZE; i += 1) {
+    blocks[i].count = 0;
+    blocks[i].insts[0] = sentinel;
+  }
+  currentBlock = NULL;
+  nextInstruction = &sentinel;
+}
+
+// メモリから命令を読み込み、ブロックの末尾に記録する。
+static const DecodedInstruction* appendInstruction(Block* block, ULong key) {
+  DecodedInstruction* inst = &block->insts[block->count];
+  nextInstruction = inst;
+
+  Span mem = GetReadableMemory(cpu.pc, 2);
+  if (!mem.bufptr) return NULL;
+
+  UWord code = PeekW(mem.bufptr);
+  InstructionHandler handler = HleGetHandler(cpu.pc);
+  if (!handler) handler = GetInstructionHandler(code);
+  *inst = (DecodedInstruction){key, code, mem.bufptr, handler};
+  inst[1] = sentinel;
+  block->count += 1;
+
+  // 条件分岐命令なら、直前の命令を分岐命令まで実行するハンドラに置き換える
+  if (block->count >= 2 && IsConditionalBranch(code) &&
+      inst[-1].handler == GetInstructionHandler(inst[-1].code)) {
+    InstructionHandler fused = GetFusedInstructionHandler(inst[-1].code);
+    if (fused) inst[-1].handler = fused;
+  }
+
+  nextInstruction = inst + 1;
+  return inst;
+}
+
+// 実行中のブロックの続きとして命令を記録できるか調べる。
+static bool canAppend(const Block* block, ULong key) {
+  if (block == NULL) return false;
+
+  int count = block->count;
+  if (count == 0 || count >= BLOCK_MAX_INSTRUCTIONS) return false;
+  if (nextInstruction != &block->insts[count]) return false;
+
+  // 直前の命令から分岐せずに続く命令だけを同じブロックに記録する。
+  // (スーパーバイザモードが変化した場合は差が奇数になる)
+  ULong diff = key - block->insts[count - 1].key;
+  return (diff & 1) == 0 && diff != 0 && diff <= MAX_INSTRUCTION_LENGTH;
+}
+
+// 予想した命令が直前の命令と融合して実行済みの条件分岐命令なら飛ばす。
+static void skipFusedInstruction(const Block* block) {
+  if (block == NULL) return;
+
+  const DecodedInstruction* inst = nextInstruction;
+  if (inst <= &block->insts[0] || &block->insts[block->count] <= inst) return;
+
+  if (IsConditionalBranch(inst->code)) nextInstruction = inst + 1;
+}
+
+/*
+ 　機能：ブロックキャッシュから命令が得られなかった場合に、PCの指す命令を
+ 　　　　デコード済みの形で得る
+ 戻り値：命令(NULL = バスエラー)
+*/
+const DecodedInstruction* FetchInstructionSlow(void) {
+  ULong key = GetInstructionKey();
+
+  // 融合して実行済みの条件分岐命令を飛ばして、その次の命令と照合する
+  skipFusedInstruction(currentBlock);
+  const DecodedInstruction* inst = nextInstruction;
+  if (inst->key == key && PeekW(inst->bufptr) == inst->code) {
+    nextInstruction = inst + 1;
+    return inst;
+  }
+
+  // 分岐せずにブロックの末尾に達したなら、ブロックを延長する
+  if (canAppend(currentBlock, key)) return appendInstruction(currentBlock, key);
+
+  // PCから始まるブロックを探す
+  Block* block = &blocks[((ULong)cpu.pc >> 1) & (BLOCK_CACHE_SIZE - 1)];
+  currentBlock = block;
+
+  inst = &block->insts[0];
+  if (inst->key == key && PeekW(inst->bufptr) == inst->code) {
+    nextInstruction = inst + 1;
+    return inst;
+  }
+
+  // 見つからなければ新しいブロックとして記録し直す
+  block->count = 0;
+  return appendInstruction(block, key);
+}
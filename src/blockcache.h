@@ -0,0 +1,64 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include "mem.h"
+#include "run68.h"
+
+// デコード済みの命令
+typedef struct {
+  ULong key;      // 命令のアドレス|スーパーバイザモードなら1
+  UWord code;     // 命令コード
+  char* bufptr;   // 命令コードのホストメモリ上のアドレス
+  InstructionHandler handler;
+} DecodedInstruction;
+
+extern THREAD_LOCAL const DecodedInstruction* nextInstruction;
+
+// マシンごとのブロックキャッシュ
+//   実行中はAttachBlockCache()で実行するスレッドに結び付ける。
+typedef struct BlockCache BlockCache;
+
+BlockCache* CreateBlockCache(void);
+void DestroyBlockCache(BlockCache* cache);
+void AttachBlockCache(BlockCache* cache);
+void DetachBlockCache(void);
+
+void ClearBlockCache(void);
+const DecodedInstruction* FetchInstructionSlow(void);
+
+// 命令のキー(PCとスーパーバイザモードの組)を得る。
+static inline ULong GetInstructionKey(void) {
+  return (ULong)cpu.pc | (SR_S_REF() ? 1 : 0);
+}
+
+// PCの指す命令をデコード済みの形で得る。
+//   NULLならバスエラー。
+static inline const DecodedInstruction* FetchInstruction(void) {
+  const DecodedInstruction* inst = nextInstruction;
+
+  // 実行中のブロックの続きで、命令コードが書き換えられていなければそのまま使う。
+  if (inst->key == GetInstructionKey() && PeekW(inst->bufptr) == inst->code) {
+    nextInstruction = inst + 1;
+    return inst;
+  }
+  return FetchInstructionSlow();
+}
+
+#endif
@@ -0,0 +1,168 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include "checkpoint.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "human68k.h"
+#include "mem.h"
+#include "run68.h"
+
+// チェックポイント
+//   実行中のマシンの状態(レジスタ、メモリ、プロセス)をファイルに保存し、
+//   別の実行でその状態から実行を再開する。
+//   メモリ管理ブロックやPSPなどHuman68kの状態はメモリ上にあるので、
+//   メモリと一緒に保存される。
+//
+//   ファイルはヘッダに続けて、MEMORY_PAGE_SIZEの位置からメインメモリと
+//   ハイメモリの内容をそのまま並べる。ページ境界に揃えてあるので、
+//   復元時はファイルをコピーオンライトでマップでき、同じファイルから
+//   復元した複数のプロセスで書き換えていないページを共有できる。
+
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_MEMORY_OFFSET ((long)MEMORY_PAGE_SIZE)
+
+static const char checkpointMagic[8] = "RUN68CP";
+
+// 現在の状態でチェックポイントを作成できるか調べる。
+//   子プロセスや、標準入出力以外に開いているファイルの状態は
+//   ホスト側にあり保存できないので、その場合は作成しない。
+static bool canWriteCheckpoint(void) {
+  if (nest_cnt != 0) {
+    print("run68:子プロセスの実行中はチェックポイントを作成できません。\n");
+    return false;
+  }
+
+  for (int i = HUMAN68K_STDERR + 1; i < FILE_MAX; i += 1) {
+    if (finfo[i].is_opened) {
+      print(
+          "run68:ファイルを開いているため、"
+          "チェックポイントを作成できません。\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+   機能：
+     実行中のマシンの状態をチェックポイントファイルに書き込む
+   パラメータ：
+     const char*  path         <in>  ファイル名
+     ULong        programSize  <in>  プログラムの大きさ(bssを含む)
+     ULong        entry        <in>  プログラムの実行開始アドレス
+   戻り値：
+     true = 成功
+*/
+bool WriteCheckpoint(const char* path, ULong programSize, ULong entry) {
+  if (!canWriteCheckpoint()) return false;
+
+  CheckpointHeader header;
+  memset(&header, 0, sizeof(header));  // パディングも0にしておく
+  memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+  header.version = CHECKPOINT_VERSION;
+  header.headerSize = sizeof(header);
+  header.mainMemorySize = mainMemoryEnd;
+  header.highMemorySize = highMemoryEnd ? highMemoryEnd - HIMEM_START : 0;
+  header.supervisorEnd = supervisorEnd;
+  header.cpu = cpu;
+  header.cpu.sr = GetSr();
+  header.superjsrReturn = superjsr_ret;
+  header.psp = psp[nest_cnt];
+  header.programSize = programSize;
+  header.entry = entry;
+
+  FILE* fp = fopen(path, "wb");
+  if (!fp) {
+    printFmt("run68:チェックポイントファイル'%s'を作成できません。\n", path);
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+            WriteMemoryImage(fp, CHECKPOINT_MEMORY_OFFSET);
+  if (fclose(fp) != 0) ok = false;
+
+  if (!ok) {
+    printFmt("run68:チェックポイントファイル'%s'の書き込みに失敗しました。\n",
+             path);
+    remove(path);
+  }
+  return ok;
+}
+
+// ヘッダのメモリ容量がrun68xで指定できる値か調べる。
+static bool isValidMemorySize(const CheckpointHeader* header) {
+  const ULong mb = 1024 * 1024;
+
+  if (header->mainMemorySize == 0 || header->mainMemorySize % mb != 0 ||
+      header->mainMemorySize > MAIN_MEMORY_MB_MAX * mb) {
+    return false;
+  }
+  return header->highMemorySize % mb == 0 &&
+         header->highMemorySize <= HIMEM_ADDRESS_MASK + 1 - HIMEM_START;
+}
+
+/*
+   機能：
+     チェックポイントファイルを開き、ヘッダを読み込む
+   パラメータ：
+     const char*        path    <in>   ファイル名
+     CheckpointHeader*  header  <out>  ヘッダ
+   戻り値：
+     ファイル(NULL = 開けないか、対応していないファイル)
+*/
+FILE* OpenCheckpoint(const char* path, CheckpointHeader* header) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp) {
+    printFmt("run68:チェックポイントファイル'%s'を開けません。\n", path);
+    return NULL;
+  }
+
+  if (fread(header, sizeof(*header), 1, fp) != 1 ||
+      memcmp(header->magic, checkpointMagic, sizeof(header->magic)) != 0 ||
+      header->version != CHECKPOINT_VERSION ||
+      header->headerSize != sizeof(*header) || !isValidMemorySize(header)) {
+    printFmt("run68:'%s'は対応していないチェックポイントファイルです。\n",
+             path);
+    fclose(fp);
+    return NULL;
+  }
+  return fp;
+}
+
+// チェックポイントファイルからマシンの状態を復元する。
+//   メモリはヘッダと同じ容量で確保し、Human68kを初期化しておくこと。
+//   ファイルはマップされたメモリとは無関係に閉じてよい。
+bool RestoreCheckpoint(FILE* fp, const CheckpointHeader* header) {
+  if (!ReadMemoryImage(fp, CHECKPOINT_MEMORY_OFFSET)) {
+    print("run68:チェックポイントファイルの読み込みに失敗しました。\n");
+    return false;
+  }
+  if (supervisorEnd != header->supervisorEnd) {
+    SetSupervisorArea(header->supervisorEnd);
+  }
+
+  cpu = header->cpu;
+  SetSr(header->cpu.sr);
+  superjsr_ret = header->superjsrReturn;
+  nest_cnt = 0;
+  psp[0] = header->psp;
+  return true;
+}
@@ -0,0 +1,56 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+
+#include "run68.h"
+
+// チェックポイントから復元する時に置き換えられるコマンドラインの大きさ
+//   チェックポイントを作成する実行では、この大きさのメモリブロックに
+//   コマンドラインを書き込んでおく。
+#define CHECKPOINT_COMMAND_LINE_SIZE 4096
+
+// チェックポイントファイルのヘッダ
+//   ホストのバイトオーダーのまま書き込むので、ファイルは同じ環境の
+//   run68xでのみ復元できる。
+typedef struct {
+  char magic[8];
+  ULong version;
+  ULong headerSize;  // sizeof(CheckpointHeader)
+
+  ULong mainMemorySize;
+  ULong highMemorySize;
+  ULong supervisorEnd;
+
+  Cpu cpu;  // srはGetSr()で得た値
+  Long superjsrReturn;
+  Long psp;  // 実行中のプロセスのPSP
+
+  // 実行中のプログラムの範囲(復元時にHUPAIR対応か調べるのに使う)
+  ULong programSize;  // PSPを除く、bssを含む大きさ
+  ULong entry;        // 実行開始アドレス
+} CheckpointHeader;
+
+bool WriteCheckpoint(const char* path, ULong programSize, ULong entry);
+FILE* OpenCheckpoint(const char* path, CheckpointHeader* header);
+bool RestoreCheckpoint(FILE* fp, const CheckpointHeader* header);
+
+#endif
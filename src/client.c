@@ -0,0 +1,183 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+
+extern char** environ;
+
+// 常駐サーバー(run68 -server)のクライアント
+//   run68と同じコマンドラインを受け付け、環境変数RUN68_SOCKETで指定した
+//   サーバーにカレントディレクトリ、環境変数、標準入出力を渡して実行させる。
+//   終了コードはサーバーで実行したプログラムの終了コードになる。
+
+static bool sendAll(int sock, const void* buf, size_t size) {
+  const char* p = buf;
+  while (size > 0) {
+    ssize_t n = send(sock, p, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+static bool receiveAll(int sock, void* buf, size_t size) {
+  char* p = buf;
+  while (size > 0) {
+    ssize_t n = recv(sock, p, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+// ヘッダを標準入出力のファイルディスクリプタと一緒に送信する。
+static bool sendHeader(int sock, const ServerRequestHeader* header) {
+  static const int fds[SERVER_FD_COUNT] = {STDIN_FILENO, STDOUT_FILENO,
+                                           STDERR_FILENO};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(fds))];
+  } control;
+  memset(&control, 0, sizeof(control));
+
+  struct iovec iov = {(void*)header, sizeof(*header)};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+  ssize_t n;
+  do {
+    n = sendmsg(sock, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) return false;
+
+  return sendAll(sock, (const char*)header + n, sizeof(*header) - (size_t)n);
+}
+
+// カレントディレクトリ、コマンドライン、環境変数をペイロードにまとめる。
+static char* makePayload(int argc, char* argv[], uint32_t* outSize) {
+  static char cwd[4096];
+  if (getcwd(cwd, sizeof(cwd)) == NULL) {
+    fprintf(stderr, "run68c:カレントディレクトリが取得できません。\n");
+    return NULL;
+  }
+
+  size_t size = strlen(cwd) + 1;
+  for (int i = 1; i < argc; i += 1) size += strlen(argv[i]) + 1;
+  if (size > SERVER_PAYLOAD_MAX) {
+    fprintf(stderr, "run68c:コマンドラインが長すぎます。\n");
+    return NULL;
+  }
+  for (char** envp = environ; *envp; envp += 1) size += strlen(*envp) + 1;
+  if (size > SERVER_PAYLOAD_MAX) {
+    fprintf(stderr, "run68c:環境変数が大きすぎます。\n");
+    return NULL;
+  }
+
+  char* payload = malloc(size);
+  if (!payload) return NULL;
+
+  char* p = payload;
+  size_t len = strlen(cwd) + 1;
+  memcpy(p, cwd, len);
+  p += len;
+  for (int i = 1; i < argc; i += 1) {
+    len = strlen(argv[i]) + 1;
+    memcpy(p, argv[i], len);
+    p += len;
+  }
+  for (char** envp = environ; *envp; envp += 1) {
+    len = strlen(*envp) + 1;
+    memcpy(p, *envp, len);
+    p += len;
+  }
+  *outSize = (uint32_t)size;
+  return payload;
+}
+
+static int connectServer(const char* socketPath) {
+  struct sockaddr_un addr = {0};
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "run68c:ソケットのパス名が長すぎます。\n");
+    return -1;
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) return -1;
+  if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    fprintf(stderr, "run68c:サーバーに接続できません。(\"%s\")\n", socketPath);
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+int main(int argc, char* argv[]) {
+  const char* socketPath = getenv(SERVER_SOCKET_ENV);
+  if (!socketPath || !*socketPath) {
+    fprintf(stderr, "run68c:環境変数%sでサーバーのソケットを指定してください。\n",
+            SERVER_SOCKET_ENV);
+    return EXIT_FAILURE;
+  }
+
+  ServerRequestHeader header = {SERVER_REQUEST_MAGIC, 0, (uint32_t)argc - 1};
+  char* payload = makePayload(argc, argv, &header.payloadSize);
+  if (!payload) return EXIT_FAILURE;
+
+  int sock = connectServer(socketPath);
+  if (sock < 0) {
+    free(payload);
+    return EXIT_FAILURE;
+  }
+
+  int32_t exitCode = EXIT_FAILURE;
+  if (!sendHeader(sock, &header) ||
+      !sendAll(sock, payload, header.payloadSize) ||
+      !receiveAll(sock, &exitCode, sizeof(exitCode))) {
+    fprintf(stderr, "run68c:サーバーとの通信に失敗しました。\n");
+    exitCode = EXIT_FAILURE;
+  }
+
+  close(sock);
+  free(payload);
+  return exitCode;
+}
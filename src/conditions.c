@@ -41,39 +41,79 @@ void check(char *mode, Long src, Long dest, Long result, int size,
   char aftstr[9];
 
   ccr2bitmap(before, befstr);
-  ccr2bitmap(sr, aftstr);
+  ccr2bitmap(GetSr(), aftstr);
 
   printf("%s: 0x%08x 0x%08x 0x%08x %1d %8s %8s\n", mode, src, dest, result,
          size, befstr, aftstr);
 }
 #endif
 
-static Long getMSB(Long num, int size) {
-  switch (size) {
-    case S_BYTE:
-      return (num >> 7) & 1;
-    case S_WORD:
-      return (num >> 15) & 1;
-    case S_LONG:
-      return (num >> 31) & 1;
-
-    default:
-      err68a("不正なデータサイズです。", __FILE__, __LINE__);
-  }
+THREAD_LOCAL LazyConditions lazyConditions = {LAZY_CC_NONE, S_LONG, 0, 0, 0};
+
+// データサイズごとの最上位ビット
+static const ULong msbBits[] = {0x80, 0x8000, 0x80000000};
+
+static ULong getMsbBit(int size) {
+  if ((unsigned int)size > S_LONG)
+    err68a("不正なデータサイズです。", __FILE__, __LINE__);
+  return msbBits[size];
+}
+
+// 遅延評価するコンディションコードを記録する。
+static void setLazyConditions(LazyConditionsKind kind, Long src, Long dest,
+                              Long result, int size) {
+  lazyConditions.kind = kind;
+  lazyConditions.size = size;
+  lazyConditions.src = src;
+  lazyConditions.dest = dest;
+  lazyConditions.result = result;
 }
 
-static Long getBitsByDataSize(Long num, int size) {
-  switch (size) {
-    case S_BYTE:
-      return num & 0xff;
-    case S_WORD:
-      return num & 0xffff;
-    case S_LONG:
-      return num;
-
-    default:
-      err68a("不正なデータサイズです。", __FILE__, __LINE__);
+/*
+ 　機能：遅延評価中のコンディションコード(N、Z、V、C)を求める
+ 　　　　(srには反映しない)
+ 戻り値：CCRのN、Z、V、Cのビット
+*/
+UWord GetConditions(void) {
+  const LazyConditions* lc = &lazyConditions;
+  if (lc->kind == LAZY_CC_NONE) return cpu.sr & (CCR_N | CCR_Z | CCR_V | CCR_C);
+
+  ULong msb = getMsbBit(lc->size);
+  ULong s = lc->src;
+  ULong d = lc->dest;
+  ULong r = lc->result;
+  UWord ccr = 0;
+
+  switch (lc->kind) {
+    default:  // LAZY_CC_GENERAL
+      break;
+
+    case LAZY_CC_ADD:
+      if (((s ^ r) & (d ^ r)) & msb) ccr |= CCR_V;
+      if (((s & d) | ((s | d) & ~r)) & msb) ccr |= CCR_C;
+      break;
+
+    case LAZY_CC_CMP:
+      if (((s ^ d) & (d ^ r)) & msb) ccr |= CCR_V;
+      if (((s & ~d) | ((s | ~d) & r)) & msb) ccr |= CCR_C;
+      break;
   }
+
+  if ((r & ((msb << 1) - 1)) == 0) ccr |= CCR_Z;
+  if (r & msb) ccr |= CCR_N;
+
+  return ccr;
+}
+
+/*
+ 　機能：遅延評価中のコンディションコード(N、Z、V、C)を評価してsrに反映する
+ 戻り値：なし
+*/
+void EvaluateConditionsSlow(void) {
+  UWord ccr = GetConditions();
+
+  cpu.sr = (cpu.sr & ~(CCR_N | CCR_Z | CCR_V | CCR_C)) | ccr;
+  lazyConditions.kind = LAZY_CC_NONE;
 }
 
 /*
@@ -99,29 +139,7 @@ static Long getBitsByDataSize(Long num, int size) {
  *
  */
 void general_conditions(Long result, int size) {
-  int Rm;
-
-  Rm = (getMSB(result, size) != (Long)0);
-
-  /* Overflow Flag */
-  CCR_V_OFF();
-
-  /* Carry Flag & Extend Flag */
-  CCR_C_OFF();
-
-  /* Zero Flag */
-  if (getBitsByDataSize(result, size) == 0) {
-    CCR_Z_ON();
-  } else {
-    CCR_Z_OFF();
-  }
-
-  /* Negative Flag */
-  if (Rm != 0) {
-    CCR_N_ON();
-  } else {
-    CCR_N_OFF();
-  }
+  setLazyConditions(LAZY_CC_GENERAL, 0, 0, result, size);
 }
 
 /*
@@ -145,39 +163,19 @@ void general_conditions(Long result, int size) {
  */
 void add_conditions(Long src, Long dest, Long result, int size,
                     bool zero_flag) {
-  int Sm, Dm, Rm;
-
-  Sm = (getMSB(src, size) != (Long)0);
-  Dm = (getMSB(dest, size) != (Long)0);
-  Rm = (getMSB(result, size) != (Long)0);
+  ULong msb = getMsbBit(size);
 
-  /* Overflow Flag */
-  if ((Sm && Dm && !Rm) || (!Sm && !Dm && Rm)) {
-    CCR_V_ON();
+  /* Extend Flag */
+  if ((((ULong)src & dest) | (((ULong)src | dest) & ~(ULong)result)) & msb) {
+    CCR_X_ON();
   } else {
-    CCR_V_OFF();
+    CCR_X_OFF();
   }
 
-  /* Carry Flag & Extend Flag */
-  if ((Sm && Dm) || (Dm && !Rm) || (Sm && !Rm)) {
-    CCR_X_C_ON();
-  } else {
-    CCR_X_C_OFF();
-  }
+  setLazyConditions(LAZY_CC_ADD, src, dest, result, size);
 
   /* Zero Flag */
-  if (zero_flag && getBitsByDataSize(result, size) == 0) {
-    CCR_Z_ON();
-  } else {
-    CCR_Z_OFF();
-  }
-
-  /* Negative Flag */
-  if (Rm != 0) {
-    CCR_N_ON();
-  } else {
-    CCR_N_OFF();
-  }
+  if (!zero_flag) CCR_Z_OFF();
 }
 
 /*
@@ -198,39 +196,7 @@ void add_conditions(Long src, Long dest, Long result, int size,
  *
  */
 void cmp_conditions(Long src, Long dest, Long result, int size) {
-  int Sm, Dm, Rm;
-
-  Sm = (getMSB(src, size) != (Long)0);
-  Dm = (getMSB(dest, size) != (Long)0);
-  Rm = (getMSB(result, size) != (Long)0);
-
-  /* Overflow Flag */
-  if ((!Sm && Dm && !Rm) || (Sm && !Dm && Rm)) {
-    CCR_V_ON();
-  } else {
-    CCR_V_OFF();
-  }
-
-  /* Carry Flag & Extend Flag */
-  if ((Sm && !Dm) || (!Dm && Rm) || (Sm && Rm)) {
-    CCR_C_ON();
-  } else {
-    CCR_C_OFF();
-  }
-
-  /* Zero Flag */
-  if (getBitsByDataSize(result, size) == 0) {
-    CCR_Z_ON();
-  } else {
-    CCR_Z_OFF();
-  }
-
-  /* Negative Flag */
-  if (Rm != 0) {
-    CCR_N_ON();
-  } else {
-    CCR_N_OFF();
-  }
+  setLazyConditions(LAZY_CC_CMP, src, dest, result, size);
 }
 
 /*
@@ -254,20 +220,20 @@ void cmp_conditions(Long src, Long dest, Long result, int size) {
  */
 void sub_conditions(Long src, Long dest, Long result, int size,
                     bool zero_flag) {
-  cmp_conditions(src, dest, result, size);
+  ULong msb = getMsbBit(size);
 
-  if (CCR_C_REF()) {
+  /* Extend Flag */
+  if ((((ULong)src & ~(ULong)dest) | (((ULong)src | ~(ULong)dest) & result)) &
+      msb) {
     CCR_X_ON();
   } else {
     CCR_X_OFF();
   }
 
+  setLazyConditions(LAZY_CC_CMP, src, dest, result, size);
+
   /* Zero Flag */
-  if (zero_flag && (CCR_Z_REF() != 0)) {
-    CCR_Z_ON();
-  } else {
-    CCR_Z_OFF();
-  }
+  if (!zero_flag) CCR_Z_OFF();
 }
 
 /*
@@ -289,38 +255,8 @@ void sub_conditions(Long src, Long dest, Long result, int size,
  *
  */
 void neg_conditions(Long dest, Long result, int size, bool zero_flag) {
-  int Dm, Rm;
-
-  Dm = (getMSB(dest, size) != (Long)0);
-  Rm = (getMSB(result, size) != (Long)0);
-
-  /* Overflow Flag */
-  if (Dm && Rm) {
-    CCR_V_ON();
-  } else {
-    CCR_V_OFF();
-  }
-
-  /* Carry Flag & Extend Flag */
-  if (Dm || Rm) {
-    CCR_X_C_ON();
-  } else {
-    CCR_X_C_OFF();
-  }
-
-  /* Zero Flag */
-  if (zero_flag && getBitsByDataSize(result, size) == 0) {
-    CCR_Z_ON();
-  } else {
-    CCR_Z_OFF();
-  }
-
-  /* Negative Flag */
-  if (Rm != 0) {
-    CCR_N_ON();
-  } else {
-    CCR_N_OFF();
-  }
+  // 0 - dest として評価する
+  sub_conditions(dest, 0, result, size, zero_flag);
 }
 
 /* $Id: conditions.c,v 1.3 2009-08-08 06:49:44 masamic Exp $ */
@@ -45,7 +45,7 @@ static char* command_name[] = {
     "WATCHC"   /* 命令ウォッチ */
 };
 
-ULong stepcount;
+THREAD_LOCAL ULong stepcount;
 
 static void display_help();
 static void display_history(int argc, char** argv);
@@ -131,7 +131,7 @@ static char* toUpperString(char* s) {
      COMMAND コマンドの列挙値
  */
 static RUN68_COMMAND analyze(const char* line, int* argc, char** argv) {
-  static char cline[MAX_LINE];
+  static THREAD_LOCAL char cline[MAX_LINE];
   splitCommandLine(line, cline, argc, argv);
   if (*argc == 0) return RUN68_COMMAND_NULL;
 
@@ -157,7 +157,7 @@ RUN68_COMMAND debugger(bool running) {
   RUN68_COMMAND cmd;
 
   if (running) {
-    Long naddr, addr = pc;
+    Long naddr, addr = cpu.pc;
     const char* s = disassemble(addr, &naddr);
     if (addr == naddr) naddr += 2;  // ディスアセンブルできなかった
 
@@ -299,8 +299,8 @@ static bool scanAddress(const char* s, ULong* adrptr) {
 }
 
 static void run68_dump(int argc, char** argv) {
-  static ULong dump_addr = 0;
-  static int size = 32;
+  static THREAD_LOCAL ULong dump_addr = 0;
+  static THREAD_LOCAL int size = 32;
   int i, j;
 
   bool argumentError = false;
@@ -366,17 +366,17 @@ static void run68_dump(int argc, char** argv) {
 
 static void display_registers() {
   int i;
-  printFmt("D0-D7=%08X", rd[0]);
+  printFmt("D0-D7=%08X", cpu.rd[0]);
   for (i = 1; i < 8; i++) {
-    printFmt(",%08X", rd[i]);
+    printFmt(",%08X", cpu.rd[i]);
   }
   print("\n");
-  printFmt("A0-A7=%08X", ra[0]);
+  printFmt("A0-A7=%08X", cpu.ra[0]);
   for (i = 1; i < 8; i++) {
-    printFmt(",%08X", ra[i]);
+    printFmt(",%08X", cpu.ra[i]);
   }
   print("\n");
-  printFmt("  PC=%08X    SR=%04X\n", pc, sr);
+  printFmt("  PC=%08X    SR=%04X\n", cpu.pc, GetSr());
 }
 
 static void set_breakpoint(int argc, char** argv) {
@@ -413,20 +413,20 @@ static void display_history(int argc, char** argv) {
 }
 
 static void display_list(int argc, char** argv) {
-  static Long list_addr = 0;
-  static Long old_pc = 0;
+  static THREAD_LOCAL Long list_addr = 0;
+  static THREAD_LOCAL Long old_pc = 0;
   Long addr, naddr = 0;
   int i, n;
 
   n = 10;
   if (old_pc == 0) {
-    old_pc = pc;
-  } else if (old_pc != pc) {
-    old_pc = pc;
+    old_pc = cpu.pc;
+  } else if (old_pc != cpu.pc) {
+    old_pc = cpu.pc;
     list_addr = 0;
   }
   if (list_addr == 0) {
-    addr = pc;
+    addr = cpu.pc;
   } else {
     addr = list_addr;
   }
@@ -435,7 +435,7 @@ static void display_list(int argc, char** argv) {
       n = (sscanf(argv[1], "%d", &n) == 1) ? n : 10;
     } else if (argc >= 2 && determine_string(argv[1]) == 2) {
       addr = (sscanf(&argv[1][1], "%x", &addr) == 1) ? addr
-             : (list_addr == 0)                      ? pc
+             : (list_addr == 0)                      ? cpu.pc
                                                      : list_addr;
     }
     if (argc == 3 && determine_string(argv[2]) == 1) {
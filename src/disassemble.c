@@ -1374,7 +1374,7 @@ ErrorReturn:
    戻り値：
 */
 char *disassemble(Long addr, Long *next_addr) {
-  static char mnemonic[128], *ptr;
+  static THREAD_LOCAL char mnemonic[128], *ptr;
 
   ptr = NULL;
   *next_addr = addr;
@@ -208,12 +208,15 @@ static Long Read(UWord fileno, ULong buffer, ULong length) {
   // 書き込みモードで開いたファイルでも読み込むことができるので
   // オープンモードは確認しない
 
+  // バッファは大きめに指定されることが多いので、書き込みの記録は
+  // 実際に読み込んだバイト数だけ行う
   Span mem;
-  if (!GetWritableMemoryRangeSuper(buffer, length, &mem))
+  if (!GetReadableMemoryRangeSuper(buffer, length, &mem))
     throwBusErrorOnWrite(buffer);  // バッファアドレスが不正
 
   Long result = readFile(finfop, mem.bufptr, mem.length);
   if (result <= 0) return result;
+  MarkMemoryWritten(buffer, (ULong)result);
   if (length == mem.length) return result;  // バッファが全域有効なら完了
 
   if ((ULong)result < mem.length) {
@@ -322,7 +325,7 @@ Long DosMaketmp(ULong param) {
   ULong path = ReadParamULong(&param);
   UWord atr = ReadParamUWord(&param);
 
-  char* const path_buf = GetStringSuper(path);
+  char* const path_buf = GetWritableStringSuper(path);
   char* const filename = get_filename(path_buf);
   const size_t len = strlen(filename);
   if (len == 0) return DOSE_ILGFNAME;
@@ -25,7 +25,7 @@
 #define MALLOC3_MAX_SIZE 0x7ffffff0
 
 // DOS _MALLOCで確保する対象のメモリ空間。
-static AllocArea allocArea = ALLOC_AREA_MAIN_ONLY;
+static THREAD_LOCAL AllocArea allocArea = ALLOC_AREA_MAIN_ONLY;
 
 static ULong tryMalloc(UByte mode, ULong size, ULong parent, ULong* maxSize);
 static void MfreeAll(ULong psp);
@@ -88,7 +88,7 @@ static Long Write_conv(short hdl, void* buf, size_t size) {
 
 #ifdef USE_ICONV
   if (isatty(fileno(fp))) {
-    static char prev_char = 0;
+    static THREAD_LOCAL char prev_char = 0;
     iconv_t icd = iconv_open("UTF-8", "Shift_JIS");
 
     write_len = 0;
@@ -240,15 +240,15 @@ void close_all_files(void) {
 static bool Exit2(Long exit_code) {
   Mfree(0);
   close_all_files();
-  rd[0] = exit_code;
+  cpu.rd[0] = exit_code;
   if (nest_cnt == 0) {
     return true;
   }
-  sr = mem_get(psp[nest_cnt] + PSP_PARENT_SR, S_WORD);
+  SetSr(mem_get(psp[nest_cnt] + PSP_PARENT_SR, S_WORD));
   Mfree(psp[nest_cnt] + SIZEOF_MEMBLK);
   nest_cnt--;
-  pc = nest_pc[nest_cnt];
-  ra[7] = nest_sp[nest_cnt];
+  cpu.pc = nest_pc[nest_cnt];
+  cpu.ra[7] = nest_sp[nest_cnt];
   return false;
 }
 
@@ -268,14 +268,14 @@ bool dos_call(UByte code) {
 #ifdef _WIN32
   DWORD st;
 #endif
-  Long stack_adr = ra[7];
+  Long stack_adr = cpu.ra[7];
 
   if (settings.traceFunc) {
-    PrintDosCall(code, pc - 2, stack_adr);
+    PrintDosCall(code, cpu.pc - 2, stack_adr);
   }
 
 #ifdef TRACE
-  printf("trace: DOSCALL  0xFF%02X PC=%06lX\n", code, pc);
+  printf("trace: DOSCALL  0xFF%02X PC=%06lX\n", code, cpu.pc);
 #endif
   if (code >= 0x80 && code <= 0xAF) code -= 0x30;
 
@@ -284,7 +284,7 @@ bool dos_call(UByte code) {
 #ifdef _WIN32
       FlushFileBuffers(finfo[1].host.handle);
 #endif
-      rd[0] = (_getche() & 0xFF);
+      cpu.rd[0] = (_getche() & 0xFF);
       break;
     case 0x02: /* PUTCHAR */
     {
@@ -304,7 +304,7 @@ bool dos_call(UByte code) {
 #else
       Write_conv(1, c, 1);
 #endif
-      rd[0] = 0;
+      cpu.rd[0] = 0;
       break;
     }
     case 0x06: /* INPOUT */
@@ -315,7 +315,7 @@ bool dos_call(UByte code) {
         FILEINFO* finfop = &finfo[0];
         INPUT_RECORD ir[3];
         DWORD read_len = 0;
-        rd[0] = 0;
+        cpu.rd[0] = 0;
         PeekConsoleInputA(finfop->host.handle, ir, 1, (LPDWORD)&read_len);
         if (read_len != 0) {
           int keydown =
@@ -327,23 +327,23 @@ bool dos_call(UByte code) {
           // 制限: この方法だと2バイト文字には対応できないので無視している
           if (read_len == 1 && ir[0].EventType == KEY_EVENT &&
               ir[0].Event.KeyEvent.bKeyDown) {
-            rd[0] = (UByte)ir[0].Event.KeyEvent.uChar.AsciiChar;
+            cpu.rd[0] = (UByte)ir[0].Event.KeyEvent.uChar.AsciiChar;
           }
         }
 #else
-        rd[0] = 0;
+        cpu.rd[0] = 0;
         if (kbhit() != 0) {
           c = _getch();
           if (c == 0x00) {
             c = _getch();
           }
           if (srt == 0xFE) ungetch(c);
-          rd[0] = c;
+          cpu.rd[0] = c;
         }
 #endif
       } else {
         putchar(srt);
-        rd[0] = 0;
+        cpu.rd[0] = 0;
       }
       break;
     case 0x07: /* INKEY */
@@ -356,7 +356,7 @@ bool dos_call(UByte code) {
         c = _getch();
         c = 0x1B;
       }
-      rd[0] = c;
+      cpu.rd[0] = c;
       break;
     case 0x09: /* PRINT */
       data_ptr = GetStringSuper(mem_get(stack_adr, S_LONG));
@@ -376,21 +376,21 @@ bool dos_call(UByte code) {
 #else
       Write_conv(1, data_ptr, (unsigned)len);
 #endif
-      rd[0] = 0;
+      cpu.rd[0] = 0;
       break;
     case 0x0A: /* GETS */
       buf = mem_get(stack_adr, S_LONG);
-      rd[0] = Gets(buf);
+      cpu.rd[0] = Gets(buf);
       break;
     case 0x0B: /* KEYSNS */
       if (_kbhit() != 0)
-        rd[0] = -1;
+        cpu.rd[0] = -1;
       else
-        rd[0] = 0;
+        cpu.rd[0] = 0;
       break;
     case 0x0C: /* KFLUSH */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Kflush(srt);
+      cpu.rd[0] = Kflush(srt);
       break;
     case 0x0D: /* FFLUSH */
 #ifdef _WIN32
@@ -401,7 +401,7 @@ bool dos_call(UByte code) {
 #else
       _flushall();
 #endif
-      rd[0] = 0;
+      cpu.rd[0] = 0;
       break;
     case 0x0E: /* CHGDRV */
       srt = (short)mem_get(stack_adr, S_WORD);
@@ -411,14 +411,14 @@ bool dos_call(UByte code) {
         sprintf(drv, "%c:", srt + 'A');
         if (SetCurrentDirectory(drv)) {
           /* When succeeded. */
-          rd[0] = srt;
+          cpu.rd[0] = srt;
         }
       }
 #else
       srt += 1;
       int drv = 0;
       dos_setdrive(srt, &drv);
-      rd[0] = drv;
+      cpu.rd[0] = drv;
 
 #endif
       // Verify
@@ -426,34 +426,34 @@ bool dos_call(UByte code) {
       {
         char drv[512];
         BOOL b = GetCurrentDirectoryA(sizeof(drv), drv);
-        if (b && strlen(drv) != 0 && (drv[0] - 'A') == rd[0]) {
+        if (b && strlen(drv) != 0 && (drv[0] - 'A') == cpu.rd[0]) {
           /* OK, nothing to do. */
         } else {
-          rd[0] = -15; /* ドライブ指定誤り */
+          cpu.rd[0] = -15; /* ドライブ指定誤り */
         }
       }
 #else
       dos_getdrive(&drv);
       srt += 1;
-      if (srt != drv) rd[0] = -15;
+      if (srt != drv) cpu.rd[0] = -15;
 #endif
       break;
     case 0x0F: /* DRVCTRL(何もしない) */
       srt = (short)mem_get(stack_adr, S_WORD);
       if (srt > 26 && srt < 256)
-        rd[0] = -15; /* ドライブ指定誤り */
+        cpu.rd[0] = -15; /* ドライブ指定誤り */
       else
-        rd[0] = 0x02; /* READY */
+        cpu.rd[0] = 0x02; /* READY */
       break;
     case 0x10: /* CONSNS */
       _flushall();
-      rd[0] = -1;
+      cpu.rd[0] = -1;
       break;
     case 0x11: /* PRNSNS */
     case 0x12: /* CINSNS */
     case 0x13: /* COUTSNS */
       _flushall();
-      rd[0] = 0;
+      cpu.rd[0] = 0;
       break;
     case 0x19: /* CURDRV */
 #ifdef _WIN32
@@ -461,23 +461,23 @@ bool dos_call(UByte code) {
       char path[512];
       BOOL b = GetCurrentDirectory(sizeof(path), path);
       if (b && strlen(path) != 0) {
-        rd[0] = path[0] - 'A';
+        cpu.rd[0] = path[0] - 'A';
       } else {
-        rd[0] = -15; /* ドライブ指定誤り */
+        cpu.rd[0] = -15; /* ドライブ指定誤り */
       }
     }
 #else
       dos_getdrive(&drv);
-      rd[0] = drv - 1;
+      cpu.rd[0] = drv - 1;
 #endif
     break;
     case 0x1b:  // FGETC
-      rd[0] = DosFgetc(stack_adr);
+      cpu.rd[0] = DosFgetc(stack_adr);
       break;
     case 0x1C: /* FGETS */
       data = mem_get(stack_adr, S_LONG);
       fhdl = (short)mem_get(stack_adr + 4, S_WORD);
-      rd[0] = Fgets(data, fhdl);
+      cpu.rd[0] = Fgets(data, fhdl);
       break;
     case 0x1D: /* FPUTC */
     {
@@ -489,14 +489,14 @@ bool dos_call(UByte code) {
           (fhdl == 1 || fhdl == 2)) {
         // 非リダイレクトで標準出力か標準エラー出力
         WriteW32(fhdl, finfop->host.handle, c, 1);
-        rd[0] = 0;
+        cpu.rd[0] = 0;
       } else {
         int fail =
             WriteFile(finfop->host.handle, c, 1, (LPDWORD)&len, NULL) == FALSE;
-        rd[0] = fail ? 0 : 1;
+        cpu.rd[0] = fail ? 0 : 1;
       }
 #else
-      rd[0] = (Write_conv(fhdl, c, 1) == EOF) ? 0 : 1;
+      cpu.rd[0] = (Write_conv(fhdl, c, 1) == EOF) ? 0 : 1;
 #endif
       break;
     }
@@ -514,35 +514,35 @@ bool dos_call(UByte code) {
         WriteFile(finfo[fhdl].host.handle, data_ptr, strlen(data_ptr),
                   (LPDWORD)&len, NULL);
       }
-      rd[0] = len;
+      cpu.rd[0] = len;
 #else
       if (Write_conv(fhdl, data_ptr, strlen(data_ptr)) == -1) {
-        rd[0] = 0;
+        cpu.rd[0] = 0;
       } else {
-        rd[0] = strlen(data_ptr);
+        cpu.rd[0] = strlen(data_ptr);
       }
 #endif
       break;
     case 0x1F: /* ALLCLOSE */
       close_all_files();
-      rd[0] = 0;
+      cpu.rd[0] = 0;
       break;
     case 0x20: /* SUPER */
       data = mem_get(stack_adr, S_LONG);
       if (data == 0) {
         /* user -> super */
         if (SR_S_REF() != 0) {
-          rd[0] = -26;
+          cpu.rd[0] = -26;
         } else {
-          rd[0] = ra[7];
-          usp = ra[7];
+          cpu.rd[0] = cpu.ra[7];
+          cpu.usp = cpu.ra[7];
           SR_S_ON();
         }
       } else {
         /* super -> user */
-        ra[7] = data;
-        rd[0] = 0;
-        usp = 0;
+        cpu.ra[7] = data;
+        cpu.rd[0] = 0;
+        cpu.usp = 0;
         SR_S_OFF();
       }
       break;
@@ -550,133 +550,133 @@ bool dos_call(UByte code) {
       srt = (short)mem_get(stack_adr, S_WORD);
       buf = mem_get(stack_adr + 2, S_LONG);
       Fnckey(srt, buf);
-      rd[0] = 0;
+      cpu.rd[0] = 0;
       break;
     case 0x23: /* CONCTRL */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Conctrl(srt, stack_adr + 2);
+      cpu.rd[0] = Conctrl(srt, stack_adr + 2);
       break;
     case 0x24: /* KEYCTRL */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Keyctrl(srt, stack_adr + 2);
+      cpu.rd[0] = Keyctrl(srt, stack_adr + 2);
       break;
     case 0x25: /* INTVCS */
       srt = (short)mem_get(stack_adr, S_WORD);
       data = mem_get(stack_adr + 2, S_LONG);
-      rd[0] = Intvcs(srt, data);
+      cpu.rd[0] = Intvcs(srt, data);
       break;
     case 0x27:  // GETTIM2
-      rd[0] = DosGettim2();
+      cpu.rd[0] = DosGettim2();
       break;
     case 0x28:  // SETTIM2
-      rd[0] = DosSettim2(stack_adr);
+      cpu.rd[0] = DosSettim2(stack_adr);
       break;
     case 0x29: /* NAMESTS */
       data = mem_get(stack_adr, S_LONG);
       buf = mem_get(stack_adr + 4, S_LONG);
-      rd[0] = Namests(data, buf);
+      cpu.rd[0] = Namests(data, buf);
       break;
     case 0x2a:  // GETDATE
-      rd[0] = DosGetdate();
+      cpu.rd[0] = DosGetdate();
       break;
     case 0x2b:  // SETDATE
-      rd[0] = DosSetdate(stack_adr);
+      cpu.rd[0] = DosSetdate(stack_adr);
       break;
     case 0x2c:  // GETTIME
-      rd[0] = DosGettime();
+      cpu.rd[0] = DosGettime();
       break;
     case 0x2d:  // SETTIME
-      rd[0] = DosSettime(stack_adr);
+      cpu.rd[0] = DosSettime(stack_adr);
       break;
     case 0x30:  // VERNUM
-      rd[0] = DosVernum();
+      cpu.rd[0] = DosVernum();
       break;
     case 0x32: /* GETDPB */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = -1;
+      cpu.rd[0] = -1;
       break;
     case 0x33: /* BREAKCK */
-      rd[0] = 1;
+      cpu.rd[0] = 1;
       break;
     case 0x34:     /* DRVXCHG */
-      rd[0] = -15; /* ドライブ指定誤り */
+      cpu.rd[0] = -15; /* ドライブ指定誤り */
       break;
     case 0x35: /* INTVCG */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Intvcg(srt);
+      cpu.rd[0] = Intvcg(srt);
       break;
     case 0x36: /* DSKFRE */
       srt = (short)mem_get(stack_adr, S_WORD);
       buf = mem_get(stack_adr + 2, S_LONG);
-      rd[0] = Dskfre(srt, buf);
+      cpu.rd[0] = Dskfre(srt, buf);
       break;
     case 0x37: /* NAMECK */
       data = mem_get(stack_adr, S_LONG);
       buf = mem_get(stack_adr + 4, S_LONG);
-      rd[0] = Nameck(data, buf);
+      cpu.rd[0] = Nameck(data, buf);
       break;
     case 0x39:  // MKDIR
-      rd[0] = DosMkdir(stack_adr);
+      cpu.rd[0] = DosMkdir(stack_adr);
       break;
     case 0x3a:  // RMDIR
-      rd[0] = DosRmdir(stack_adr);
+      cpu.rd[0] = DosRmdir(stack_adr);
       break;
     case 0x3b:  // CHDIR
-      rd[0] = DosChdir(stack_adr);
+      cpu.rd[0] = DosChdir(stack_adr);
       break;
     case 0x3c:  // CREATE
-      rd[0] = DosCreate(stack_adr);
+      cpu.rd[0] = DosCreate(stack_adr);
       break;
     case 0x3d:  // OPEN
-      rd[0] = DosOpen(stack_adr);
+      cpu.rd[0] = DosOpen(stack_adr);
       break;
     case 0x3E: /* CLOSE */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Close(srt);
+      cpu.rd[0] = Close(srt);
       break;
     case 0x3f:  // READ
-      rd[0] = DosRead(stack_adr);
+      cpu.rd[0] = DosRead(stack_adr);
       break;
     case 0x40: /* WRITE */
       srt = (short)mem_get(stack_adr, S_WORD);
       data = mem_get(stack_adr + 2, S_LONG);
       len = mem_get(stack_adr + 6, S_LONG);
-      rd[0] = Write(srt, data, len);
+      cpu.rd[0] = Write(srt, data, len);
       break;
     case 0x41: /* DELETE */
       data = mem_get(stack_adr, S_LONG);
-      rd[0] = Delete(GetStringSuper(data));
+      cpu.rd[0] = Delete(GetStringSuper(data));
       break;
     case 0x42:  // SEEK
-      rd[0] = DosSeek(stack_adr);
+      cpu.rd[0] = DosSeek(stack_adr);
       break;
     case 0x43:  // CHMOD
-      rd[0] = DosChmod(stack_adr);
+      cpu.rd[0] = DosChmod(stack_adr);
       break;
     case 0x44: /* IOCTRL */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Ioctrl(srt, stack_adr + 2);
+      cpu.rd[0] = Ioctrl(srt, stack_adr + 2);
       break;
     case 0x45: /* DUP */
       fhdl = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Dup(fhdl);
+      cpu.rd[0] = Dup(fhdl);
       break;
     case 0x46: /* DUP2 */
       srt = (short)mem_get(stack_adr, S_WORD);
       fhdl = (short)mem_get(stack_adr + 2, S_WORD);
-      rd[0] = Dup2(srt, fhdl);
+      cpu.rd[0] = Dup2(srt, fhdl);
       break;
     case 0x47:  // CURDIR
-      rd[0] = DosCurdir(stack_adr);
+      cpu.rd[0] = DosCurdir(stack_adr);
       break;
     case 0x48:  // MALLOC
-      rd[0] = DosMalloc(stack_adr);
+      cpu.rd[0] = DosMalloc(stack_adr);
       break;
     case 0x49:  // MFREE
-      rd[0] = DosMfree(stack_adr);
+      cpu.rd[0] = DosMfree(stack_adr);
       break;
     case 0x4a:  // SETBLOCK
-      rd[0] = DosSetblock(stack_adr);
+      cpu.rd[0] = DosSetblock(stack_adr);
       break;
     case 0x4B: /* EXEC */
       srt = (short)mem_get(stack_adr, S_WORD);
@@ -688,16 +688,16 @@ bool dos_call(UByte code) {
       }
       switch (srt) {
         case 0:
-          rd[0] = Exec01(data, buf, len, 0);
+          cpu.rd[0] = Exec01(data, buf, len, 0);
           break;
         case 1:
-          rd[0] = Exec01(data, buf, len, 1);
+          cpu.rd[0] = Exec01(data, buf, len, 1);
           break;
         case 2:
-          rd[0] = Exec2(data, buf, len);
+          cpu.rd[0] = Exec2(data, buf, len);
           break;
         case 3:
-          rd[0] = Exec3(data, buf, len);
+          cpu.rd[0] = Exec3(data, buf, len);
           break;
         case 4:
           Exec4(data);
@@ -711,67 +711,67 @@ bool dos_call(UByte code) {
       buf = mem_get(stack_adr, S_LONG);
       data = mem_get(stack_adr + 4, S_LONG);
       srt = (short)mem_get(stack_adr + 8, S_WORD);
-      rd[0] = Files(buf, data, srt);
+      cpu.rd[0] = Files(buf, data, srt);
       break;
     case 0x4F: /* NFILES */
       buf = mem_get(stack_adr, S_LONG);
-      rd[0] = Nfiles(buf);
+      cpu.rd[0] = Nfiles(buf);
       break;
     case 0x51: /* GETPDB */
-      rd[0] = psp[nest_cnt] + SIZEOF_MEMBLK;
+      cpu.rd[0] = psp[nest_cnt] + SIZEOF_MEMBLK;
       break;
     case 0x53:  // GETENV
-      rd[0] = DosGetenv(stack_adr);
+      cpu.rd[0] = DosGetenv(stack_adr);
       break;
     case 0x54: /* VERIFYG */
-      rd[0] = 1;
+      cpu.rd[0] = 1;
       break;
     case 0x56: /* RENAME */
       data = mem_get(stack_adr, S_LONG);
       buf = mem_get(stack_adr + 4, S_LONG);
-      rd[0] = Rename(data, buf);
+      cpu.rd[0] = Rename(data, buf);
       break;
     case 0x57:  // FILEDATE
-      rd[0] = DosFiledate(stack_adr);
+      cpu.rd[0] = DosFiledate(stack_adr);
       break;
     case 0x58:  // MALLOC2
-      rd[0] = DosMalloc2(stack_adr);
+      cpu.rd[0] = DosMalloc2(stack_adr);
       break;
     case 0x5a:  // MAKETMP
-      rd[0] = DosMaketmp(stack_adr);
+      cpu.rd[0] = DosMaketmp(stack_adr);
       break;
     case 0x5b:  // NEWFILE
-      rd[0] = DosNewfile(stack_adr);
+      cpu.rd[0] = DosNewfile(stack_adr);
       break;
     case 0x5F: /* ASSIGN */
       srt = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Assign(srt, stack_adr + 2);
+      cpu.rd[0] = Assign(srt, stack_adr + 2);
       break;
     case 0x60:
-      rd[0] = DosMalloc3(stack_adr);
+      cpu.rd[0] = DosMalloc3(stack_adr);
       break;
     case 0x61:
-      rd[0] = DosSetblock2(stack_adr);
+      cpu.rd[0] = DosSetblock2(stack_adr);
       break;
     case 0x62:
-      rd[0] = DosMalloc4(stack_adr);
+      cpu.rd[0] = DosMalloc4(stack_adr);
       break;
     case 0x7C: /* GETFCB */
       fhdl = (short)mem_get(stack_adr, S_WORD);
-      rd[0] = Getfcb(fhdl);
+      cpu.rd[0] = Getfcb(fhdl);
       break;
     case 0xF6: /* SUPER_JSR */
       data = mem_get(stack_adr, S_LONG);
-      ra[7] -= 4;
-      mem_set(ra[7], pc, S_LONG);
+      cpu.ra[7] -= 4;
+      mem_set(cpu.ra[7], cpu.pc, S_LONG);
       if (SR_S_REF() == 0) {
-        superjsr_ret = pc;
+        superjsr_ret = cpu.pc;
         SR_S_ON();
       }
-      pc = data;
+      cpu.pc = data;
       break;
     case 0xf7:  // BUS_ERR
-      rd[0] = DosBusErr(stack_adr);
+      cpu.rd[0] = DosBusErr(stack_adr);
       break;
 
     case 0x4C: /* EXIT2 */
@@ -791,15 +791,15 @@ bool dos_call(UByte code) {
 
       Setblock(psp[nest_cnt] + SIZEOF_MEMBLK, len + SIZEOF_PSP - SIZEOF_MEMBLK);
       mem_set(psp[nest_cnt] + MEMBLK_PARENT, 0xFF, S_BYTE);
-      sr = (short)mem_get(psp[nest_cnt] + PSP_PARENT_SR, S_WORD);
+      SetSr((short)mem_get(psp[nest_cnt] + PSP_PARENT_SR, S_WORD));
       nest_cnt--;
-      pc = nest_pc[nest_cnt];
-      ra[7] = nest_sp[nest_cnt];
-      rd[0] = exit_code;
+      cpu.pc = nest_pc[nest_cnt];
+      cpu.ra[7] = nest_sp[nest_cnt];
+      cpu.rd[0] = exit_code;
     } break;
 
     default:
-      rd[0] = DOSE_ILGFNC;
+      cpu.rd[0] = DOSE_ILGFNC;
       break;
   }
   return false;
@@ -1760,7 +1760,7 @@ static Long Assign(short mode, Long stack_adr) {
  戻り値：FCBのアドレス
  */
 static Long Getfcb(short fhdl) {
-  static unsigned char fcb[4][SIZEOF_FCB] = {
+  static const unsigned char fcb[4][SIZEOF_FCB] = {
       {0x01, 0xC1, 0x00, 0x02, 0xC6, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -1806,8 +1806,8 @@ static Long Getfcb(short fhdl) {
       memcpy(mem.bufptr, fcb[fhdl], SIZEOF_FCB);
       return adr;
     default:
-      fcb[3][14] = (unsigned char)fhdl;
       memcpy(mem.bufptr, fcb[3], SIZEOF_FCB);
+      mem.bufptr[14] = (char)fhdl;
       return adr;
   }
 }
@@ -1864,7 +1864,8 @@ static Long Exec01(ULong nm, Long cmd, Long env, int md) {
   Long prog_size = 0;
   Long prog_size2 = end_adr;
   const Long entryAddress = prog_read(fp, fname, childPsp + SIZEOF_PSP,
-                                      &prog_size, &prog_size2, NULL, execType);
+                                      &prog_size, &prog_size2, NULL, execType,
+                                      false);
   if (entryAddress < 0) {
     Mfree(child.address);
     return entryAddress;
@@ -1874,24 +1875,24 @@ static Long Exec01(ULong nm, Long cmd, Long env, int md) {
       (env == 0) ? mem_get(psp[nest_cnt] + PSP_ENV_PTR, S_LONG) : env;
 
   const ProgramSpec progSpec = {prog_size2, prog_size - prog_size2};
-  BuildPsp(childPsp, envptr, cmd, sr, parentPsp, &progSpec, &hpn);
-
-  nest_pc[nest_cnt] = pc;
-  nest_sp[nest_cnt] = ra[7];
-  ra[0] = childPsp;
-  ra[1] = childPsp + SIZEOF_PSP + prog_size;
-  ra[2] = cmd;
-  ra[3] = envptr;
-  ra[4] = entryAddress;
+  BuildPsp(childPsp, envptr, cmd, GetSr(), parentPsp, &progSpec, &hpn);
+
+  nest_pc[nest_cnt] = cpu.pc;
+  nest_sp[nest_cnt] = cpu.ra[7];
+  cpu.ra[0] = childPsp;
+  cpu.ra[1] = childPsp + SIZEOF_PSP + prog_size;
+  cpu.ra[2] = cmd;
+  cpu.ra[3] = envptr;
+  cpu.ra[4] = entryAddress;
   nest_cnt++;
   psp[nest_cnt] = childPsp;
 
   if (md == 0) {
-    pc = ra[4];
-    return rd[0];
+    cpu.pc = cpu.ra[4];
+    return cpu.rd[0];
   }
   nest_cnt--;
-  return ra[4];
+  return cpu.ra[4];
 }
 
 /*
@@ -1899,16 +1900,16 @@ static Long Exec01(ULong nm, Long cmd, Long env, int md) {
  戻り値：エラーコード
  */
 static Long Exec2(Long nm, Long cmd, Long env) {
-  char* name_ptr = GetStringSuper(nm);
-  char* cmd_ptr = GetStringSuper(cmd);
+  char* name_ptr = GetWritableStringSuper(nm);
+  GetStringSuper(cmd);  // コマンドラインのアドレスを確認する
 
   char* p = name_ptr;
   while (*p != '\0' && *p != ' ') p++;
   if (*p != '\0') { /* コマンドラインあり */
     *p = '\0';
     p++;
-    *cmd_ptr = strlen(p);
-    strcpy(cmd_ptr + 1, p);
+    WriteUByteSuper(cmd, (UByte)strlen(p));
+    WriteStringSuper(cmd + 1, p);
   }
 
   /* 環境変数pathに従ってファイルを検索し、オープンする。*/
@@ -1940,8 +1941,8 @@ static Long Exec3(ULong nm, Long adr1, Long adr2) {
 
   Long prog_size;
   Long prog_size2 = adr2;
-  Long ret =
-      prog_read(fp, fname, adr1, &prog_size, &prog_size2, NULL, execType);
+  Long ret = prog_read(fp, fname, adr1, &prog_size, &prog_size2, NULL,
+                       execType, false);
   if (ret < 0) return (ret);
 
   return (prog_size);
@@ -1952,10 +1953,10 @@ static Long Exec3(ULong nm, Long adr1, Long adr2) {
  戻り値：エラーコード等
  */
 static void Exec4(Long adr) {
-  nest_pc[nest_cnt] = pc;
-  nest_sp[nest_cnt] = ra[7];
+  nest_pc[nest_cnt] = cpu.pc;
+  nest_sp[nest_cnt] = cpu.ra[7];
   nest_cnt++;
-  pc = adr;
+  cpu.pc = adr;
 }
 
 /*
@@ -19,53 +19,10 @@
 
 #include <stdbool.h>
 
+#include "eaaccess.h"
 #include "operate.h"
 #include "run68.h"
 
-/*
- 　機能：アドレスレジスタをインクリメントする
- 戻り値：なし
-*/
-static inline void inc_ra(int reg, int size) {
-  if (reg == 7 && size == S_BYTE) size = S_WORD;
-
-  // S_BYTE -> 1, S_WORD -> 2, S_LONG -> 4
-  ra[reg] += (1 << size);
-}
-
-/*
- 　機能：アドレスレジスタをデクリメントする
- 戻り値：なし
-*/
-static inline void dec_ra(int reg, int size) {
-  if (reg == 7 && size == S_BYTE) size = S_WORD;
-
-  // S_BYTE -> 1, S_WORD -> 2, S_LONG -> 4
-  ra[reg] -= (1 << size);
-}
-
-/*
- 　機能：PCの指すメモリからインデックスレジスタ＋8ビットディスプレースメント
- 　　　　の値を得る
- 戻り値：その値
-*/
-static Long idx_get(void) {
-  UWord w = (UWord)mem_get(pc, S_WORD);
-
-  // Brief Extension Word Format
-  //   D/A | REG | REG | REG | W/L | SCALE | SCALE | 0
-  //   M68000ではSCALEは無効、最下位ビットが1でもBrief Formatとして解釈される。
-  UByte ext = (UByte)(w >> 8);
-  Byte disp8 = (Byte)w;
-  pc += 2;
-
-  int idx_reg = ((ext >> 4) & 0x07);
-  Long idx = (ext & 0x80) ? ra[idx_reg] : rd[idx_reg];
-  if ((ext & 0x08) == 0) idx = extl((Word)idx);  // Sign-Extended Word
-
-  return idx + extbl(disp8);
-}
-
 /*
  * 【説明】
  *   実効アドレスを取得する。
@@ -87,7 +44,7 @@ static Long idx_get(void) {
  */
 bool get_ea(Long save_pc, int AceptAdrMode, int mode, int reg, Long *data) {
   /* 操作しやすいようにモードを統合 */
-  int gmode = (mode < 7) ? mode : (7 + reg); /* gmode = 0-11 */
+  int gmode = GetEaMode(mode, reg); /* gmode = 0-11 */
 
   /* AceptAdrMode で許されたアドレッシングモードでなければエラー */
   if ((AceptAdrMode & (1 << gmode)) == 0) {
@@ -97,13 +54,13 @@ bool get_ea(Long save_pc, int AceptAdrMode, int mode, int reg, Long *data) {
   /* アドレッシングモードに応じた処理 */
   switch (gmode) {
     case EA_AI:
-      *data = ra[reg];
+      *data = cpu.ra[reg];
       break;
     case EA_AID:
-      *data = ra[reg] + extl(imi_get_word());
+      *data = cpu.ra[reg] + extl(imi_get_word());
       break;
     case EA_AIX:
-      *data = ra[reg] + idx_get();
+      *data = cpu.ra[reg] + idx_get();
       break;
     case EA_SRT:
       *data = extl(imi_get_word());
@@ -142,10 +99,8 @@ bool get_ea(Long save_pc, int AceptAdrMode, int mode, int reg, Long *data) {
  *
  */
 bool get_data_at_ea(int AceptAdrMode, int mode, int reg, int size, Long *data) {
-  Long save_pc = pc;
-
   /* 操作しやすいようにモードを統合 */
-  int gmode = mode < 7 ? mode : 7 + reg; /* gmode = 0-11 */
+  int gmode = GetEaMode(mode, reg); /* gmode = 0-11 */
 
   /* AceptAdrMode で許されたアドレッシングモードでなければエラー */
   if ((AceptAdrMode & (1 << gmode)) == 0) {
@@ -153,68 +108,7 @@ bool get_data_at_ea(int AceptAdrMode, int mode, int reg, int size, Long *data) {
   }
 
   /* アドレッシングモードに応じた処理 */
-  switch (gmode) {
-    case EA_DD:
-      switch (size) {
-        case S_BYTE:
-          *data = (rd[reg] & 0xFF);
-          break;
-        case S_WORD:
-          *data = (rd[reg] & 0xFFFF);
-          break;
-        case S_LONG:
-          *data = rd[reg];
-          break;
-      }
-      break;
-    case EA_AD:
-      switch (size) {
-        case S_BYTE:
-          *data = (ra[reg] & 0xFF);
-          break;
-        case S_WORD:
-          *data = (ra[reg] & 0xFFFF);
-          break;
-        case S_LONG:
-          *data = ra[reg];
-          break;
-      }
-      break;
-    case EA_AI:
-      *data = mem_get(ra[reg], (char)size);
-      break;
-    case EA_AIPI:
-      *data = mem_get(ra[reg], (char)size);
-      inc_ra(reg, (char)size);
-      break;
-    case EA_AIPD:
-      dec_ra(reg, (char)size);
-      *data = mem_get(ra[reg], (char)size);
-      break;
-    case EA_AID:
-      *data = mem_get(ra[reg] + extl(imi_get_word()), (char)size);
-      break;
-    case EA_AIX:
-      *data = mem_get(ra[reg] + idx_get(), (char)size);
-      break;
-    case EA_SRT:
-      *data = mem_get(extl(imi_get_word()), (char)size);
-      break;
-    case EA_LNG:
-      *data = mem_get(imi_get(S_LONG), (char)size);
-      break;
-    case EA_PC:
-      *data = mem_get(save_pc + extl(imi_get_word()), (char)size);
-      break;
-    case EA_PCX:
-      *data = mem_get(save_pc + idx_get(), (char)size);
-      break;
-    case EA_IM:
-      *data = imi_get((char)size);
-      break;
-    default:
-      err68a("アドレッシングモードが異常です。", __FILE__, __LINE__);
-  }
+  *data = ReadEa(gmode, reg, size);
 
   return false;
 }
@@ -238,10 +132,8 @@ bool get_data_at_ea(int AceptAdrMode, int mode, int reg, int size, Long *data) {
  *
  */
 bool set_data_at_ea(int AceptAdrMode, int mode, int reg, int size, Long data) {
-  Long save_pc = pc;
-
   /* 操作しやすいようにモードを統合 */
-  int gmode = mode < 7 ? mode : 7 + reg; /* gmode = 0-11 */
+  int gmode = GetEaMode(mode, reg); /* gmode = 0-11 */
 
   /* AceptAdrMode で許されたアドレッシングモードでなければエラー */
 
@@ -250,65 +142,7 @@ bool set_data_at_ea(int AceptAdrMode, int mode, int reg, int size, Long data) {
   }
 
   /* ディスティネーションのアドレッシングモードに応じた処理 */
-  switch (gmode) {
-    case EA_DD:
-      switch (size) {
-        case S_BYTE:
-          rd[reg] = (rd[reg] & 0xFFFFFF00) | (data & 0xFF);
-          break;
-        case S_WORD:
-          rd[reg] = (rd[reg] & 0xFFFF0000) | (data & 0xFFFF);
-          break;
-        case S_LONG:
-          rd[reg] = data;
-          break;
-      }
-      break;
-    case EA_AD:
-      switch (size) {
-        case S_BYTE:
-          ra[reg] = (ra[reg] & 0xFFFFFF00) | (data & 0xFF);
-          break;
-        case S_WORD:
-          ra[reg] = (ra[reg] & 0xFFFF0000) | (data & 0xFFFF);
-          break;
-        case S_LONG:
-          ra[reg] = data;
-          break;
-      }
-      break;
-    case EA_AI:
-      mem_set(ra[reg], data, (char)size);
-      break;
-    case EA_AIPI:
-      mem_set(ra[reg], data, (char)size);
-      inc_ra(reg, (char)size);
-      break;
-    case EA_AIPD:
-      dec_ra(reg, (char)size);
-      mem_set(ra[reg], data, (char)size);
-      break;
-    case EA_AID:
-      mem_set(ra[reg] + extl(imi_get_word()), data, (char)size);
-      break;
-    case EA_AIX:
-      mem_set(ra[reg] + idx_get(), data, (char)size);
-      break;
-    case EA_SRT:
-      mem_set(extl(imi_get_word()), data, (char)size);
-      break;
-    case EA_LNG:
-      mem_set(imi_get(S_LONG), data, (char)size);
-      break;
-    case EA_PC:
-      mem_set(save_pc + extl(imi_get_word()), data, (char)size);
-      break;
-    case EA_PCX:
-      mem_set(save_pc + idx_get(), data, (char)size);
-      break;
-    default:
-      err68a("アドレッシングモードが異常です。", __FILE__, __LINE__);
-  }
+  WriteEa(gmode, reg, size, data);
 
   return false;
 }
@@ -334,9 +168,9 @@ bool set_data_at_ea(int AceptAdrMode, int mode, int reg, int size, Long data) {
  */
 bool get_data_at_ea_noinc(int AceptAdrMode, int mode, int reg, int size,
                           Long *data) {
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
   bool retcode = get_data_at_ea(AceptAdrMode, mode, reg, size, data);
-  pc = save_pc;
+  cpu.pc = save_pc;
   return retcode;
 }
 
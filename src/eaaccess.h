@@ -0,0 +1,233 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#ifndef EAACCESS_H
+#define EAACCESS_H
+
+#include "operate.h"
+#include "run68.h"
+
+// 実効アドレスのアクセス
+//   アドレッシングモード(EA_*)とサイズに定数を指定して呼び出せば、
+//   インライン展開によりそのモードとサイズ専用の処理になる。
+//   アドレッシングモードが使用可能かどうかは呼び出し側で確認しておくこと。
+
+// 命令のモードとレジスタのフィールドをEA_*に統合する。
+static inline int GetEaMode(int mode, int reg) {
+  return (mode < 7) ? mode : (7 + reg);
+}
+
+// データを指すアドレッシングモード(EA_Data)の一覧
+//   X(arg, DD)のように展開される(X-macro)。
+#define EA_DATA_MODE_LIST(X, arg) \
+  X(arg, DD)                      \
+  EA_DATA_MODE_LIST_WITHOUT_DD(X, arg)
+
+#define EA_DATA_MODE_LIST_WITHOUT_DD(X, arg) \
+  X(arg, AI)                                 \
+  X(arg, AIPI)                               \
+  X(arg, AIPD)                               \
+  X(arg, AID)                                \
+  X(arg, AIX)                                \
+  X(arg, SRT)                                \
+  X(arg, LNG)                                \
+  X(arg, PC)                                 \
+  X(arg, PCX)                                \
+  X(arg, IM)
+
+// 全てのアドレッシングモード(EA_All)の一覧
+#define EA_ALL_MODE_LIST(X, arg) \
+  X(arg, DD)                     \
+  X(arg, AD)                     \
+  EA_DATA_MODE_LIST_WITHOUT_DD(X, arg)
+
+/*
+ 　機能：アドレスレジスタをインクリメントする
+ 戻り値：なし
+*/
+static inline void inc_ra(int reg, int size) {
+  if (reg == 7 && size == S_BYTE) size = S_WORD;
+
+  // S_BYTE -> 1, S_WORD -> 2, S_LONG -> 4
+  cpu.ra[reg] += (1 << size);
+}
+
+/*
+ 　機能：アドレスレジスタをデクリメントする
+ 戻り値：なし
+*/
+static inline void dec_ra(int reg, int size) {
+  if (reg == 7 && size == S_BYTE) size = S_WORD;
+
+  // S_BYTE -> 1, S_WORD -> 2, S_LONG -> 4
+  cpu.ra[reg] -= (1 << size);
+}
+
+/*
+ 　機能：PCの指すメモリからインデックスレジスタ＋8ビットディスプレースメント
+ 　　　　の値を得る
+ 戻り値：その値
+*/
+static inline Long idx_get(void) {
+  UWord w = (UWord)imi_get(S_WORD);
+
+  // Brief Extension Word Format
+  //   D/A | REG | REG | REG | W/L | SCALE | SCALE | 0
+  //   M68000ではSCALEは無効、最下位ビットが1でもBrief Formatとして解釈される。
+  UByte ext = (UByte)(w >> 8);
+  Byte disp8 = (Byte)w;
+
+  int idx_reg = ((ext >> 4) & 0x07);
+  Long idx = (ext & 0x80) ? cpu.ra[idx_reg] : cpu.rd[idx_reg];
+  if ((ext & 0x08) == 0) idx = extl((Word)idx);  // Sign-Extended Word
+
+  return idx + extbl(disp8);
+}
+
+// メモリを指すアドレッシングモードの実効アドレスを計算する。
+//   (An)+、-(An)のアドレスレジスタの増減は行わない。
+static inline Long CalcEaAddress(int gmode, int reg) {
+  Long save_pc = cpu.pc;
+
+  switch (gmode) {
+    default:  // EA_AI, EA_AIPI, EA_AIPD
+      return cpu.ra[reg];
+    case EA_AID:
+      return cpu.ra[reg] + extl(imi_get_word());
+    case EA_AIX:
+      return cpu.ra[reg] + idx_get();
+    case EA_SRT:
+      return extl(imi_get_word());
+    case EA_LNG:
+      return imi_get(S_LONG);
+    case EA_PC:
+      return save_pc + extl(imi_get_word());
+    case EA_PCX:
+      return save_pc + idx_get();
+  }
+}
+
+// 実効アドレスで示された値を取得する。
+static inline Long ReadEa(int gmode, int reg, int size) {
+  Long data;
+
+  switch (gmode) {
+    case EA_DD:
+      switch (size) {
+        case S_BYTE:
+          return cpu.rd[reg] & 0xFF;
+        case S_WORD:
+          return cpu.rd[reg] & 0xFFFF;
+        default:  // S_LONG
+          return cpu.rd[reg];
+      }
+    case EA_AD:
+      switch (size) {
+        case S_BYTE:
+          return cpu.ra[reg] & 0xFF;
+        case S_WORD:
+          return cpu.ra[reg] & 0xFFFF;
+        default:  // S_LONG
+          return cpu.ra[reg];
+      }
+    case EA_AIPI:
+      data = mem_get(cpu.ra[reg], (char)size);
+      inc_ra(reg, size);
+      return data;
+    case EA_AIPD:
+      dec_ra(reg, size);
+      return mem_get(cpu.ra[reg], (char)size);
+    case EA_IM:
+      return imi_get((char)size);
+    case EA_AI:
+    case EA_AID:
+    case EA_AIX:
+    case EA_SRT:
+    case EA_LNG:
+    case EA_PC:
+    case EA_PCX:
+      return mem_get(CalcEaAddress(gmode, reg), (char)size);
+    default:
+      err68a("アドレッシングモードが異常です。", __FILE__, __LINE__);
+  }
+}
+
+// 与えられたデータを実効アドレスで示された場所に設定する。
+static inline void WriteEa(int gmode, int reg, int size, Long data) {
+  switch (gmode) {
+    case EA_DD:
+      SetDreg(reg, data, size);
+      return;
+    case EA_AD:
+      switch (size) {
+        case S_BYTE:
+          cpu.ra[reg] = (cpu.ra[reg] & 0xFFFFFF00) | (data & 0xFF);
+          return;
+        case S_WORD:
+          cpu.ra[reg] = (cpu.ra[reg] & 0xFFFF0000) | (data & 0xFFFF);
+          return;
+        default:  // S_LONG
+          cpu.ra[reg] = data;
+          return;
+      }
+    case EA_AIPI:
+      mem_set(cpu.ra[reg], data, (char)size);
+      inc_ra(reg, size);
+      return;
+    case EA_AIPD:
+      dec_ra(reg, size);
+      mem_set(cpu.ra[reg], data, (char)size);
+      return;
+    case EA_AI:
+    case EA_AID:
+    case EA_AIX:
+    case EA_SRT:
+    case EA_LNG:
+    case EA_PC:
+    case EA_PCX:
+      mem_set(CalcEaAddress(gmode, reg), data, (char)size);
+      return;
+    default:
+      err68a("アドレッシングモードが異常です。", __FILE__, __LINE__);
+  }
+}
+
+// 読み込んだ値を演算して同じ場所に書き込む命令のオペランドを読み込む。
+//   メモリなら*adrにアドレスを返すので、WriteModifiedEa()に渡して書き込む。
+//   拡張ワードは1回だけ読み込む。-(An)はここでデクリメントし、
+//   (An)+は書き込み時にインクリメントする。
+static inline Long ReadModifyEa(int gmode, int reg, int size, Long* adr) {
+  if (gmode == EA_DD) return ReadEa(EA_DD, reg, size);
+
+  if (gmode == EA_AIPD) dec_ra(reg, size);
+  *adr = CalcEaAddress(gmode, reg);
+  return mem_get(*adr, (char)size);
+}
+
+// ReadModifyEa()で読み込んだ場所に値を書き込む。
+static inline void WriteModifiedEa(int gmode, int reg, int size, Long adr,
+                                   Long data) {
+  if (gmode == EA_DD) {
+    SetDreg(reg, data, size);
+    return;
+  }
+
+  mem_set(adr, data, (char)size);
+  if (gmode == EA_AIPI) inc_ra(reg, size);
+}
+
+#endif
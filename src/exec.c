@@ -20,83 +20,128 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "blockcache.h"
 #include "mem.h"
 #include "operate.h"
 #include "run68.h"
 
 NORETURN void run68_abort(Long adr);
 
-static bool linea(char *pc_ptr) {
+// 命令ハンドラテーブル(命令コード$0000～$ffffに対応)
+static InstructionHandler instructionTable[0x10000];
+
+static bool Linea(char code1, char code2) {
+  cpu.pc -= 2;  // 呼び出し元で pc += 2; しているので戻す
+
   short save_s = SR_S_REF();
   SR_S_ON();
 
   ULong adr = mem_get(VECNO_ALINE * 4, S_LONG);
   if (adr != DefaultExceptionHandler[VECNO_ALINE]) {
-    ra[7] -= 4;
-    mem_set(ra[7], pc, S_LONG);
-    ra[7] -= 2;
-    mem_set(ra[7], sr, S_WORD);
-    pc = adr;
+    cpu.ra[7] -= 4;
+    mem_set(cpu.ra[7], cpu.pc, S_LONG);
+    cpu.ra[7] -= 2;
+    mem_set(cpu.ra[7], GetSr(), S_WORD);
+    cpu.pc = adr;
     return false;
   }
 
   if (save_s == 0) SR_S_OFF();
-  pc += 2;
+  cpu.pc += 2;
   err68("A系列割り込みを実行しました");
 }
 
-/*
- 　機能：1命令実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-bool prog_exec() {
-  Span mem = GetReadableMemory(pc, 2);
-  if (!mem.bufptr) {
-    err68("命令読み込み時にバスエラーが発生しました");
-    return true;
-  }
-  char *pc_ptr = mem.bufptr;
+static bool Illegal(char code1, char code2) { return IllegalInstruction(); }
 
+// 命令コードに対応する命令ハンドラを得る
+static InstructionHandler decodeInstruction(char code1, char code2) {
   /* 上位4ビットで命令を振り分ける */
-  switch (*pc_ptr >> 4) {
+  switch (code1 >> 4) {
     case 0x0:
-      return (line0(pc_ptr));
+      return decodeLine0(code1, code2);
     case 0x1:
     case 0x2:
     case 0x3:
-      return (line2(pc_ptr));
+      return decodeLine2(code1, code2);
     case 0x4:
-      return (line4(pc_ptr));
+      return decodeLine4(code1, code2);
     case 0x5:
-      return (line5(pc_ptr));
+      return decodeLine5(code1, code2);
     case 0x6:
-      return (line6(pc_ptr));
+      return decodeLine6(code1, code2);
     case 0x7:
-      return (line7(pc_ptr));
+      return decodeLine7(code1, code2);
     case 0x8:
-      return (line8(pc_ptr));
+      return decodeLine8(code1, code2);
     case 0x9:
-      return (line9(pc_ptr));
+      return decodeLine9(code1, code2);
     case 0xA:
-      return (linea(pc_ptr));
+      return Linea;
     case 0xB:
-      return (lineb(pc_ptr));
+      return decodeLineB(code1, code2);
     case 0xC:
-      return (linec(pc_ptr));
+      return decodeLineC(code1, code2);
     case 0xD:
-      return (lined(pc_ptr));
+      return decodeLineD(code1, code2);
     case 0xE:
-      return (linee(pc_ptr));
+      return decodeLineE(code1, code2);
     case 0xF:
-      return (linef(pc_ptr));
+      return decodeLineF(code1, code2);
 
     default:
       break;
   }
 
   // not reached
-  return false;
+  return NULL;
+}
+
+// 命令ハンドラテーブルを作成する
+void InitInstructionTable(void) {
+  for (ULong code = 0; code < 0x10000; code += 1) {
+    InstructionHandler handler =
+        decodeInstruction((char)(code >> 8), (char)code);
+    instructionTable[code] = handler ? handler : Illegal;
+  }
+}
+
+// 命令コードに対応する命令ハンドラを得る
+InstructionHandler GetInstructionHandler(UWord code) {
+  return instructionTable[code];
+}
+
+// 直後に条件分岐命令が続く場合に使う、融合した命令ハンドラを得る
+//   NULLなら融合できない命令。
+InstructionHandler GetFusedInstructionHandler(UWord code) {
+  InstructionHandler handler = instructionTable[code];
+
+  switch (code >> 12) {
+    case 0x4:
+      return fuseLine4(handler);
+    case 0x5:
+      return fuseLine5(handler);
+    case 0xb:
+      return fuseLineB(handler);
+    default:
+      return NULL;
+  }
+}
+
+/*
+ 　機能：1命令実行する
+ 戻り値： true = 実行終了
+         false = 実行継続
+*/
+bool prog_exec() {
+  const DecodedInstruction* inst = FetchInstruction();
+  if (!inst) {
+    err68("命令読み込み時にバスエラーが発生しました");
+    return true;
+  }
+  UWord code = inst->code;
+  cpu.pc += 2;
+
+  return inst->handler((char)(code >> 8), (char)code);
 }
 
 /*
@@ -174,10 +219,11 @@ static int begin_undefined(const char *s) {
 */
 void err68(const char *mes) {
   OPBuf_insert(&OP_info);
-  printFmt("run68 exec error: %s PC=%06X\n", mes, pc);
-  if (begin_undefined(mes)) printFmt("code = %08X\n", mem_get(pc - 4, S_LONG));
+  printFmt("run68 exec error: %s PC=%06X\n", mes, cpu.pc);
+  if (begin_undefined(mes))
+    printFmt("code = %08X\n", mem_get(cpu.pc - 4, S_LONG));
   OPBuf_display(10);
-  run68_abort(pc);
+  run68_abort(cpu.pc);
 }
 
 /*
@@ -189,11 +235,12 @@ void err68(const char *mes) {
 */
 void err68a(const char *mes, char *file, int line) {
   OPBuf_insert(&OP_info);
-  printFmt("run68 exec error: %s PC=%06X\n", mes, pc);
+  printFmt("run68 exec error: %s PC=%06X\n", mes, cpu.pc);
   printFmt("\tAt %s:%d\n", file, line);
-  if (begin_undefined(mes)) printFmt("code = %08X\n", mem_get(pc - 4, S_LONG));
+  if (begin_undefined(mes))
+    printFmt("code = %08X\n", mem_get(cpu.pc - 4, S_LONG));
   OPBuf_display(10);
-  run68_abort(pc);
+  run68_abort(cpu.pc);
 }
 
 /*
@@ -213,27 +260,27 @@ void err68b(char *mes, Long pc, Long ppc) {
 }
 
 bool IllegalInstruction(void) {
-  pc -= 2;  // 呼び出し元で pc += 2; しているので戻す
+  cpu.pc -= 2;  // 呼び出し元で pc += 2; しているので戻す
 
   ULong vec = ReadULongSuper(VECNO_ILLEGAL * 4);
   if (DefaultExceptionHandler[VECNO_ILLEGAL] != vec) {
-    UWord saveSr = sr;
+    UWord saveSr = GetSr();
     SR_S_ON();
-    ra[7] -= 4;
-    WriteULongSuper(ra[7], pc);
-    ra[7] -= 2;
-    WriteUWordSuper(ra[7], saveSr);
-    pc = vec;
+    cpu.ra[7] -= 4;
+    WriteULongSuper(cpu.ra[7], cpu.pc);
+    cpu.ra[7] -= 2;
+    WriteUWordSuper(cpu.ra[7], saveSr);
+    cpu.pc = vec;
     return false;
   }
 
   OPBuf_insert(&OP_info);
-  UWord code = ReadUWordSuper(pc);
+  UWord code = ReadUWordSuper(cpu.pc);
   printFmt(
-      "run68 exec error: 不当な命令を実行しました PC=$%08x, code = $%04x\n", pc,
+      "run68 exec error: 不当な命令を実行しました PC=$%08x, code = $%04x\n", cpu.pc,
       code);
   OPBuf_display(10);
-  run68_abort(pc);
+  run68_abort(cpu.pc);
 
   // not reached
 }
@@ -248,17 +295,17 @@ void run68_abort(Long adr) {
 
 #ifdef TRACE
   int i;
-  printf("d0-7=%08lx", rd[0]);
+  printf("d0-7=%08lx", cpu.rd[0]);
   for (i = 1; i < 8; i++) {
-    printf(",%08lx", rd[i]);
+    printf(",%08lx", cpu.rd[i]);
   }
   printf("\n");
-  printf("a0-7=%08lx", ra[0]);
+  printf("a0-7=%08lx", cpu.ra[0]);
   for (i = 1; i < 8; i++) {
-    printf(",%08lx", ra[i]);
+    printf(",%08lx", cpu.ra[i]);
   }
   printf("\n");
-  printf("  pc=%08lx    sr=%04x\n", pc, sr);
+  printf("  pc=%08lx    sr=%04x\n", cpu.pc, GetSr());
 #endif
   longjmp(jmp_when_abort, 2);
 }
@@ -334,9 +381,9 @@ Long get_locate() {
    命令情報リングバッファの作業領域
 */
 #define MAX_OPBUF 200
-static int num_entries;
-static int current_p;
-static EXEC_INSTRUCTION_INFO entry[MAX_OPBUF];
+static THREAD_LOCAL int num_entries;
+static THREAD_LOCAL int current_p;
+static THREAD_LOCAL EXEC_INSTRUCTION_INFO entry[MAX_OPBUF];
 
 /*
    機能：
@@ -70,7 +70,7 @@ static FPDataType GetFPDataType(DBL dbl) {
   return FPTYPE_NORMALIZED;
 }
 
-static void SetCcr(int f) { sr = (sr & SR_MASK) | f; }
+static void SetCcr(int f) { SetSr((cpu.sr & SR_MASK) | f); }
 
 // FPACK __STOH (0xfe12)
 ULong FefuncStoh(Long *pA0) {
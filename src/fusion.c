@@ -0,0 +1,166 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#include "fusion.h"
+
+#include <string.h>
+
+#include "mem.h"
+#include "operate.h"
+#include "run68.h"
+
+// 命令の融合(スーパーインストラクション)
+//   cmp、tst、addq、subqの直後にBcc、DBccが続く場合は、先行命令のハンドラから
+//   続けて条件分岐命令を実行し、命令の読み込みと振り分けを1回で済ませる。
+//   分岐条件は遅延評価中のコンディションコードから直接求め、srには反映しない。
+//
+//   ブロックキャッシュに条件分岐命令を記録する時に、直前の命令のハンドラを
+//   融合したハンドラに置き換える。分岐命令に直接飛んできた場合は分岐命令の
+//   ハンドラから実行されるので融合されない。
+//   直後の命令は実行時にメモリから読み込んで確認するので、命令が書き換え
+//   られた場合は通常どおり1命令ずつ実行される。
+//   デバッガ等で命令ごとの確認が必要な間は融合しない(fusionEnabled = false)。
+
+typedef enum {
+  FUSED_BCC,
+  FUSED_DBCC,
+  FUSED_BRANCH_KINDS,
+} FusedBranchKind;
+
+THREAD_LOCAL bool fusionEnabled;
+
+static THREAD_LOCAL unsigned long long fusionCounts[FUSION_KINDS][FUSED_BRANCH_KINDS];
+
+// 条件ごとに、成立するN、Z、V、Cの組み合わせ(CCR & 0x0f)をビットで表したもの
+static const UWord conditionTable[16] = {
+    0xffff,  // t
+    0x0000,  // f
+    0x0505,  // hi
+    0xfafa,  // ls
+    0x5555,  // cc
+    0xaaaa,  // cs
+    0x0f0f,  // ne
+    0xf0f0,  // eq
+    0x3333,  // vc
+    0xcccc,  // vs
+    0x00ff,  // pl
+    0xff00,  // mi
+    0xcc33,  // ge
+    0x33cc,  // lt
+    0x0c03,  // gt
+    0xf3fc,  // le
+};
+
+// 条件が成立しているか調べる。
+static inline bool testCondition(int cond) {
+  const LazyConditions* lc = &lazyConditions;
+
+  // ne、eqはZだけ求めればよい(遅延評価中の結果のZは演算結果だけで決まる)
+  if ((cond & 0x0e) == 0x06 && lc->kind != LAZY_CC_NONE &&
+      (unsigned)lc->size <= S_LONG) {
+    static const ULong masks[] = {0xff, 0xffff, 0xffffffff};
+    bool zero = ((ULong)lc->result & masks[lc->size]) == 0;
+    return (cond & 1) ? zero : !zero;
+  }
+
+  return (conditionTable[cond] >> GetConditions()) & 1;
+}
+
+// Bcc命令を実行する(bra、bsrは除く)。
+static void executeBcc(UWord code) {
+  Byte disp8 = (Byte)code;
+
+  if (testCondition((code >> 8) & 0x0f)) {
+    if (disp8 == 0) {
+      Word disp16 = imi_get_word();
+      cpu.pc += extl(disp16) - 2;
+    } else {
+      cpu.pc += extbl(disp8);
+    }
+  } else {
+    // Bcc.W の分岐不成立ならワードディスプレースメントを飛ばす
+    if (disp8 == 0) cpu.pc += 2;
+  }
+}
+
+// DBcc命令を実行する。
+static void executeDbcc(UWord code) {
+  int reg = code & 0x07;
+  Word disp16 = imi_get_word();
+
+  if (testCondition((code >> 8) & 0x0f)) return;
+
+  UWord counter = (cpu.rd[reg] & 0xffff) - 1;
+  cpu.rd[reg] = (cpu.rd[reg] & 0xffff0000) | counter;
+  if (counter != 0xffff) cpu.pc += extl(disp16) - 2;
+}
+
+// 直後の命令が条件分岐命令なら、その種類を返す。
+static bool peekConditionalBranch(UWord* code, FusedBranchKind* branch) {
+  Span mem = GetFetchMemory(cpu.pc, 2);
+  if (!mem.bufptr) return false;
+
+  UWord c = PeekW(mem.bufptr);
+  if (!IsConditionalBranch(c)) return false;
+
+  *code = c;
+  *branch = ((c & 0xf000) == 0x6000) ? FUSED_BCC : FUSED_DBCC;
+  return true;
+}
+
+/*
+ 　機能：先行命令に続く条件分岐命令を実行する
+ 戻り値：なし
+*/
+void ExecuteFusedBranch(FusionKind kind) {
+  UWord code;
+  FusedBranchKind branch;
+  if (!peekConditionalBranch(&code, &branch)) return;
+
+  fusionCounts[kind][branch] += 1;
+
+  // 実行履歴には2命令として記録する
+  OPBuf_insert(&OP_info);
+  OP_info.pc = cpu.pc;
+  cpu.pc += 2;
+
+  if (branch == FUSED_BCC)
+    executeBcc(code);
+  else
+    executeDbcc(code);
+}
+
+// 命令の融合の実行回数を消去する。
+void ClearFusionStatistics(void) {
+  memset(fusionCounts, 0, sizeof(fusionCounts));
+}
+
+// 命令の融合の実行回数を表示する。
+void PrintFusionStatistics(void) {
+  static const char* const names[FUSION_KINDS][FUSED_BRANCH_KINDS] = {
+      {"cmp + bcc", "cmp + dbcc"},
+      {"tst + bcc", "tst + dbcc"},
+      {"addq + bcc", "addq + dbcc"},
+      {"subq + bcc", "subq + dbcc"},
+  };
+
+  for (int i = 0; i < FUSION_KINDS; i += 1) {
+    for (int j = 0; j < FUSED_BRANCH_KINDS; j += 1) {
+      printFmt("命令融合 %-11s: %llu\n", names[i][j], fusionCounts[i][j]);
+    }
+  }
+}
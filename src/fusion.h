@@ -0,0 +1,52 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdbool.h>
+
+#include "run68.h"
+
+// 命令の融合(スーパーインストラクション)の対象になる先行命令
+typedef enum {
+  FUSION_CMP,   // cmp <ea>,Dn
+  FUSION_TST,   // tst <ea>
+  FUSION_ADDQ,  // addq #imm,<ea>
+  FUSION_SUBQ,  // subq #imm,<ea>
+  FUSION_KINDS,
+} FusionKind;
+
+// 命令の融合やループの一括実行をするか(命令ごとの確認が不要な間だけ true)
+extern THREAD_LOCAL bool fusionEnabled;
+
+void ExecuteFusedBranch(FusionKind kind);
+void ClearFusionStatistics(void);
+void PrintFusionStatistics(void);
+
+// 融合の対象になる条件分岐命令(bra、bsrを除くBcc、DBcc)か調べる。
+static inline bool IsConditionalBranch(UWord code) {
+  return ((code & 0xf000) == 0x6000 && (code & 0x0e00) != 0) ||
+         (code & 0xf0f8) == 0x50c8;
+}
+
+// 先行命令の実行後に呼び出し、直後の命令が条件分岐命令なら続けて実行する。
+static inline void FuseBranch(FusionKind kind) {
+  if (fusionEnabled) ExecuteFusedBranch(kind);
+}
+
+#endif
@@ -82,6 +82,7 @@ void read_ini(char *path) {
     /* キーワードを見る */
     if (section_match) {
       if (_stricmp(buf, "iothrough") == 0) settings.iothrough = true;
+      if (_stricmp(buf, "hugepages") == 0) settings.hugePages = true;
     }
   }
   fclose(fp);
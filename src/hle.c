@@ -0,0 +1,244 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#include "hle.h"
+
+#include <string.h>
+
+#include "fusion.h"
+#include "mem.h"
+#include "run68.h"
+
+// 既知のライブラリルーチンのネイティブ実装(HLE)
+//   Xファイルのシンボルテーブルから XC ライブラリのルーチンを探し、
+//   その入口の命令をネイティブ実装を呼び出すハンドラに置き換える。
+//   ルーチンはCの呼び出し規約(引数はスタック上のロングワード、戻り値はd0)
+//   に従って実行し、rtsと同様に呼び出し元に戻る。
+//
+//   d0以外のレジスタは変化しないので、実際のルーチンが破壊するレジスタ
+//   (d1-d2/a0-a2)とCCRの値は異なる。これらに依存するプログラムでは
+//   使用できないので、-statで表示される置き換え結果を確認すること。
+//
+//   引数が指すメモリがアクセスできない場合や、転送元と転送先が重なる
+//   場合などはネイティブ実装を使わず、元のルーチンを実行する。
+//   デバッガ等で命令ごとの確認が必要な間も元のルーチンを実行する。
+
+typedef struct {
+  ULong result;  // 戻り値
+  ULong bytes;   // 処理したバイト数
+} HleResult;
+
+// ネイティブ実装(false = 元のルーチンを実行する)
+typedef bool (*HleFunction)(const ULong* args, HleResult* result);
+
+typedef struct {
+  const char* name;  // シンボル名
+  int argCount;
+  HleFunction func;
+} HleRoutine;
+
+typedef struct {
+  ULong address;  // ルーチンの入口
+  const HleRoutine* routine;
+  unsigned long long calls;
+  unsigned long long bytes;
+} HleEntry;
+
+#define HLE_ENTRY_MAX 16
+
+THREAD_LOCAL int hleEntryCount;
+static THREAD_LOCAL HleEntry hleEntries[HLE_ENTRY_MAX];
+
+// 文字列(ASCIIZ)として読み込み可能なメモリか調べる。
+//   Span.lengthは文字列の長さ(末尾のNULは含まない)。
+static bool getReadableString(ULong adr, Span* str) {
+  Span mem;
+  if (!getAccessibleMemoryRange(adr, 0, SR_S_REF() != 0, &mem)) return false;
+
+  const char* nul = memchr(mem.bufptr, '\0', mem.length);
+  if (!nul) return false;
+
+  *str = (Span){mem.bufptr, (ULong)(nul - mem.bufptr)};
+  return true;
+}
+
+// 2つのバッファが重なっているか調べる。
+static bool isOverlapped(const char* p, const char* q, ULong len) {
+  return (p < q) ? (q < p + len) : (p < q + len);
+}
+
+// size_t strlen(const char* s);
+static bool hleStrlen(const ULong* args, HleResult* result) {
+  Span s;
+  if (!getReadableString(args[0], &s)) return false;
+
+  *result = (HleResult){s.length, s.length};
+  return true;
+}
+
+// char* strcpy(char* dst, const char* src);
+static bool hleStrcpy(const ULong* args, HleResult* result) {
+  Span src;
+  if (!getReadableString(args[1], &src)) return false;
+
+  ULong len = src.length + 1;
+  Span dst = GetWritableMemory(args[0], len);
+  if (!dst.bufptr || isOverlapped(dst.bufptr, src.bufptr, len)) return false;
+
+  memcpy(dst.bufptr, src.bufptr, len);
+  *result = (HleResult){args[0], len};
+  return true;
+}
+
+// void* memcpy(void* dst, const void* src, size_t n);
+static bool hleMemcpy(const ULong* args, HleResult* result) {
+  ULong len = args[2];
+  if (len != 0) {
+    Span src = GetReadableMemory(args[1], len);
+    Span dst = GetWritableMemory(args[0], len);
+    if (!src.bufptr || !dst.bufptr) return false;
+    if (isOverlapped(dst.bufptr, src.bufptr, len)) return false;
+
+    memcpy(dst.bufptr, src.bufptr, len);
+  }
+  *result = (HleResult){args[0], len};
+  return true;
+}
+
+// void* memset(void* dst, int c, size_t n);
+static bool hleMemset(const ULong* args, HleResult* result) {
+  ULong len = args[2];
+  if (len != 0) {
+    Span dst = GetWritableMemory(args[0], len);
+    if (!dst.bufptr) return false;
+
+    memset(dst.bufptr, (UByte)args[1], len);
+  }
+  *result = (HleResult){args[0], len};
+  return true;
+}
+
+static const HleRoutine hleRoutines[] = {
+    {"_strlen", 1, hleStrlen},
+    {"_strcpy", 2, hleStrcpy},
+    {"_memcpy", 3, hleMemcpy},
+    {"_memset", 3, hleMemset},
+};
+
+static HleEntry* findEntry(ULong adr) {
+  for (int i = 0; i < hleEntryCount; i += 1) {
+    if (hleEntries[i].address == adr) return &hleEntries[i];
+  }
+  return NULL;
+}
+
+// ルーチンの入口の命令ハンドラ
+static bool HleCall(char code1, char code2) {
+  HleEntry* entry = findEntry(cpu.pc - 2);
+
+  if (entry && fusionEnabled) {
+    const HleRoutine* routine = entry->routine;
+    ULong args[3];
+    HleResult result;
+
+    Span stack = GetReadableMemory(cpu.ra[7], 4 * (1 + routine->argCount));
+    if (stack.bufptr) {
+      for (int i = 0; i < routine->argCount; i += 1) {
+        args[i] = PeekL(stack.bufptr + 4 * (1 + i));
+      }
+      if (routine->func(args, &result)) {
+        entry->calls += 1;
+        entry->bytes += result.bytes;
+
+        // rts
+        cpu.rd[0] = result.result;
+        cpu.pc = PeekL(stack.bufptr);
+        cpu.ra[7] += 4;
+        return false;
+      }
+    }
+  }
+
+  // 元のルーチンを実行する
+  UWord code = ((UWord)(UByte)code1 << 8) | (UByte)code2;
+  return GetInstructionHandler(code)(code1, code2);
+}
+
+InstructionHandler hleGetHandlerSlow(ULong adr) {
+  return findEntry(adr) ? HleCall : NULL;
+}
+
+static const HleRoutine* findRoutine(const char* name) {
+  size_t count = sizeof(hleRoutines) / sizeof(hleRoutines[0]);
+
+  for (size_t i = 0; i < count; i += 1) {
+    if (strcmp(hleRoutines[i].name, name) == 0) return &hleRoutines[i];
+  }
+  return NULL;
+}
+
+// 登録したルーチンを全て消去する。
+void HleClear(void) { hleEntryCount = 0; }
+
+/*
+ 　機能：Xファイルのシンボルテーブルから置き換えるルーチンを探して登録する
+   引数：ULong       textTop      <in>  テキストセクションの先頭アドレス
+         ULong       textSize     <in>  テキストセクションの大きさ
+         const char* symbols      <in>  シンボルテーブル
+         ULong       symbolsSize  <in>  シンボルテーブルの大きさ
+ 戻り値：なし
+*/
+void HleInstallFromSymbols(ULong textTop, ULong textSize, const char* symbols,
+                           ULong symbolsSize) {
+  hleEntryCount = 0;
+
+  // シンボル = タイプ(2バイト)、値(4バイト)、シンボル名(偶数バイトに揃える)
+  const char* p = symbols;
+  const char* end = symbols + symbolsSize;
+  while (end - p > 6) {
+    UWord type = PeekW((char*)p);
+    ULong value = PeekL((char*)p + 2);
+    const char* name = p + 6;
+    const char* nul = memchr(name, '\0', end - name);
+    if (!nul) break;
+    p = name + (((nul - name) + 2) & ~1);
+
+    // テキストセクションのシンボルだけが対象
+    if ((type & 0xff) != 0x01 || value >= textSize || (value & 1)) continue;
+
+    const HleRoutine* routine = findRoutine(name);
+    if (!routine || hleEntryCount >= HLE_ENTRY_MAX) continue;
+    if (findEntry(textTop + value)) continue;
+
+    hleEntries[hleEntryCount++] = (HleEntry){textTop + value, routine, 0, 0};
+  }
+}
+
+// ルーチンの置き換え結果を表示する。
+void PrintHleStatistics(void) {
+  if (hleEntryCount == 0) {
+    print("HLE: 置き換えたルーチンはありません。\n");
+    return;
+  }
+
+  for (int i = 0; i < hleEntryCount; i += 1) {
+    const HleEntry* entry = &hleEntries[i];
+    printFmt("HLE: %-8s $%08X 呼び出し %llu回 処理 %lluバイト\n",
+             entry->routine->name, entry->address, entry->calls,
+             entry->bytes);
+  }
+}
@@ -0,0 +1,38 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+#ifndef HLE_H
+#define HLE_H
+
+#include "run68.h"
+
+// 既知のライブラリルーチンのネイティブ実装(-hle)
+extern THREAD_LOCAL int hleEntryCount;
+
+void HleClear(void);
+void HleInstallFromSymbols(ULong textTop, ULong textSize, const char* symbols,
+                           ULong symbolsSize);
+InstructionHandler hleGetHandlerSlow(ULong adr);
+void PrintHleStatistics(void);
+
+// 指定アドレスがネイティブ実装に置き換えたルーチンの入口なら、
+// その命令ハンドラを得る(NULL = 置き換えていない)。
+static inline InstructionHandler HleGetHandler(ULong adr) {
+  return hleEntryCount ? hleGetHandlerSlow(adr) : NULL;
+}
+
+#endif
@@ -24,6 +24,8 @@
 #include <time.h>
 
 #ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #endif
 
@@ -620,6 +622,70 @@ Long SetFiledate_generic(FILEINFO* finfop, ULong dt) {
 }
 #endif
 
+#ifdef HOST_ALLOCATE_MEMORY_GENERIC
+// エミュレートするメモリを確保する(0で初期化済み)。
+//   物理メモリは実際にアクセスしたページにだけ割り当てられるように、
+//   可能なら無名mmapで確保する(スワップ領域の予約もしない)。
+void* AllocateMemory_generic(size_t size, bool hugePages) {
+#if defined(MAP_ANONYMOUS) && !defined(__EMSCRIPTEN__)
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (p == MAP_FAILED) return NULL;
+
+#ifdef MADV_HUGEPAGE
+  if (hugePages) madvise(p, size, MADV_HUGEPAGE);
+#endif
+  return p;
+#else
+  return calloc(1, size);
+#endif
+}
+#endif
+
+#ifdef HOST_FREE_MEMORY_GENERIC
+void FreeMemory_generic(void* ptr, size_t size) {
+  if (!ptr) return;
+#if defined(MAP_ANONYMOUS) && !defined(__EMSCRIPTEN__)
+  munmap(ptr, size);
+#else
+  free(ptr);
+#endif
+}
+#endif
+
+#ifdef HOST_MAP_MEMORY_IMAGE_GENERIC
+// ファイルの内容を、確保済みのエミュレートするメモリに読み込む。
+//   可能ならファイルをコピーオンライトでマップするので、同じファイルを
+//   読み込んだ複数のプロセスで、書き換えていないページを共有できる。
+//   offsetはページ境界に揃えておくこと。
+bool MapMemoryImage_generic(void* ptr, size_t size, FILE* fp, long offset) {
+#if defined(MAP_ANONYMOUS) && !defined(__EMSCRIPTEN__)
+  void* p = mmap(ptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                 fileno(fp), (off_t)offset);
+  if (p != MAP_FAILED) return true;
+#endif
+  if (fseek(fp, offset, SEEK_SET) != 0) return false;
+  return fread(ptr, 1, size, fp) == size;
+}
+#endif
+
+#ifdef HOST_GET_PEAK_RESIDENT_SIZE_GENERIC
+// プロセスの最大常駐メモリサイズ(KB単位)を返す。
+//   取得できなければ0を返す。
+ULong GetPeakResidentSize_generic(void) {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+  return (ULong)(ru.ru_maxrss / 1024);  // バイト単位
+#else
+  return (ULong)ru.ru_maxrss;
+#endif
+}
+#endif
+
 #ifdef HOST_IOCS_ONTIME_GENERIC
 // IOCS _ONTIME (0x7f)
 RegPair IocsOntime_generic(void) {
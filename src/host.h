@@ -171,6 +171,30 @@ Long SetFiledate_generic(FILEINFO* finfop, ULong dt);
 #define HOST_SET_FILEDATE SetFiledate_generic
 #endif
 
+#ifndef HOST_ALLOCATE_MEMORY
+#define HOST_ALLOCATE_MEMORY_GENERIC
+void* AllocateMemory_generic(size_t size, bool hugePages);
+#define HOST_ALLOCATE_MEMORY AllocateMemory_generic
+#endif
+
+#ifndef HOST_FREE_MEMORY
+#define HOST_FREE_MEMORY_GENERIC
+void FreeMemory_generic(void* ptr, size_t size);
+#define HOST_FREE_MEMORY FreeMemory_generic
+#endif
+
+#ifndef HOST_MAP_MEMORY_IMAGE
+#define HOST_MAP_MEMORY_IMAGE_GENERIC
+bool MapMemoryImage_generic(void* ptr, size_t size, FILE* fp, long offset);
+#define HOST_MAP_MEMORY_IMAGE MapMemoryImage_generic
+#endif
+
+#ifndef HOST_GET_PEAK_RESIDENT_SIZE
+#define HOST_GET_PEAK_RESIDENT_SIZE_GENERIC
+ULong GetPeakResidentSize_generic(void);
+#define HOST_GET_PEAK_RESIDENT_SIZE GetPeakResidentSize_generic
+#endif
+
 #ifndef HOST_IOCS_ONTIME
 #define HOST_IOCS_ONTIME_GENERIC
 RegPair IocsOntime_generic(void);
@@ -22,6 +22,8 @@
 #include <string.h>
 #include <time.h>
 #include <windows.h>
+// windows.hより後にインクルードすること
+#include <psapi.h>
 
 #include "host.h"
 #include "human68k.h"
@@ -335,6 +337,23 @@ Long SetFiledate_win32(FILEINFO* finfop, ULong dt) {
   return DOSE_SUCCESS;
 }
 
+// エミュレートするメモリを確保する(0で初期化済み)。
+//   物理メモリは実際にアクセスしたページにだけ割り当てられる。
+void* AllocateMemory_win32(size_t size, bool hugePages) {
+  return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void FreeMemory_win32(void* ptr, size_t size) {
+  if (ptr) VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+// プロセスの最大ワーキングセットサイズ(KB単位)を返す。
+ULong GetPeakResidentSize_win32(void) {
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+  return (ULong)(pmc.PeakWorkingSetSize / 1024);
+}
+
 // IOCS _ONTIME (0x7f)
 RegPair IocsOntime_win32(void) {
   // GetTickCount64()のミリ秒単位から、IOCS _ONTIMEの1/100秒単位に換算する
@@ -84,6 +84,15 @@ Long GetFiledate_win32(FILEINFO* finfop);
 Long SetFiledate_win32(FILEINFO* finfop, ULong dt);
 #define HOST_SET_FILEDATE SetFiledate_win32
 
+void* AllocateMemory_win32(size_t size, bool hugePages);
+#define HOST_ALLOCATE_MEMORY AllocateMemory_win32
+
+void FreeMemory_win32(void* ptr, size_t size);
+#define HOST_FREE_MEMORY FreeMemory_win32
+
+ULong GetPeakResidentSize_win32(void);
+#define HOST_GET_PEAK_RESIDENT_SIZE GetPeakResidentSize_win32
+
 RegPair IocsOntime_win32(void);
 #define HOST_IOCS_ONTIME IocsOntime_win32
 
@@ -25,7 +25,7 @@
 
 #define HUMAN_BLOCK_ALIGN (8 * 1024)
 
-static ULong FcbBufferAddress;
+static THREAD_LOCAL ULong FcbBufferAddress;
 
 static ULong alignBlock(ULong adrs, ULong size) {
   return (adrs + (size - 1)) & ~(size - 1);
@@ -187,3 +187,17 @@ int InitHuman68k(ULong humanPsp) {
 
   return 0;
 }
+
+// ホスト側の状態を保存する
+void SaveHuman68kHostState(Human68kHostState* state) {
+  memcpy(state->exceptionHandlers, DefaultExceptionHandler,
+         sizeof(state->exceptionHandlers));
+  state->fcbBufferAddress = FcbBufferAddress;
+}
+
+// 保存しておいたホスト側の状態に戻す
+void RestoreHuman68kHostState(const Human68kHostState* state) {
+  memcpy(DefaultExceptionHandler, state->exceptionHandlers,
+         sizeof(DefaultExceptionHandler));
+  FcbBufferAddress = state->fcbBufferAddress;
+}
@@ -196,7 +196,17 @@ static inline int is_mb_lead(char c) {
   return (0x80 <= c && c <= 0x9f) || (0xe0 <= c);
 }
 
+// InitHuman68k()がホスト側に設定する状態
+//   スレッドごとの変数に置かれるので、保存しておいたメモリの状態に
+//   戻すときは、一緒に保存しておいたこの状態も設定し直す。
+typedef struct {
+  ULong exceptionHandlers[256];  // DefaultExceptionHandler[]
+  ULong fcbBufferAddress;
+} Human68kHostState;
+
 ULong GetFcbAddress(UWord handle);
 int InitHuman68k(ULong humanPSP);
+void SaveHuman68kHostState(Human68kHostState* state);
+void RestoreHuman68kHostState(const Human68kHostState* state);
 
 #endif
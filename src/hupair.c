@@ -106,7 +106,8 @@ static inline void free_iconv_buf(IconvBufPtr* ibp) {
 
 static ULong encodeHupair(int argc, char* argv[], const char* argv0, ULong adr,
                           ULong size, bool* hupair) {
-  Span mem = GetWritableMemorySuper(adr, size);
+  // 書き込みの記録は、使用したバイト数が決まってから呼び出し元で行う
+  Span mem = GetReadableMemorySuper(adr, size);
   if (!mem.bufptr) return 0;
 
   char* p = mem.bufptr;
@@ -190,24 +191,53 @@ static ULong encodeHupair(int argc, char* argv[], const char* argv0, ULong adr,
   return (ULong)(p - buffer_top);
 }
 
+// HUPAIRエンコードしたコマンドラインをメモリブロックを確保して書き込む。
+//   minSizeを指定すると、後でコマンドラインを置き換えられるように
+//   少なくともその大きさのメモリブロックを確保しておく。
 ULong EncodeHupair(int argc, char* argv[], const char* argv0, ULong parent,
-                   bool* hupair) {
+                   ULong minSize, bool* hupair) {
   *hupair = false;
 
   MallocResult m = MallocAll(parent);
   if (m.address < 0) return 0;
 
   ULong consumed = encodeHupair(argc, argv, argv0, m.address, m.length, hupair);
+
+  // 失敗した場合はどこまで書き込んだかわからないので、全体を記録する
+  MarkMemoryWritten(m.address, consumed ? consumed : m.length);
   if (consumed == 0) {
     Mfree(m.address);
     return 0;
   }
-  Setblock(m.address, consumed);
+  ULong blockSize =
+      (consumed < minSize && minSize <= m.length) ? minSize : consumed;
+  Setblock(m.address, blockSize);
 
   // コマンドライン先頭(文字列長のアドレス)を返す
   return m.address + (ULong)sizeof(hupairMark);
 }
 
+// EncodeHupair()で作成したコマンドラインを新しい引数に置き換える。
+//   同じメモリブロック内に書き込み、argv0は元のものを引き継ぐ。
+//   メモリブロックに収まらなければfalseを返す。
+bool ReplaceHupair(ULong cmdline, int argc, char* argv[], bool* hupair) {
+  *hupair = false;
+
+  const ULong adr = cmdline - (ULong)sizeof(hupairMark);
+  const ULong size = ReadULongSuper(adr - SIZEOF_MEMBLK + MEMBLK_END) - adr;
+
+  // argv0はコマンドライン文字列の直後にある
+  const char* s = GetStringSuper(cmdline + 1);
+  char argv0[HUMAN68K_PATH_MAX + 1];
+  const char* oldArgv0 = GetStringSuper(cmdline + 1 + strlen(s) + 1);
+  if (strlen(oldArgv0) >= sizeof(argv0)) return false;
+  strcpy(argv0, oldArgv0);
+
+  ULong consumed = encodeHupair(argc, argv, argv0, adr, size, hupair);
+  MarkMemoryWritten(adr, consumed ? consumed : size);
+  return consumed != 0;
+}
+
 bool IsCompliantWithHupair(ULong base, ULong size, ULong entry) {
   ULong mark = entry + 2;
 
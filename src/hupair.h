@@ -21,7 +21,8 @@
 #include "run68.h"
 
 ULong EncodeHupair(int argc, char* argv[], const char* argv0, ULong parent,
-                   bool* hupair);
+                   ULong minSize, bool* hupair);
+bool ReplaceHupair(ULong cmdline, int argc, char* argv[], bool* hupair);
 bool IsCompliantWithHupair(ULong base, ULong size, ULong entry);
 
 #endif
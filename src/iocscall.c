@@ -22,6 +22,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "bcd.h"
 #include "host.h"
 #include "iocscall.h"
 #include "mem.h"
@@ -41,8 +42,6 @@ static Long Dayasc(Long, Long);
 static Long Intvcs(Long, Long);
 static void Dmamove(Long, Long, Long, Long);
 
-static int intToBcd(int n) { return ((n / 10) << 4) + n % 10; }
-
 // IOCS _DATEBCD (0x50)
 // 日付データのバイナリ→BCD変換。
 ULong Datebcd(ULong b) {
@@ -70,8 +69,8 @@ ULong Datebcd(ULong b) {
   int w = (leapCount ? wtable1 : wtable1Leap)[m - 1];  // 1980年m月1日の曜日
   w += wtable2[(y / 4) % 7] + wtable3[leapCount] + (d - 1);  // y年m月d日の曜日
 
-  return (leapCount << 28) | ((w % 7) << 24) | (intToBcd(y) << 16) |
-         (intToBcd(m) << 8) | intToBcd(d);
+  return (leapCount << 28) | ((w % 7) << 24) | (ToBcd(y) << 16) |
+         (ToBcd(m) << 8) | ToBcd(d);
 }
 
 // IOCS _DATESET (0x51)
@@ -93,8 +92,7 @@ ULong Timebcd(ULong b) {
 
   if (hh > 23 || mm > 59 || ss > 59) return (ULong)-1;
 
-  return (fmt << 24) | (intToBcd(hh) << 16) | (intToBcd(mm) << 8) |
-         intToBcd(ss);
+  return (fmt << 24) | (ToBcd(hh) << 16) | (ToBcd(mm) << 8) | ToBcd(ss);
 }
 
 // IOCS _TIMESET (0x53)
@@ -133,10 +131,10 @@ ULong Dateget(TimeFunc timeFunc) {
   int y = t.tm_year % 100;
   y = y + ((y < dif) ? 100 : 0) - dif;
 
-  return (t.tm_wday << 24)                //
-         | (intToBcd(y) << 16)            //
-         | (intToBcd(t.tm_mon + 1) << 8)  //
-         | intToBcd(t.tm_mday);
+  return (t.tm_wday << 24)             //
+         | (ToBcd(y) << 16)            //
+         | (ToBcd(t.tm_mon + 1) << 8)  //
+         | ToBcd(t.tm_mday);
 }
 
 // IOCS _TIMEGET (0x54)
@@ -145,10 +143,10 @@ ULong Timeget(TimeFunc timeFunc) {
   struct tm t = toLocalTime(timeFunc(NULL));
   const int fmt = 1;  // 24時間計
 
-  return (fmt << 24)                    //
-         | (intToBcd(t.tm_hour) << 16)  //
-         | (intToBcd(t.tm_min) << 8)    //
-         | intToBcd(t.tm_sec);
+  return (fmt << 24)                 //
+         | (ToBcd(t.tm_hour) << 16)  //
+         | (ToBcd(t.tm_min) << 8)    //
+         | ToBcd(t.tm_sec);
 }
 
 // IOCS _ONTIME (0x7f)
@@ -163,18 +161,18 @@ bool iocs_call() {
   int x, y;
   short save_s;
 
-  UByte no = rd[0] & 0xff;
+  UByte no = cpu.rd[0] & 0xff;
 
   if (settings.traceFunc) {
-    printf("IOCS(%02X): PC=%06X\n", no, pc);
+    printf("IOCS(%02X): PC=%06X\n", no, cpu.pc);
   }
   switch (no) {
     case 0x20: /* B_PUTC */
-      rd[0] = Putc((rd[1] & 0xFFFF));
+      cpu.rd[0] = Putc((cpu.rd[1] & 0xFFFF));
       break;
     case 0x21: /* B_PRINT */
     {
-      char *p = GetStringSuper(ra[1]);
+      char *p = GetStringSuper(cpu.ra[1]);
 #if defined(USE_ICONV)
       // SJIS to UTF-8
       char utf8_buf[8192];
@@ -191,19 +189,19 @@ bool iocs_call() {
 #else
       printf("%s", p);
 #endif
-      ra[1] += strlen(p);
-      rd[0] = get_locate();
+      cpu.ra[1] += strlen(p);
+      cpu.rd[0] = get_locate();
     } break;
     case 0x22: /* B_COLOR */
-      rd[0] = Color((rd[1] & 0xFFFF));
+      cpu.rd[0] = Color((cpu.rd[1] & 0xFFFF));
       break;
     case 0x23: /* B_LOCATE */
-      if (rd[1] != -1) {
-        x = (rd[1] & 0xFFFF) + 1;
-        y = (rd[2] & 0xFFFF) + 1;
+      if (cpu.rd[1] != -1) {
+        x = (cpu.rd[1] & 0xFFFF) + 1;
+        y = (cpu.rd[2] & 0xFFFF) + 1;
         printf("%c[%d;%dH", 0x1B, y, x);
       }
-      rd[0] = get_locate();
+      cpu.rd[0] = get_locate();
       break;
     case 0x24: /* B_DOWN_S */
       printf("%c[s\n%c[u%c[1B", 0x1B, 0x1B, 0x1B);
@@ -215,57 +213,57 @@ bool iocs_call() {
       Putmes();
       break;
     case 0x50:  // _DATEBCD
-      rd[0] = Datebcd(rd[1]);
+      cpu.rd[0] = Datebcd(cpu.rd[1]);
       break;
     case 0x51:  // _DATESET
-      rd[0] = Dateset(rd[1]);
+      cpu.rd[0] = Dateset(cpu.rd[1]);
       break;
     case 0x52:  // _TIMEBCD
-      rd[0] = Timebcd(rd[1]);
+      cpu.rd[0] = Timebcd(cpu.rd[1]);
       break;
     case 0x53:  // _TIMESET
-      rd[0] = Timeset(rd[1]);
+      cpu.rd[0] = Timeset(cpu.rd[1]);
       break;
     case 0x54: /* DATEGET */
-      rd[0] = Dateget(time);
+      cpu.rd[0] = Dateget(time);
       break;
     case 0x55: /* DATEBIN */
-      rd[0] = Datebin(rd[1]);
+      cpu.rd[0] = Datebin(cpu.rd[1]);
       break;
     case 0x56: /* TIMEGET */
-      rd[0] = Timeget(time);
+      cpu.rd[0] = Timeget(time);
       break;
     case 0x57: /* TIMEBIN */
-      rd[0] = Timebin(rd[1]);
+      cpu.rd[0] = Timebin(cpu.rd[1]);
       break;
     case 0x5A: /* DATEASC */
-      rd[0] = Dateasc(rd[1], ra[1]);
+      cpu.rd[0] = Dateasc(cpu.rd[1], cpu.ra[1]);
       break;
     case 0x5B: /* TIMEASC */
-      rd[0] = Timeasc(rd[1], ra[1]);
+      cpu.rd[0] = Timeasc(cpu.rd[1], cpu.ra[1]);
       break;
     case 0x5C: /* DAYASC */
-      rd[0] = Dayasc(rd[1], ra[1]);
+      cpu.rd[0] = Dayasc(cpu.rd[1], cpu.ra[1]);
       break;
     case 0x6C: /* VDISPST */
       save_s = SR_S_REF();
       SR_S_ON();
-      if (ra[1] == 0) {
+      if (cpu.ra[1] == 0) {
         mem_set(0x118, 0, S_LONG);
       } else {
-        rd[0] = mem_get(0x118, S_LONG);
-        if (rd[0] == 0) mem_set(0x118, ra[1], S_LONG);
+        cpu.rd[0] = mem_get(0x118, S_LONG);
+        if (cpu.rd[0] == 0) mem_set(0x118, cpu.ra[1], S_LONG);
       }
       if (save_s == 0) SR_S_OFF();
       break;
     case 0x6D: /* CRTCRAS */
       save_s = SR_S_REF();
       SR_S_ON();
-      if (ra[1] == 0) {
+      if (cpu.ra[1] == 0) {
         mem_set(0x138, 0, S_LONG);
       } else {
-        rd[0] = mem_get(0x138, S_LONG);
-        if (rd[0] == 0) mem_set(0x138, ra[1], S_LONG);
+        cpu.rd[0] = mem_get(0x138, S_LONG);
+        if (cpu.rd[0] == 0) mem_set(0x138, cpu.ra[1], S_LONG);
       }
       if (save_s == 0) SR_S_OFF();
       break;
@@ -274,51 +272,53 @@ bool iocs_call() {
     case 0x7F: /* ONTIME */
     {
       RegPair r = IocsOntime();
-      rd[0] = r.r0;
-      rd[1] = r.r1;
+      cpu.rd[0] = r.r0;
+      cpu.rd[1] = r.r1;
     } break;
     case 0x80: /* B_INTVCS */
-      rd[0] = Intvcs(rd[1], ra[1]);
+      cpu.rd[0] = Intvcs(cpu.rd[1], cpu.ra[1]);
       break;
     case 0x81: /* B_SUPER */
-      if (ra[1] == 0) {
+      if (cpu.ra[1] == 0) {
         /* user -> super */
         if (SR_S_REF() != 0) {
-          rd[0] = -1; /* エラー */
+          cpu.rd[0] = -1; /* エラー */
         } else {
-          rd[0] = ra[7];
+          cpu.rd[0] = cpu.ra[7];
           SR_S_ON();
         }
       } else {
         /* super -> user */
-        ra[7] = ra[1];
-        rd[0] = 0;
+        cpu.ra[7] = cpu.ra[1];
+        cpu.rd[0] = 0;
         SR_S_OFF();
       }
       break;
     case 0x82: /* B_BPEEK */
       save_s = SR_S_REF();
       SR_S_ON();
-      rd[0] = ((rd[0] & 0xFFFFFF00) | (mem_get(ra[1], S_BYTE) & 0xFF));
+      cpu.rd[0] = ((cpu.rd[0] & 0xFFFFFF00) |
+                   (mem_get(cpu.ra[1], S_BYTE) & 0xFF));
       if (save_s == 0) SR_S_OFF();
-      ra[1] += 1;
+      cpu.ra[1] += 1;
       break;
     case 0x83: /* B_WPEEK */
       save_s = SR_S_REF();
       SR_S_ON();
-      rd[0] = ((rd[0] & 0xFFFF0000) | (mem_get(ra[1], S_WORD) & 0xFFFF));
+      cpu.rd[0] = ((cpu.rd[0] & 0xFFFF0000) |
+                   (mem_get(cpu.ra[1], S_WORD) & 0xFFFF));
       if (save_s == 0) SR_S_OFF();
-      ra[1] += 2;
+      cpu.ra[1] += 2;
       break;
     case 0x84: /* B_LPEEK */
       save_s = SR_S_REF();
       SR_S_ON();
-      rd[0] = mem_get(ra[1], S_LONG);
+      cpu.rd[0] = mem_get(cpu.ra[1], S_LONG);
       if (save_s == 0) SR_S_OFF();
-      ra[1] += 4;
+      cpu.ra[1] += 4;
       break;
     case 0x8A: /* DMAMOVE */
-      Dmamove(rd[1], rd[2], ra[1], ra[2]);
+      Dmamove(cpu.rd[1], cpu.rd[2], cpu.ra[1], cpu.ra[2]);
       break;
     case 0xAE: /* OS_CURON */
       printf("%c[>5l", 0x1B);
@@ -373,21 +373,21 @@ static void Putmes() {
   int keta;
   int len;
 
-  x = (rd[2] & 0xFFFF) + 1;
-  y = (rd[3] & 0xFFFF) + 1;
-  keta = (rd[4] & 0xFFFF) + 1;
+  x = (cpu.rd[2] & 0xFFFF) + 1;
+  y = (cpu.rd[3] & 0xFFFF) + 1;
+  keta = (cpu.rd[4] & 0xFFFF) + 1;
 
-  char *p = GetStringSuper(ra[1]);
+  char *p = GetStringSuper(cpu.ra[1]);
   len = strlen(p);
   if (keta > 96) keta = 96;
   memcpy(temp, p, keta);
   temp[keta] = '\0';
 
   printf("%c[%d;%dH", 0x1B, y, x);
-  text_color((rd[1] & 0xFF));
+  text_color((cpu.rd[1] & 0xFF));
   printf("%s", temp);
 
-  ra[1] += len;
+  cpu.ra[1] += len;
 }
 
 /*
@@ -444,7 +444,7 @@ static Long Dateasc(Long data, Long adr) {
   char buf[16];
   snprintf(buf, sizeof(buf), fmt, yearLen, year, sep, month, sep, day);
   WriteStringSuper(adr, buf);
-  ra[1] += strlen(buf);
+  cpu.ra[1] += strlen(buf);
 
   return 0;
 }
@@ -464,7 +464,7 @@ static Long Timeasc(Long data, Long adr) {
   char buf[16];
   snprintf(buf, sizeof(buf), "%02d:%02d:%02d", hh, mm, ss);
   WriteStringSuper(adr, buf);
-  ra[1] += strlen(buf);
+  cpu.ra[1] += strlen(buf);
 
   return 0;
 }
@@ -488,7 +488,7 @@ static Long Dayasc(Long data, Long adr) {
   };
 
   WriteStringSuper(adr, days[data & 7]);
-  ra[1] += 2;
+  cpu.ra[1] += 2;
   return 0;
 }
 
@@ -18,13 +18,22 @@
 
 #include "run68.h"
 
-static char fnc_key1[20][32] = {"", "", "", "", "", "", "", "", "", "",
+static THREAD_LOCAL char fnc_key1[20][32] = {"", "", "", "", "", "", "", "", "", "",
                                 "", "", "", "", "", "", "", "", "", ""};
-static char fnc_key2[12][6] = {"", "", "", "", "", "", "", "", "", "", "", ""};
+static THREAD_LOCAL char fnc_key2[12][6] = {"", "", "", "", "", "", "", "", "", "", "", ""};
 
 static void put_fnckey1(int, char *);
 static void put_fnckey2(int, char *);
 
+/*
+ 　機能：ファンクションキーに割り当てた文字列を全て消去する
+ 戻り値：なし
+*/
+void clear_fnckey(void) {
+  memset(fnc_key1, 0, sizeof(fnc_key1));
+  memset(fnc_key2, 0, sizeof(fnc_key2));
+}
+
 /*
  　機能：ファンクションキーに割り当てた文字列を得る
  戻り値：なし
@@ -0,0 +1,62 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#ifndef LIBRUN68_H
+#define LIBRUN68_H
+
+// エミュレータをライブラリとして組み込むためのインターフェース
+//
+//   Run68Machineはエミュレータの実行単位を表すハンドルで、
+//   Run68Execute()を呼び出すたびにマシンの状態を初期化してから
+//   プログラムを実行し、終了後に開いたファイルを全て閉じる。
+//   そのため1つのプロセス内で複数のプログラムを続けて実行できる。
+//
+//   エミュレートするメモリは最初の実行で確保し、初期化した状態を
+//   保存しておく。以降の実行ではメモリを確保し直さず、前回の実行で
+//   書き込まれたページだけを保存した状態に戻して使う。メモリと
+//   実行ファイルのキャッシュはRun68DestroyMachine()で解放する。
+//
+//   CPU、ファイル管理テーブルなど実行中の状態は、Run68Execute()を
+//   呼び出したスレッドに結び付けられる。そのため別々のスレッドで
+//   別々のマシンを同時に実行できる。ただし次の点に注意すること。
+//     - 同じマシンを複数のスレッドで同時に実行しないこと(実行中のマシンで
+//       実行しようとするとエラーになる)。実行していなければ、前回と別の
+//       スレッドで実行してもよい。
+//     - 最初のRun68CreateMachine()は共有する表を作成するので、他のスレッドと
+//       同時に呼び出さないこと。
+//     - Run68DestroyMachine()は実行中のマシンに対して呼び出さないこと。
+//     - カレントディレクトリ、標準入出力、ホストの環境変数はプロセスで
+//       共有される。これらに依存するプログラムを同時に実行する場合は、
+//       呼び出し側で排他制御すること。
+
+typedef struct Run68Machine Run68Machine;
+
+Run68Machine* Run68CreateMachine(void);
+void Run68DestroyMachine(Run68Machine* machine);
+
+// 実行するプログラムに渡す環境変数を設定する。
+//   envpは"NAME=VALUE"形式の文字列の配列で、末尾はNULL(NULLなら追加しない)。
+//   run68.iniの[environment]の後に追加し、同じ名前の変数は置き換える。
+//   配列と文字列はRun68Execute()が終わるまで保持しておくこと。
+void Run68SetEnvironment(Run68Machine* machine, const char* const* envp);
+
+// run68コマンドと同じ形式のコマンドライン(argv[0]はrun68自身のパス名)で
+// プログラムを実行し、終了コードを返す。
+int Run68Execute(Run68Machine* machine, int argc, char* argv[]);
+
+#endif
@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "eaaccess.h"
 #include "operate.h"
 #include "run68.h"
 
@@ -26,18 +27,18 @@
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Ori(char code) {
+static bool Ori(char code1, char code2) {
   Long src_data;
   char mode;
   char reg;
   int work_mode;
   Long data;
 
-  char size = ((code >> 6) & 0x03);
+  char size = ((code2 >> 6) & 0x03);
   if (size == 3) return IllegalInstruction();
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
   src_data = imi_get(size);
 
   /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
@@ -76,13 +77,13 @@ static bool Ori(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Ori_t_ccr() {
+static bool Ori_t_ccr(char code1, char code2) {
   UByte data = imi_get(S_BYTE);
 
 #ifdef TRACE
-  printf("trace: ori_t_ccr src=0x%02X PC=%06lX\n", data, pc - 2);
+  printf("trace: ori_t_ccr src=0x%02X PC=%06lX\n", data, cpu.pc - 2);
 #endif
-  sr |= (data & CCR_MASK);
+  SetSr(GetSr() | (data & CCR_MASK));
   return false;
 }
 
@@ -91,7 +92,7 @@ static bool Ori_t_ccr() {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Ori_t_sr() {
+static bool Ori_t_sr(char code1, char code2) {
   short data;
 
   if (SR_S_REF() == 0) {
@@ -101,11 +102,11 @@ static bool Ori_t_sr() {
   data = (short)imi_get(S_WORD);
 
 #ifdef TRACE
-  printf("trace: ori_t_sr src=0x%02X PC=%06lX\n", data, pc - 2);
+  printf("trace: ori_t_sr src=0x%02X PC=%06lX\n", data, cpu.pc - 2);
 #endif
 
   /* SRをセット */
-  sr |= data;
+  SetSr(GetSr() | data);
 
   return false;
 }
@@ -115,18 +116,18 @@ static bool Ori_t_sr() {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Andi(char code) {
+static bool Andi(char code1, char code2) {
   Long src_data;
   char mode;
   char reg;
   Long work_mode;
   Long data;
 
-  char size = ((code >> 6) & 0x03);
+  char size = ((code2 >> 6) & 0x03);
   if (size == 3) IllegalInstruction();
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
 
   src_data = imi_get(size);
 
@@ -166,13 +167,13 @@ static bool Andi(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Andi_t_ccr() {
+static bool Andi_t_ccr(char code1, char code2) {
   UByte data = (char)imi_get(S_BYTE);
 
 #ifdef TRACE
-  printf("trace: andi_t_ccr src=0x%02X PC=%06lX\n", data, pc - 2);
+  printf("trace: andi_t_ccr src=0x%02X PC=%06lX\n", data, cpu.pc - 2);
 #endif
-  sr &= (data | ~CCR_MASK);
+  SetSr(GetSr() & (data | ~CCR_MASK));
   return false;
 }
 
@@ -181,7 +182,7 @@ static bool Andi_t_ccr() {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Andi_t_sr() {
+static bool Andi_t_sr(char code1, char code2) {
   short data;
 
   if (SR_S_REF() == 0) {
@@ -191,11 +192,11 @@ static bool Andi_t_sr() {
   data = (short)imi_get(S_WORD);
 
 #ifdef TRACE
-  printf("trace: andi_t_sr src=0x%02X PC=%06lX\n", data, pc - 2);
+  printf("trace: andi_t_sr src=0x%02X PC=%06lX\n", data, cpu.pc - 2);
 #endif
 
   /* SRをセット */
-  sr &= data;
+  SetSr(GetSr() & data);
 
   return false;
 }
@@ -205,18 +206,18 @@ static bool Andi_t_sr() {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Addi(char code) {
+static bool Addi(char code1, char code2) {
   Long src_data;
   char mode;
   char reg;
   int work_mode;
   Long dest_data;
 
-  char size = ((code >> 6) & 0x03);
+  char size = ((code2 >> 6) & 0x03);
   if (size == 3) return IllegalInstruction();
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
 
   src_data = imi_get(size);
 
@@ -232,7 +233,7 @@ static bool Addi(char code) {
   }
 
 #ifdef TEST_CCR
-  short before = sr & 0x1f;
+  short before = GetSr() & 0x1f;
 #endif
 
   /* Add演算 */
@@ -264,18 +265,18 @@ static bool Addi(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Subi(char code) {
+static bool Subi(char code1, char code2) {
   Long src_data;
   char mode;
   char reg;
   int work_mode;
   Long dest_data;
 
-  char size = ((code >> 6) & 0x03);
+  char size = ((code2 >> 6) & 0x03);
   if (size == 3) return IllegalInstruction();
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
 
   src_data = imi_get(size);
 
@@ -291,7 +292,7 @@ static bool Subi(char code) {
   }
 
 #ifdef TEST_CCR
-  short before = sr & 0x1f;
+  short before = GetSr() & 0x1f;
 #endif
 
   /* Sub演算 */
@@ -323,18 +324,18 @@ static bool Subi(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Eori(char code) {
+static bool Eori(char code1, char code2) {
   char mode;
   char reg;
   Long data;
   Long src_data;
   Long work_mode;
 
-  char size = ((code >> 6) & 0x03);
+  char size = ((code2 >> 6) & 0x03);
   if (size == 3) return IllegalInstruction();
 
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   src_data = imi_get(size);
 
@@ -374,13 +375,13 @@ static bool Eori(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Eori_t_ccr() {
+static bool Eori_t_ccr(char code1, char code2) {
   UByte data = imi_get(S_BYTE);
 
 #ifdef TRACE
-  printf("trace: eori_t_ccr src=0x%02X PC=%06lX\n", data, pc - 2);
+  printf("trace: eori_t_ccr src=0x%02X PC=%06lX\n", data, cpu.pc - 2);
 #endif
-  sr ^= (data & CCR_MASK);
+  SetSr(GetSr() ^ (data & CCR_MASK));
   return false;
 }
 
@@ -389,18 +390,18 @@ static bool Eori_t_ccr() {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Cmpi(char code) {
+static bool Cmpi(char code1, char code2) {
   char mode;
   char reg;
   Long src_data;
   short save_x;
   Long dest_data;
 
-  char size = ((code >> 6) & 0x03);
+  char size = ((code2 >> 6) & 0x03);
   if (size == 3) return IllegalInstruction();
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
   save_x = CCR_X_REF();
 
   src_data = imi_get(size);
@@ -410,7 +411,7 @@ static bool Cmpi(char code) {
   }
 
 #ifdef TEST_CCR
-  short before = sr & 0x1f;
+  short before = GetSr() & 0x1f;
 #endif
 
   /* Sub演算 */
@@ -436,18 +437,18 @@ static bool Cmpi(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Btsti(char code) {
+static bool Btsti(char code1, char code2) {
   char mode;
   char reg;
   Long data;
   Long mask = 1;
   int size;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
   unsigned int bitno = imi_get(S_BYTE);
   if (mode == MD_DD) {
     bitno = (bitno % 32);
@@ -489,13 +490,13 @@ static bool Btst(char code1, char code2) {
   Long mask = 1;
   int size;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
   mode = (code2 & 0x38) >> 3;
   reg = (code2 & 0x07);
 
-  unsigned int bitno = rd[(code1 >> 1) & 0x07];
+  unsigned int bitno = cpu.rd[(code1 >> 1) & 0x07];
   if (mode == MD_DD) {
     bitno = (bitno % 32);
     size = S_LONG;
@@ -529,7 +530,7 @@ static bool Btst(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Bchgi(char code) {
+static bool Bchgi(char code1, char code2) {
   char mode;
   char reg;
   Long mask = 1;
@@ -537,8 +538,8 @@ static bool Bchgi(char code) {
   int work_mode;
   Long data;
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
   unsigned int bitno = imi_get(S_BYTE);
 
   if (mode == MD_DD) {
@@ -601,7 +602,7 @@ static bool Bchg(char code1, char code2) {
   mode = (code2 & 0x38) >> 3;
   reg = (code2 & 0x07);
 
-  unsigned int bitno = rd[(code1 >> 1) & 0x07];
+  unsigned int bitno = cpu.rd[(code1 >> 1) & 0x07];
   if (mode == MD_DD) {
     bitno = (bitno % 32);
     size = S_LONG;
@@ -651,7 +652,7 @@ static bool Bchg(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Bclri(char code) {
+static bool Bclri(char code1, char code2) {
   char mode;
   char reg;
   Long data;
@@ -659,8 +660,8 @@ static bool Bclri(char code) {
   int size;
   int work_mode;
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
 
   unsigned int bitno = imi_get(S_BYTE);
   if (mode == MD_DD) {
@@ -722,7 +723,7 @@ static bool Bclr(char code1, char code2) {
   mode = (code2 & 0x38) >> 3;
   reg = (code2 & 0x07);
 
-  unsigned int bitno = rd[(code1 >> 1) & 0x07];
+  unsigned int bitno = cpu.rd[(code1 >> 1) & 0x07];
   if (mode == MD_DD) {
     bitno = (bitno % 32);
     size = S_LONG;
@@ -771,7 +772,7 @@ static bool Bclr(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Bseti(char code) {
+static bool Bseti(char code1, char code2) {
   char mode;
   char reg;
   Long data;
@@ -779,8 +780,8 @@ static bool Bseti(char code) {
   int size;
   int work_mode;
 
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
 
   unsigned int bitno = imi_get(S_BYTE);
   if (mode == MD_DD) {
@@ -842,7 +843,7 @@ static bool Bset(char code1, char code2) {
   mode = (code2 & 0x38) >> 3;
   reg = (code2 & 0x07);
 
-  unsigned int bitno = rd[(code1 >> 1) & 0x07];
+  unsigned int bitno = cpu.rd[(code1 >> 1) & 0x07];
   if (mode == MD_DD) {
     bitno = (bitno % 32);
     size = S_LONG;
@@ -897,22 +898,22 @@ static bool Movep_f(char code1, char code2) {
 
   d_reg = ((code1 >> 1) & 0x07);
   a_reg = (code2 & 0x07);
-  Long adr = ra[a_reg] + extl(imi_get_word());
+  Long adr = cpu.ra[a_reg] + extl(imi_get_word());
 
   if ((code2 & 0x40) != 0) {
     /* LONG */
-    mem_set(adr, ((rd[d_reg] >> 24) & 0xFF), S_BYTE);
-    mem_set(adr + 2, ((rd[d_reg] >> 16) & 0xFF), S_BYTE);
-    mem_set(adr + 4, ((rd[d_reg] >> 8) & 0xFF), S_BYTE);
-    mem_set(adr + 6, rd[d_reg] & 0xFF, S_BYTE);
+    mem_set(adr, ((cpu.rd[d_reg] >> 24) & 0xFF), S_BYTE);
+    mem_set(adr + 2, ((cpu.rd[d_reg] >> 16) & 0xFF), S_BYTE);
+    mem_set(adr + 4, ((cpu.rd[d_reg] >> 8) & 0xFF), S_BYTE);
+    mem_set(adr + 6, cpu.rd[d_reg] & 0xFF, S_BYTE);
   } else {
     /* WORD */
-    mem_set(adr, ((rd[d_reg] >> 8) & 0xFF), S_BYTE);
-    mem_set(adr + 2, rd[d_reg] & 0xFF, S_BYTE);
+    mem_set(adr, ((cpu.rd[d_reg] >> 8) & 0xFF), S_BYTE);
+    mem_set(adr + 2, cpu.rd[d_reg] & 0xFF, S_BYTE);
   }
 
 #ifdef TRACE
-  printf("trace: movep_f  src=%d PC=%06lX\n", rd[d_reg], pc - 2);
+  printf("trace: movep_f  src=%d PC=%06lX\n", cpu.rd[d_reg], cpu.pc - 2);
 #endif
 
   return false;
@@ -930,95 +931,199 @@ static bool Movep_t(char code1, char code2) {
 
   d_reg = ((code1 >> 1) & 0x07);
   a_reg = (code2 & 0x07);
-  Long adr = ra[a_reg] + extl(imi_get_word());
+  Long adr = cpu.ra[a_reg] + extl(imi_get_word());
 
   data = mem_get(adr, S_BYTE);
   data = ((data << 8) | (mem_get(adr + 2, S_BYTE) & 0xFF));
   if ((code2 & 0x40) != 0) { /* LONG */
     data = ((data << 8) | (mem_get(adr + 4, S_BYTE) & 0xFF));
     data = ((data << 8) | (mem_get(adr + 6, S_BYTE) & 0xFF));
-    rd[d_reg] = data;
+    cpu.rd[d_reg] = data;
   } else {
-    rd[d_reg] = ((rd[d_reg] & 0xFFFF0000) | (data & 0xFFFF));
+    cpu.rd[d_reg] = ((cpu.rd[d_reg] & 0xFFFF0000) | (data & 0xFFFF));
   }
 
 #ifdef TRACE
-  printf("trace: movep_t  PC=%06lX\n", pc - 2);
+  printf("trace: movep_t  PC=%06lX\n", cpu.pc - 2);
 #endif
 
   return false;
 }
 
 /*
- 　機能：0ライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
+ 　機能：0ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 不当命令)
 */
-bool line0(char *pc_ptr) {
-  char code1, code2;
+// イミディエイト命令の種類
+typedef enum {
+  IMM_OR,
+  IMM_AND,
+  IMM_SUB,
+  IMM_ADD,
+  IMM_EOR,
+  IMM_CMP,
+  IMM_KINDS,
+} ImmediateOp;
+
+// アドレッシングモードとサイズを固定したori / andi / subi / addi / eori /
+// cmpi命令
+//   アドレッシングモードは命令表の作成時に確認済み。
+static inline bool immediateEa(ImmediateOp op, int size, int mode,
+                               char code2) {
+  int reg = code2 & 0x07;
+  Long src_data = imi_get((char)size);
+
+  if (op == IMM_CMP) {
+    // cmpiは書き込まず、Xフラグも変化しない
+    Long dest_data = ReadEa(mode, reg, size);
+    cmp_conditions(src_data, dest_data, dest_data - src_data, size);
+    return false;
+  }
+
+  Long adr = 0;
+  Long dest_data = ReadModifyEa(mode, reg, size, &adr);
+  Long result;
+
+  switch (op) {
+    case IMM_OR:
+      result = dest_data | src_data;
+      break;
+    case IMM_AND:
+      result = dest_data & src_data;
+      break;
+    case IMM_SUB:
+      result = dest_data - src_data;
+      break;
+    case IMM_ADD:
+      result = dest_data + src_data;
+      break;
+    default: /* IMM_EOR */
+      result = dest_data ^ src_data;
+      break;
+  }
+  WriteModifiedEa(mode, reg, size, adr, result);
+
+  if (op == IMM_ADD)
+    add_conditions(src_data, dest_data, result, size, true);
+  else if (op == IMM_SUB)
+    sub_conditions(src_data, dest_data, result, size, true);
+  else
+    general_conditions(result, size);
+  return false;
+}
 
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
+// 命令、サイズ、書き込み先の組み合わせごとにハンドラを作る(X-macro)
+//   書き込み先はデータレジスタと書き込み可能なメモリのみ。
+#define IMMEDIATE_DST_MODE_LIST(X, name, op, size) \
+  X(name, op, size, DD)                            \
+  X(name, op, size, AI)                            \
+  X(name, op, size, AIPI)                          \
+  X(name, op, size, AIPD)                          \
+  X(name, op, size, AID)                           \
+  X(name, op, size, AIX)                           \
+  X(name, op, size, SRT)                           \
+  X(name, op, size, LNG)
+
+#define IMMEDIATE_SIZE_LIST(X, name, op)     \
+  IMMEDIATE_DST_MODE_LIST(X, name, op, BYTE) \
+  IMMEDIATE_DST_MODE_LIST(X, name, op, WORD) \
+  IMMEDIATE_DST_MODE_LIST(X, name, op, LONG)
+
+#define IMMEDIATE_LIST(X)               \
+  IMMEDIATE_SIZE_LIST(X, Ori, IMM_OR)   \
+  IMMEDIATE_SIZE_LIST(X, Andi, IMM_AND) \
+  IMMEDIATE_SIZE_LIST(X, Subi, IMM_SUB) \
+  IMMEDIATE_SIZE_LIST(X, Addi, IMM_ADD) \
+  IMMEDIATE_SIZE_LIST(X, Eori, IMM_EOR) \
+  IMMEDIATE_SIZE_LIST(X, Cmpi, IMM_CMP)
+
+#define DEFINE_IMMEDIATE_HANDLER(name, op, size, dst)         \
+  static bool name##_##size##_##dst(char code1, char code2) { \
+    return immediateEa(op, S_##size, EA_##dst, code2);        \
+  }
+IMMEDIATE_LIST(DEFINE_IMMEDIATE_HANDLER)
+#undef DEFINE_IMMEDIATE_HANDLER
+
+// [命令][サイズ][書き込み先]
+static const InstructionHandler immediateHandlers[IMM_KINDS][S_LONG + 1]
+                                                 [EA_LNG + 1] = {
+#define IMMEDIATE_HANDLER_ENTRY(name, op, size, dst) \
+  [op][S_##size][EA_##dst] = name##_##size##_##dst,
+    IMMEDIATE_LIST(IMMEDIATE_HANDLER_ENTRY)
+#undef IMMEDIATE_HANDLER_ENTRY
+};
+
+// イミディエイト命令のハンドラを得る
+//   不正なサイズやアドレッシングモードは汎用のハンドラでエラーにする。
+static InstructionHandler decodeImmediate(ImmediateOp op,
+                                          InstructionHandler generic,
+                                          char code2) {
+  int size = (code2 >> 6) & 0x03;
+  int dst = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+  if (size > S_LONG || dst == EA_AD || dst > EA_LNG) return generic;
+  return immediateHandlers[op][size][dst];
+}
 
+InstructionHandler decodeLine0(char code1, char code2) {
   switch (code1) {
     case 0x00:
       if (code2 == 0x3C)
-        return (Ori_t_ccr());
+        return Ori_t_ccr;
       else if (code2 == 0x7C)
-        return (Ori_t_sr());
+        return Ori_t_sr;
       else
-        return (Ori(code2));
+        return decodeImmediate(IMM_OR, Ori, code2);
     case 0x02:
       if (code2 == 0x3C)
-        return (Andi_t_ccr());
+        return Andi_t_ccr;
       else if (code2 == 0x7C)
-        return (Andi_t_sr());
+        return Andi_t_sr;
       else
-        return (Andi(code2));
+        return decodeImmediate(IMM_AND, Andi, code2);
     case 0x04:
-      return (Subi(code2));
+      return decodeImmediate(IMM_SUB, Subi, code2);
     case 0x06:
-      return (Addi(code2));
+      return decodeImmediate(IMM_ADD, Addi, code2);
     case 0x08:
       switch (code2 & 0xC0) {
         case 0x00:
-          return (Btsti(code2));
+          return Btsti;
         case 0x40:
-          return (Bchgi(code2));
+          return Bchgi;
         case 0x80:
-          return (Bclri(code2));
+          return Bclri;
         default: /* 0xC0 */
-          return (Bseti(code2));
+          return Bseti;
       }
     case 0x0A:
-      if (code2 == 0x3C) return (Eori_t_ccr());
+      if (code2 == 0x3C) return Eori_t_ccr;
       if (code2 == 0x7C) { /* eori to SR */
         break;
       }
-      return (Eori(code2));
+      return decodeImmediate(IMM_EOR, Eori, code2);
     case 0x0C:
-      return (Cmpi(code2));
+      return decodeImmediate(IMM_CMP, Cmpi, code2);
     default:
       if ((code2 & 0x38) == 0x08) {
         if ((code2 & 0x80) != 0)
-          return (Movep_f(code1, code2));
+          return Movep_f;
         else
-          return (Movep_t(code1, code2));
+          return Movep_t;
       }
       switch (code2 & 0xC0) {
         case 0x00:
-          return (Btst(code1, code2));
+          return Btst;
         case 0x40:
-          return (Bchg(code1, code2));
+          return Bchg;
         case 0x80:
-          return (Bclr(code1, code2));
+          return Bclr;
         default: /* 0xC0 */
-          return (Bset(code1, code2));
+          return Bset;
       }
   }
 
-  return IllegalInstruction();
+  return NULL;
 }
 
 /* $Id: line0.c,v 1.2 2009-08-08 06:49:44 masamic Exp $ */
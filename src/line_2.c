@@ -18,25 +18,22 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "eaaccess.h"
 #include "run68.h"
 
 /*
- 　機能：1/2/3ライン命令(move / movea)を実行する
+ 　機能：move / movea命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-bool line2(char *pc_ptr) {
+static bool Move(char code1, char code2) {
   char src_mode;
   char dst_mode;
   char src_reg;
   char dst_reg;
-  char code1, code2;
   Long src_data;
   int size;
 
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
   dst_reg = ((code1 & 0x0E) >> 1);
   dst_mode = (((code1 & 0x01) << 2) | ((code2 >> 6) & 0x03));
   src_mode = ((code2 & 0x38) >> 3);
@@ -91,6 +88,92 @@ bool line2(char *pc_ptr) {
   return false;
 }
 
+// アドレッシングモードとサイズを固定したmove / movea命令
+//   アドレッシングモードは命令表の作成時に確認済み。
+static inline bool moveEa(int size, int srcMode, int dstMode, char code1,
+                          char code2) {
+  Long src_data = ReadEa(srcMode, code2 & 0x07, size);
+  int dst_reg = (code1 >> 1) & 0x07;
+
+  if (dstMode == EA_AD) {
+    // movea.wは符号拡張する、フラグは変化しない
+    cpu.ra[dst_reg] = (size == S_WORD) ? extl((Word)src_data) : src_data;
+    return false;
+  }
+
+  WriteEa(dstMode, dst_reg, size, src_data);
+  general_conditions(src_data, size);
+  return false;
+}
+
+// サイズ、転送元、転送先の組み合わせごとにmove命令ハンドラを作る(X-macro)
+//   転送先は書き込み可能なアドレッシングモードのみ。
+//   MOVE.B An,<ea>、MOVEA.B <ea>,Anは不正命令だが、表を単純にするため
+//   ハンドラは作っておく(命令表には登録されない)。
+#define MOVE_DST_MODE_LIST(X, size, src) \
+  X(size, src, DD)                       \
+  X(size, src, AD)                       \
+  X(size, src, AI)                       \
+  X(size, src, AIPI)                     \
+  X(size, src, AIPD)                     \
+  X(size, src, AID)                      \
+  X(size, src, AIX)                      \
+  X(size, src, SRT)                      \
+  X(size, src, LNG)
+
+#define MOVE_SRC_MODE_LIST(X, size) \
+  MOVE_DST_MODE_LIST(X, size, DD)   \
+  MOVE_DST_MODE_LIST(X, size, AD)   \
+  MOVE_DST_MODE_LIST(X, size, AI)   \
+  MOVE_DST_MODE_LIST(X, size, AIPI) \
+  MOVE_DST_MODE_LIST(X, size, AIPD) \
+  MOVE_DST_MODE_LIST(X, size, AID)  \
+  MOVE_DST_MODE_LIST(X, size, AIX)  \
+  MOVE_DST_MODE_LIST(X, size, SRT)  \
+  MOVE_DST_MODE_LIST(X, size, LNG)  \
+  MOVE_DST_MODE_LIST(X, size, PC)   \
+  MOVE_DST_MODE_LIST(X, size, PCX)  \
+  MOVE_DST_MODE_LIST(X, size, IM)
+
+#define MOVE_LIST(X)          \
+  MOVE_SRC_MODE_LIST(X, BYTE) \
+  MOVE_SRC_MODE_LIST(X, WORD) \
+  MOVE_SRC_MODE_LIST(X, LONG)
+
+#define DEFINE_MOVE_HANDLER(size, src, dst)                         \
+  static bool Move_##size##_##src##_##dst(char code1, char code2) { \
+    return moveEa(S_##size, EA_##src, EA_##dst, code1, code2);      \
+  }
+MOVE_LIST(DEFINE_MOVE_HANDLER)
+#undef DEFINE_MOVE_HANDLER
+
+// [サイズ][転送元][転送先]
+static const InstructionHandler moveHandlers[S_LONG + 1][EA_IM + 1]
+                                            [EA_LNG + 1] = {
+#define MOVE_HANDLER_ENTRY(size, src, dst) \
+  [S_##size][EA_##src][EA_##dst] = Move_##size##_##src##_##dst,
+    MOVE_LIST(MOVE_HANDLER_ENTRY)
+#undef MOVE_HANDLER_ENTRY
+};
+
+/*
+ 　機能：1/2/3ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
+*/
+InstructionHandler decodeLine2(char code1, char code2) {
+  static const int sizes[] = {-1, S_BYTE, S_LONG, S_WORD};
+  int size = sizes[(code1 >> 4) & 0x03];
+  int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+  int dst = GetEaMode(((code1 & 0x01) << 2) | ((code2 >> 6) & 0x03),
+                      (code1 >> 1) & 0x07);
+
+  // 不正なアドレッシングモードなどは汎用のハンドラでエラーにする
+  if (size < 0 || src > EA_IM || dst > EA_LNG) return Move;
+  if (size == S_BYTE && (src == EA_AD || dst == EA_AD)) return Move;
+
+  return moveHandlers[size][src][dst];
+}
+
 /* $Id: line2.c,v 1.3 2009-08-08 06:49:44 masamic Exp $ */
 
 /*
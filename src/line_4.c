@@ -19,6 +19,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "bcd.h"
+#include "fusion.h"
 #include "iocscall.h"
 #include "operate.h"
 #include "run68.h"
@@ -39,18 +41,18 @@ static bool Lea(char code1, char code2) {
   int dst_reg;
   Long save_pc;
 
-  save_pc = pc;
+  save_pc = cpu.pc;
   mode = ((code2 & 0x38) >> 3);
   src_reg = (code2 & 0x07);
   dst_reg = ((code1 & 0x0E) >> 1);
 
   /* ソースのアドレッシングモードに応じた処理 */
-  if (get_ea(save_pc, EA_Control, mode, src_reg, &(ra[dst_reg]))) {
+  if (get_ea(save_pc, EA_Control, mode, src_reg, &(cpu.ra[dst_reg]))) {
     return true;
   }
 
 #ifdef TRACE
-  printf("trace: lea      src=%d PC=%06lX\n", ra[dst_reg], save_pc);
+  printf("trace: lea      src=%d PC=%06lX\n", cpu.ra[dst_reg], save_pc);
 #endif
 
   return false;
@@ -61,19 +63,19 @@ static bool Lea(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Link(char code) {
+static bool Link(char code1, char code2) {
   short len;
 
-  int reg = (code & 0x07);
+  int reg = (code2 & 0x07);
   len = (short)imi_get(S_WORD);
 
-  ra[7] -= 4;
-  mem_set(ra[7], ra[reg], S_LONG);
-  ra[reg] = ra[7];
-  ra[7] += len;
+  cpu.ra[7] -= 4;
+  mem_set(cpu.ra[7], cpu.ra[reg], S_LONG);
+  cpu.ra[reg] = cpu.ra[7];
+  cpu.ra[7] += len;
 
 #ifdef TRACE
-  printf("trace: link     len=%d PC=%06lX\n", len, pc - 2);
+  printf("trace: link     len=%d PC=%06lX\n", len, cpu.pc - 2);
 #endif
 
   return false;
@@ -84,15 +86,15 @@ static bool Link(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Unlk(char code) {
-  int reg = (code & 0x07);
+static bool Unlk(char code1, char code2) {
+  int reg = (code2 & 0x07);
 
-  ra[7] = ra[reg];
-  ra[reg] = mem_get(ra[7], S_LONG);
-  ra[7] += 4;
+  cpu.ra[7] = cpu.ra[reg];
+  cpu.ra[reg] = mem_get(cpu.ra[7], S_LONG);
+  cpu.ra[7] += 4;
 
 #ifdef TRACE
-  printf("trace: unlk     PC=%06lX\n", pc);
+  printf("trace: unlk     PC=%06lX\n", cpu.pc);
 #endif
 
   return false;
@@ -103,12 +105,12 @@ static bool Unlk(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Tas(char code) {
+static bool Tas(char code1, char code2) {
   Long data;
   int work_mode;
 
-  char mode = ((code & 0x38) >> 3);
-  char reg = (code & 0x07);
+  char mode = ((code2 & 0x38) >> 3);
+  char reg = (code2 & 0x07);
 
   if (mode == EA_AD || (mode == 7 && reg > 1)) return IllegalInstruction();
 
@@ -148,18 +150,18 @@ static bool Tas(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Tst(char code) {
+static bool Tst(char code1, char code2) {
   char size;
   char mode;
   char reg;
   Long data;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  size = ((code >> 6) & 0x03);
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  size = ((code2 >> 6) & 0x03);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   if (get_data_at_ea(EA_VariableData, mode, reg, size, &data)) {
     return true;
@@ -180,22 +182,22 @@ static bool Tst(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Pea(char code) {
+static bool Pea(char code1, char code2) {
   char mode;
   char reg;
   Long data;
   Long save_pc;
 
-  save_pc = pc;
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  save_pc = cpu.pc;
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   if (get_ea(save_pc, EA_Control, mode, reg, &data)) {
     return true;
   }
 
-  ra[7] -= 4;
-  mem_set(ra[7], data, S_LONG);
+  cpu.ra[7] -= 4;
+  mem_set(cpu.ra[7], data, S_LONG);
 
 #ifdef TRACE
   printf("trace: pea      src=%d PC=%06lX\n", data, save_pc);
@@ -204,12 +206,86 @@ static bool Pea(char code) {
   return false;
 }
 
+// レジスタリストの1バイト分(8レジスタ)に含まれるレジスタ番号の一覧
+typedef struct {
+  UByte count;
+  UByte regs[8];
+} RegisterList;
+
+static RegisterList registerLists[256];
+static UByte reversedBits[256];  // ビット順を逆にした値
+
+// 表は命令表の作成時に用意し、以後は書き換えない(スレッド間で共有する)。
+static void initRegisterLists(void) {
+  static bool initialized = false;
+  if (initialized) return;
+  initialized = true;
+
+  for (int bits = 0; bits < 256; bits += 1) {
+    RegisterList* list = &registerLists[bits];
+    UByte reversed = 0;
+
+    for (int i = 0; i < 8; i += 1) {
+      if (bits & (1 << i)) {
+        list->regs[list->count++] = i;
+        reversed |= 0x80 >> i;
+      }
+    }
+    reversedBits[bits] = reversed;
+  }
+}
+
+// レジスタリストの転送バイト数を得る。
+static ULong getMovemLength(UWord rlist, int size2) {
+  return (registerLists[rlist & 0xff].count + registerLists[rlist >> 8].count) *
+         size2;
+}
+
+/*
+ 　機能：movem from reg命令の転送範囲全体が書き込み可能なら、まとめて転送する
+   引数：UWord rlist  <in>  レジスタリスト(下位バイトからd0-d7、a0-a7の順)
+         Long  adr    <in>  転送先の先頭アドレス
+         int   size2  <in>  1レジスタの転送バイト数
+         int   pdReg  <in>  -(An)の場合のAnのレジスタ番号(それ以外は-1)
+         Long  pdOrig <in>  -(An)の場合のAnの元の値
+ 戻り値： true = 転送した
+         false = 範囲の途中でバスエラーになる(1レジスタずつ転送すること)
+*/
+static bool movemToMemoryBulk(UWord rlist, Long adr, int size2, int pdReg,
+                              Long pdOrig) {
+  ULong len = getMovemLength(rlist, size2);
+  Span mem = GetWritableMemory(adr, len);
+  if (!mem.bufptr) return false;
+
+  char* p = mem.bufptr;
+  ULong n = len / size2;
+  ULong j = 0;
+  for (int half = 0; half < 2; half += 1) {
+    const RegisterList* list = &registerLists[(rlist >> (half * 8)) & 0xff];
+    Long* regs = half ? cpu.ra : cpu.rd;
+
+    for (int k = 0; k < list->count; k += 1, j += 1, p += size2) {
+      int i = list->regs[k];
+      Long data = regs[i];
+
+      // -(An)のAnは、退避する時点(上位アドレス側から順に退避)の値になる
+      if (half && i == pdReg) data = pdOrig - (Long)((n - j) * size2);
+
+      if (size2 == 4)
+        PokeL(p, data);
+      else
+        PokeW(p, data);
+    }
+  }
+  return true;
+}
+
 /*
  　機能：movem from reg命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Movem_f(char code) {
+static bool Movem_f(char code1, char code2) {
   Long mem_adr;
   char mode;
   int reg;
@@ -221,16 +297,16 @@ static bool Movem_f(char code) {
   int i;
   int work_mode;
 
-  save_pc = pc;
-  if ((code & 0x40) != 0) {
+  save_pc = cpu.pc;
+  if ((code2 & 0x40) != 0) {
     size = S_LONG;
     size2 = 4;
   } else {
     size = S_WORD;
     size2 = 2;
   }
-  mode = (code & 0x38) >> 3;
-  reg = (code & 0x07);
+  mode = (code2 & 0x38) >> 3;
+  reg = (code2 & 0x07);
   rlist = (short)imi_get(S_WORD);
 
   // アドレッシングモードが MD_AIPD の場合は、
@@ -247,29 +323,42 @@ static bool Movem_f(char code) {
   }
 
   if (mode == MD_AIPD) {
+    // 転送範囲が書き込み可能ならまとめて転送する
+    // (-(An)のレジスタリストはa7-a0、d7-d0の順なのでビット順を逆にする)
+    UWord list = (reversedBits[rlist & 0xff] << 8) |
+                 reversedBits[(rlist >> 8) & 0xff];
+    ULong len = getMovemLength(list, size2);
+    if (movemToMemoryBulk(list, mem_adr - len, size2, reg, cpu.ra[reg])) {
+      cpu.ra[reg] -= len;
+      return false;
+    }
+
     // アドレスレジスタの退避
     for (i = 7; i >= 0; i--, mask <<= 1) {
       if ((rlist & mask) != 0) {
-        ra[reg] -= size2;
+        cpu.ra[reg] -= size2;
         mem_adr -= size2;
-        mem_set(mem_adr, ra[i], size);
+        mem_set(mem_adr, cpu.ra[i], size);
       }
     }
 
     // データレジスタの退避
     for (i = 7; i >= 0; i--, mask <<= 1) {
       if ((rlist & mask) != 0) {
-        ra[reg] -= size2;
+        cpu.ra[reg] -= size2;
         mem_adr -= size2;
-        mem_set(mem_adr, rd[i], size);
+        mem_set(mem_adr, cpu.rd[i], size);
       }
     }
 
   } else {
+    // 転送範囲が書き込み可能ならまとめて転送する
+    if (movemToMemoryBulk(rlist, mem_adr, size2, -1, 0)) return false;
+
     // データレジスタの退避
     for (i = 0; i <= 7; i++, mask <<= 1) {
       if ((rlist & mask) != 0) {
-        mem_set(mem_adr, rd[i], size);
+        mem_set(mem_adr, cpu.rd[i], size);
         mem_adr += size2;
       }
     }
@@ -277,7 +366,7 @@ static bool Movem_f(char code) {
     // アドレスレジスタの退避
     for (i = 0; i <= 7; i++, mask <<= 1) {
       if ((rlist & mask) != 0) {
-        mem_set(mem_adr, ra[i], size);
+        mem_set(mem_adr, cpu.ra[i], size);
         mem_adr += size2;
       }
     }
@@ -295,16 +384,16 @@ static bool Movem_f(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Movem_t(char code) {
+static bool Movem_t(char code1, char code2) {
   bool isWord = false;
   int size2 = 4;
 
-  if ((code & 0x40) == 0) {
+  if ((code2 & 0x40) == 0) {
     isWord = true;
     size2 = 2;
   }
-  char mode = (code & 0x38) >> 3;
-  int reg = (code & 0x07);
+  char mode = (code2 & 0x38) >> 3;
+  int reg = (code2 & 0x07);
   short rlist = (short)imi_get(S_WORD);
 
   // アドレッシングモードが MD_AIPI の場合は、
@@ -313,16 +402,33 @@ static bool Movem_t(char code) {
 
   /* アドレッシングモードに応じた処理 */
   Long mem_adr;
-  if (get_ea(pc, EA_PostIncrement, work_mode, reg, &mem_adr)) {
+  if (get_ea(cpu.pc, EA_PostIncrement, work_mode, reg, &mem_adr)) {
     return true;
   }
 
+  // 転送範囲(と余計に読み込む1ワード)が読み込み可能ならまとめて転送する
+  ULong len = getMovemLength(rlist, size2);
+  Span mem = GetReadableMemory(mem_adr, len + 2);
+  if (mem.bufptr) {
+    char* p = mem.bufptr;
+    for (int half = 0; half < 2; half += 1) {
+      const RegisterList* list = &registerLists[(rlist >> (half * 8)) & 0xff];
+      Long* regs = half ? cpu.ra : cpu.rd;
+
+      for (int k = 0; k < list->count; k += 1, p += size2) {
+        regs[list->regs[k]] = isWord ? extl(PeekW(p)) : (Long)PeekL(p);
+      }
+    }
+    if (mode == MD_AIPI) cpu.ra[reg] = mem_adr + len;
+    return false;
+  }
+
   // データレジスタの復帰
   short mask = 1;
   int i;
   for (i = 0; i <= 7; i++, mask <<= 1) {
     if ((rlist & mask) != 0) {
-      rd[i] =
+      cpu.rd[i] =
           isWord ? extl(mem_get(mem_adr, S_WORD)) : mem_get(mem_adr, S_LONG);
       mem_adr += size2;
     }
@@ -331,7 +437,7 @@ static bool Movem_t(char code) {
   // アドレスレジスタの復帰
   for (i = 0; i <= 7; i++, mask <<= 1) {
     if ((rlist & mask) != 0) {
-      ra[i] =
+      cpu.ra[i] =
           isWord ? extl(mem_get(mem_adr, S_WORD)) : mem_get(mem_adr, S_LONG);
       mem_adr += size2;
     }
@@ -340,7 +446,7 @@ static bool Movem_t(char code) {
   // 余計に1ワード読み込む挙動の再現
   mem_get(mem_adr, S_WORD);
 
-  if (mode == MD_AIPI) ra[reg] = mem_adr;
+  if (mode == MD_AIPI) cpu.ra[reg] = mem_adr;
 
   return false;
 }
@@ -350,19 +456,19 @@ static bool Movem_t(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Move_f_sr(char code) {
+static bool Move_f_sr(char code1, char code2) {
   char mode;
   char reg;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   /* ディスティネーションのアドレッシングモードに応じた処理 */
   // ※アクセス権限がEA_ALLになっているが、これは後でチェックの必要がある
-  if (set_data_at_ea(EA_All, mode, reg, S_WORD, (Long)sr)) {
+  if (set_data_at_ea(EA_All, mode, reg, S_WORD, (Long)GetSr())) {
     return true;
   }
 
@@ -378,12 +484,12 @@ static bool Move_f_sr(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Move_t_sr(char code) {
+static bool Move_t_sr(char code1, char code2) {
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
-  int mode = ((code & 0x38) >> 3);
-  int reg = (code & 0x07);
+  int mode = ((code2 & 0x38) >> 3);
+  int reg = (code2 & 0x07);
 
   if (SR_S_REF() == 0) {
     err68a("特権命令を実行しました", __FILE__, __LINE__);
@@ -395,7 +501,7 @@ static bool Move_t_sr(char code) {
   if (get_data_at_ea(EA_All, mode, reg, S_WORD, &data)) {
     return true;
   }
-  sr = data & (SR_MASK | CCR_MASK);
+  SetSr(data & (SR_MASK | CCR_MASK));
 
 #ifdef TRACE
   printf("trace: move_t_sr PC=%06lX\n", save_pc);
@@ -409,24 +515,24 @@ static bool Move_t_sr(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Move_f_usp(char code) {
+static bool Move_f_usp(char code1, char code2) {
   int reg;
 
   if (SR_S_REF() == 0) {
     err68a("特権命令を実行しました", __FILE__, __LINE__);
   }
 
-  reg = (code & 0x07);
+  reg = (code2 & 0x07);
 
 #ifdef TRACE
-  printf("trace: move_f_usp PC=%06lX\n", pc);
+  printf("trace: move_f_usp PC=%06lX\n", cpu.pc);
 #endif
 
-  if (usp == 0) {
+  if (cpu.usp == 0) {
     err68("MOVE FROM USP命令を実行しました");
   }
 
-  ra[reg] = usp;
+  cpu.ra[reg] = cpu.usp;
 
   return false;
 }
@@ -436,7 +542,7 @@ static bool Move_f_usp(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Move_t_usp(char code) {
+static bool Move_t_usp(char code1, char code2) {
   if (SR_S_REF() == 0) {
     err68a("特権命令を実行しました", __FILE__, __LINE__);
   }
@@ -449,12 +555,12 @@ static bool Move_t_usp(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Move_t_ccr(char code) {
+static bool Move_t_ccr(char code1, char code2) {
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
-  int mode = ((code & 0x38) >> 3);
-  int reg = (code & 0x07);
+  int mode = ((code2 & 0x38) >> 3);
+  int reg = (code2 & 0x07);
 
   /* ソースのアドレッシングモードに応じた処理 */
   // ※アクセス権限がEA_ALLになっているが、これは後でチェックの必要がある
@@ -462,7 +568,7 @@ static bool Move_t_ccr(char code) {
   if (get_data_at_ea(EA_All, mode, reg, S_WORD, &data)) {
     return true;
   }
-  sr = (sr & ~CCR_MASK) | (data & CCR_MASK);
+  SetSr((cpu.sr & ~CCR_MASK) | (data & CCR_MASK));
 
 #ifdef TRACE
   printf("trace: move_t_ccr PC=%06lX\n", save_pc);
@@ -476,18 +582,18 @@ static bool Move_t_ccr(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Swap(char code) {
+static bool Swap(char code1, char code2) {
   Long data;
   Long data2;
 
-  int reg = (code & 0x07);
-  data = ((rd[reg] >> 16) & 0xFFFF);
-  data2 = ((rd[reg] & 0xFFFF) << 16);
+  int reg = (code2 & 0x07);
+  data = ((cpu.rd[reg] >> 16) & 0xFFFF);
+  data2 = ((cpu.rd[reg] & 0xFFFF) << 16);
   data |= data2;
-  rd[reg] = data;
+  cpu.rd[reg] = data;
 
 #ifdef TRACE
-  printf("trace: swap     PC=%06lX\n", pc);
+  printf("trace: swap     PC=%06lX\n", cpu.pc);
 #endif
 
   /* フラグの変化 */
@@ -501,19 +607,19 @@ static bool Swap(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Clr(char code) {
+static bool Clr(char code1, char code2) {
   char size;
   char mode;
   char reg;
   Long data;
   int work_mode;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  size = ((code >> 6) & 0x03);
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  size = ((code2 >> 6) & 0x03);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   /* ここでわざわざ使いもしない値をリードしているのは */
   /* 68000の仕様がそうなっているため。 */
@@ -558,32 +664,32 @@ static bool Clr(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Ext(char code) {
+static bool Ext(char code1, char code2) {
   char size;
 
-  int reg = (code & 0x07);
-  if ((code & 0x40) != 0)
+  int reg = (code2 & 0x07);
+  if ((code2 & 0x40) != 0)
     size = S_LONG;
   else
     size = S_WORD;
 
   if (size == S_WORD) {
-    if ((rd[reg] & 0x80) != 0)
-      rd[reg] |= 0xFF00;
+    if ((cpu.rd[reg] & 0x80) != 0)
+      cpu.rd[reg] |= 0xFF00;
     else
-      rd[reg] &= 0xFFFF00FF;
+      cpu.rd[reg] &= 0xFFFF00FF;
   } else {
-    if ((rd[reg] & 0x8000) != 0)
-      rd[reg] |= 0xFFFF0000;
+    if ((cpu.rd[reg] & 0x8000) != 0)
+      cpu.rd[reg] |= 0xFFFF0000;
     else
-      rd[reg] &= 0x0000FFFF;
+      cpu.rd[reg] &= 0x0000FFFF;
   }
 
   /* フラグの変化 */
-  general_conditions(rd[reg], size);
+  general_conditions(cpu.rd[reg], size);
 
 #ifdef TRACE
-  printf("trace: ext.%c    PC=%06lX\n", size_char[size], pc);
+  printf("trace: ext.%c    PC=%06lX\n", size_char[size], cpu.pc);
 #endif
 
   return false;
@@ -594,19 +700,19 @@ static bool Ext(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Neg(char code) {
+static bool Neg(char code1, char code2) {
   char size;
   char mode;
   char reg;
   Long data;
   int work_mode;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  size = ((code >> 6) & 0x03);
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  size = ((code2 >> 6) & 0x03);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
   if (mode == EA_AIPI) {
@@ -648,7 +754,7 @@ static bool Neg(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Negx(char code) {
+static bool Negx(char code1, char code2) {
   char size;
   char mode;
   char reg;
@@ -656,12 +762,12 @@ static bool Negx(char code) {
   short save_x;
   int work_mode;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  size = ((code >> 6) & 0x03);
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  size = ((code2 >> 6) & 0x03);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
   if (mode == EA_AIPI) {
@@ -706,19 +812,19 @@ static bool Negx(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Not(char code) {
+static bool Not(char code1, char code2) {
   char size;
   char mode;
   char reg;
   Long data;
   int work_mode;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
-  size = ((code >> 6) & 0x03);
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  size = ((code2 >> 6) & 0x03);
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
   /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
   if (mode == EA_AIPI) {
@@ -765,19 +871,19 @@ static bool Jmp(char code1, char code2) {
   char reg;
   Long save_pc;
 
-  save_pc = pc;
+  save_pc = cpu.pc;
 
   mode = ((code2 & 0x38) >> 3);
   reg = (code2 & 0x07);
 
 #ifdef TRACE
   /* ニーモニックのトレース出力 */
-  printFmt("0x%08x: %s\n", pc, mnemonic);
+  printFmt("0x%08x: %s\n", cpu.pc, mnemonic);
 #endif
 
   /* アドレッシングモードに応じた処理 */
   // ※アクセス権限がEA_ALLになっているが、これは後でチェックの必要がある
-  if (get_ea(save_pc, EA_All, mode, reg, &pc)) {
+  if (get_ea(save_pc, EA_All, mode, reg, &cpu.pc)) {
     return true;
   }
 
@@ -789,18 +895,18 @@ static bool Jmp(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Jsr(char code) {
+static bool Jsr(char code1, char code2) {
   char mode;
   char reg;
   Long data;
   Long save_pc;
 
-  save_pc = pc;
-  mode = ((code & 0x38) >> 3);
-  reg = (code & 0x07);
+  save_pc = cpu.pc;
+  mode = ((code2 & 0x38) >> 3);
+  reg = (code2 & 0x07);
 
 #ifdef TRACE
-  printf("trace: jsr      PC=%06lX\n", pc);
+  printf("trace: jsr      PC=%06lX\n", cpu.pc);
 #endif
 
   /* アドレッシングモードに応じた処理 */
@@ -809,13 +915,13 @@ static bool Jsr(char code) {
     return true;
   }
 
-  ra[7] -= 4;
-  mem_set(ra[7], pc, S_LONG);
-  pc = data;
+  cpu.ra[7] -= 4;
+  mem_set(cpu.ra[7], cpu.pc, S_LONG);
+  cpu.pc = data;
 
 #if defined(DEBUG_JSR)
   printf("%8d: %8d: $%06x JSR    TO $%06x, TOS = $%06x\n", sub_num++,
-         sub_level++, save_pc - 2, pc, mem_get(ra[7], S_LONG));
+         sub_level++, save_pc - 2, cpu.pc, mem_get(cpu.ra[7], S_LONG));
 #endif
 
   return false;
@@ -826,7 +932,7 @@ static bool Jsr(char code) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Trap(char code) {
+static bool Trap(char code1, char code2) {
   static const char* const messages[15] = {
       "trap #0命令を実行しました",  "trap #1命令を実行しました",
       "trap #2命令を実行しました",  "trap #3命令を実行しました",
@@ -839,7 +945,7 @@ static bool Trap(char code) {
       // "trap #15命令を実行しました",
   };
 
-  unsigned int no = code & 0x0f;
+  unsigned int no = code2 & 0x0f;
   if (no == 15) {
     return iocs_call();
   }
@@ -849,11 +955,11 @@ static bool Trap(char code) {
     ULong adr = ReadULongSuper(vecno * 4);
     if (adr != DefaultExceptionHandler[vecno]) {
       SR_S_ON();
-      ra[7] -= 4;
-      mem_set(ra[7], pc, S_LONG);
-      ra[7] -= 2;
-      mem_set(ra[7], sr, S_WORD);
-      pc = adr;
+      cpu.ra[7] -= 4;
+      mem_set(cpu.ra[7], cpu.pc, S_LONG);
+      cpu.ra[7] -= 2;
+      mem_set(cpu.ra[7], GetSr(), S_WORD);
+      cpu.pc = adr;
       return false;
     }
   }
@@ -866,18 +972,18 @@ static bool Trap(char code) {
  戻り値： true = 実行終了
  戻り値：false = 実行継続
 */
-static bool Rte() {
+static bool Rte(char code1, char code2) {
 #ifdef TRACE
-  printf("trace: rte      PC=%06lX\n", pc);
+  printf("trace: rte      PC=%06lX\n", cpu.pc);
 #endif
 
   if (SR_S_REF() == 0) {
     err68a("特権命令を実行しました", __FILE__, __LINE__);
   }
-  sr = mem_get(ra[7], S_WORD) & (SR_MASK | CCR_MASK);
-  ra[7] += 2;
-  pc = mem_get(ra[7], S_LONG);
-  ra[7] += 4;
+  SetSr(mem_get(cpu.ra[7], S_WORD) & (SR_MASK | CCR_MASK));
+  cpu.ra[7] += 2;
+  cpu.pc = mem_get(cpu.ra[7], S_LONG);
+  cpu.ra[7] += 4;
 
   return false;
 }
@@ -886,28 +992,28 @@ static bool Rte() {
  　機能：rts命令を実行する
  戻り値：false = 実行継続
 */
-static bool Rts() {
+static bool Rts(char code1, char code2) {
 #if defined(DEBUG_JSR)
   Long save_pc;
-  save_pc = pc - 2;
+  save_pc = cpu.pc - 2;
 #endif
 
 #ifdef TRACE
-  printf("trace: rts      PC=%06lX\n", pc);
+  printf("trace: rts      PC=%06lX\n", cpu.pc);
 #endif
 
-  pc = mem_get(ra[7], S_LONG);
-  ra[7] += 4;
+  cpu.pc = mem_get(cpu.ra[7], S_LONG);
+  cpu.ra[7] += 4;
 
 #if defined(DEBUG_JSR)
   printf("%8d: %8d: $%06x RETURN TO $%06x\n", sub_num++, --sub_level, save_pc,
-         pc - 2);
+         cpu.pc - 2);
 #endif
 
   return false;
 }
 
-static bool Nbcd(char code2) {
+static bool Nbcd(char code1, char code2) {
   int mode = (code2 >> 3) & 7;
   int reg = code2 & 7;
 
@@ -920,7 +1026,9 @@ static bool Nbcd(char code2) {
   int readMode = (mode == EA_AIPI) ? EA_AI : mode;
   if (get_data_at_ea(EA_All, readMode, reg, S_BYTE, &val)) return true;
 
-  Long result = SubBcd(0, val);
+  UWord ccr = GetSr();
+  Long result = SubBcd(0, val, &ccr);
+  SetSr(ccr);
 
   // NBCD.B -(An)は(An)としてメモリに値を書き込む(読み込み時にデクリメント済み)
   int writeMode = (mode == EA_AIPD) ? EA_AI : mode;
@@ -930,48 +1038,66 @@ static bool Nbcd(char code2) {
 }
 
 /*
- 　機能：4ライン命令を実行する
+ 　機能：nop命令を実行する
+ 戻り値： true = 実行終了
+         false = 実行継続
+*/
+static bool Nop(char code1, char code2) { return false; }
+
+/*
+ 　機能：trapv命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-bool line4(char* pc_ptr) {
-  char code1, code2;
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
+static bool Trapv(char code1, char code2) {
+  err68a("TRAPV命令を実行しました", __FILE__, __LINE__);
+}
+
+// tst命令に続けて直後の条件分岐命令を実行する(命令の融合)
+static bool TstBranch(char code1, char code2) {
+  if (Tst(code1, code2)) return true;
+  FuseBranch(FUSION_TST);
+  return false;
+}
+
+/*
+ 　機能：4ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 不当命令)
+*/
+InstructionHandler decodeLine4(char code1, char code2) {
+  initRegisterLists();
 
   /* lea */
-  if ((code1 & 0x01) == 0x01 && (code2 & 0xC0) == 0xC0)
-    return (Lea(code1, code2));
+  if ((code1 & 0x01) == 0x01 && (code2 & 0xC0) == 0xC0) return Lea;
 
   switch (code1) {
     case 0x40:
       if ((code2 & 0xC0) != 0xC0)
-        return (Negx(code2));
+        return Negx;
       else
-        return (Move_f_sr(code2));
+        return Move_f_sr;
       break;
     case 0x42:
-      if ((code2 & 0xC0) != 0xC0) return (Clr(code2));
+      if ((code2 & 0xC0) != 0xC0) return Clr;
       break;
     case 0x44:
       if ((code2 & 0xC0) != 0xC0)
-        return (Neg(code2));
+        return Neg;
       else
-        return (Move_t_ccr(code2));
+        return Move_t_ccr;
       break;
     case 0x46:
       if ((code2 & 0xC0) == 0xC0)
-        return (Move_t_sr(code2));
+        return Move_t_sr;
       else
-        return (Not(code2));
+        return Not;
       break;
     case 0x48: /* movem_f_reg / swap / pea / ext / nbcd */
       if ((code2 & 0xC0) == 0x40) {
         if ((code2 & 0xF8) == 0x40)
-          return (Swap(code2));
+          return Swap;
         else
-          return (Pea(code2));
+          return Pea;
       } else {
         if ((code2 & 0xC0) == 0) {
           if (((code2 & 0x38) >> 3) == 0x01) {
@@ -979,41 +1105,46 @@ bool line4(char* pc_ptr) {
             ;
           } else {
             /* nbcd */
-            return (Nbcd(code2));
+            return Nbcd;
           }
         }
-        if ((code2 & 0x38) == 0) return (Ext(code2));
-        if ((code2 & 0x80) != 0) return (Movem_f(code2));
+        if ((code2 & 0x38) == 0) return Ext;
+        if ((code2 & 0x80) != 0) return Movem_f;
       }
       break;
     case 0x4A: /* tas / tst */
       if ((code2 & 0xC0) == 0xC0)
-        return (Tas(code2));
+        return Tas;
       else
-        return (Tst(code2));
+        return Tst;
     case 0x4C: /* movem_t_reg */
-      if ((code2 & 0x80) != 0) return (Movem_t(code2));
+      if ((code2 & 0x80) != 0) return Movem_t;
       break;
     case 0x4E:
-      if ((code2 & 0xF0) == 0x40) return (Trap(code2));
-      if (code2 == 0x71) /* nop */
-        return false;
-      if (code2 == 0x73) return (Rte());
-      if (code2 == 0x75) return (Rts());
-      if (code2 == 0x76) {
-        err68a("TRAPV命令を実行しました", __FILE__, __LINE__);
-      }
-      if ((code2 & 0xF8) == 0x50) return (Link(code2));
-      if ((code2 & 0xF8) == 0x58) return (Unlk(code2));
-      if ((code2 & 0xF8) == 0x60) return (Move_t_usp(code2));
-      if ((code2 & 0xF8) == 0x68) return (Move_f_usp(code2));
-      if ((code2 & 0xC0) == 0xC0) return (Jmp(code1, code2));
-      if ((code2 & 0xC0) == 0x80) return (Jsr(code2));
+      if ((code2 & 0xF0) == 0x40) return Trap;
+      if (code2 == 0x71) return Nop;
+      if (code2 == 0x73) return Rte;
+      if (code2 == 0x75) return Rts;
+      if (code2 == 0x76) return Trapv;
+      if ((code2 & 0xF8) == 0x50) return Link;
+      if ((code2 & 0xF8) == 0x58) return Unlk;
+      if ((code2 & 0xF8) == 0x60) return Move_t_usp;
+      if ((code2 & 0xF8) == 0x68) return Move_f_usp;
+      if ((code2 & 0xC0) == 0xC0) return Jmp;
+      if ((code2 & 0xC0) == 0x80) return Jsr;
       if (code2 == 0x77) break;  // rtr
       break;
   }
 
-  return IllegalInstruction();
+  return NULL;
+}
+
+/*
+ 　機能：直後に条件分岐命令が続く場合の融合した命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 融合しない)
+*/
+InstructionHandler fuseLine4(InstructionHandler handler) {
+  return (handler == Tst) ? TstBranch : NULL;
 }
 
 /* $Id: line4.c,v 1.6 2009-08-08 06:49:44 masamic Exp $ */
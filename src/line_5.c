@@ -17,30 +17,183 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
+#include "fusion.h"
+#include "mem.h"
 #include "operate.h"
 #include "run68.h"
 
+// ループ本体の命令のサイズ(move命令のサイズフィールド)
+static const int moveSizes[] = {-1, S_BYTE, S_LONG, S_WORD};
+
+static Long peekSized(char* ptr, int size) {
+  switch (size) {
+    case S_BYTE:
+      return PeekB(ptr);
+    case S_WORD:
+      return PeekW(ptr);
+    default:
+      return PeekL(ptr);
+  }
+}
+
+// (An)+を使うループとして扱えるか調べる。
+//   バイトサイズのA7は2ずつ増えるので対象外。
+static bool isLoopAddressRegister(int reg, int size) {
+  return !(reg == 7 && size == S_BYTE);
+}
+
+// move.<size> (Ay)+,(Ax)+ を count 回実行する。
+static bool copyLoop(UWord body, UWord count) {
+  int size = moveSizes[(body >> 12) & 0x03];
+  int x = (body >> 9) & 0x07;
+  int y = body & 0x07;
+  if (x == y || !isLoopAddressRegister(x, size) ||
+      !isLoopAddressRegister(y, size))
+    return false;
+
+  ULong len = (ULong)count << size;
+  Span src = GetReadableMemory(cpu.ra[y], len);
+  Span dst = GetWritableMemory(cpu.ra[x], len);
+  if (!src.bufptr || !dst.bufptr) return false;
+
+  // 転送先が転送元の後ろに重なっている場合は、先頭から1つずつ転送した結果が
+  // memmove()と異なるので対象外。
+  if (src.bufptr < dst.bufptr && dst.bufptr < src.bufptr + len) return false;
+
+  memmove(dst.bufptr, src.bufptr, len);
+  cpu.ra[y] += len;
+  cpu.ra[x] += len;
+  general_conditions(peekSized(dst.bufptr + len - (1 << size), size), size);
+  return true;
+}
+
+// move.<size> Dy,(Ax)+ を count 回実行する。
+//   Dyがループカウンタなら書き込む値が毎回変わるので対象外。
+static bool fillLoop(UWord body, UWord count, int counterReg) {
+  int size = moveSizes[(body >> 12) & 0x03];
+  int x = (body >> 9) & 0x07;
+  if ((body & 0x07) == counterReg || !isLoopAddressRegister(x, size))
+    return false;
+
+  ULong len = (ULong)count << size;
+  Span dst = GetWritableMemory(cpu.ra[x], len);
+  if (!dst.bufptr) return false;
+
+  Long data = cpu.rd[body & 0x07];
+  switch (size) {
+    case S_BYTE:
+      memset(dst.bufptr, (UByte)data, len);
+      break;
+    case S_WORD:
+      for (ULong i = 0; i < len; i += 2) PokeW(dst.bufptr + i, (UWord)data);
+      break;
+    default:
+      for (ULong i = 0; i < len; i += 4) PokeL(dst.bufptr + i, (ULong)data);
+      break;
+  }
+  cpu.ra[x] += len;
+  general_conditions(data, size);
+  return true;
+}
+
+// cmpm.<size> (Ay)+,(Ax)+ を最大 count 回、一致しなくなるまで実行する。
+//   戻り値：実行した回数(0 = 対象外)
+static ULong compareLoop(UWord body, UWord count) {
+  int size = (body >> 6) & 0x03;
+  int x = (body >> 9) & 0x07;
+  int y = body & 0x07;
+  if (x == y || !isLoopAddressRegister(x, size) ||
+      !isLoopAddressRegister(y, size))
+    return 0;
+
+  ULong len = (ULong)count << size;
+  Span src = GetReadableMemory(cpu.ra[y], len);
+  Span dst = GetReadableMemory(cpu.ra[x], len);
+  if (!src.bufptr || !dst.bufptr) return 0;
+
+  // 一致しなかった要素、またはすべて一致したなら最後の要素まで比較する
+  ULong offset = len - 1;
+  if (memcmp(src.bufptr, dst.bufptr, len) != 0) {
+    for (offset = 0; src.bufptr[offset] == dst.bufptr[offset]; offset += 1) {
+    }
+  }
+  offset &= ~(((ULong)1 << size) - 1);
+
+  Long src_data = peekSized(src.bufptr + offset, size);
+  Long dest_data = peekSized(dst.bufptr + offset, size);
+  ULong n = (offset >> size) + 1;
+  cpu.ra[y] += n << size;
+  cpu.ra[x] += n << size;
+  cmp_conditions(src_data, dest_data, dest_data - src_data, size);
+  return n;
+}
+
+/*
+ 　機能：ループ本体が1命令だけのDBccループを、ホストのメモリ操作でまとめて
+ 　　　　実行する(ループ本体の1回目とDBcc命令の条件判定は実行済み)
+ 戻り値： true = 実行した(DBcc命令の直後に抜けた状態になる)
+         false = 対象外(通常どおり1命令ずつ実行する)
+*/
+static bool runLoopIdiom(int cond, int reg) {
+  UWord count = cpu.rd[reg] & 0xffff;  // 残りの実行回数
+  if (count == 0) return false;
+
+  // DBcc命令の直前の命令(ループ本体)
+  Span mem = GetReadableMemory(cpu.pc - 6, 2);
+  if (!mem.bufptr) return false;
+  UWord body = PeekW(mem.bufptr);
+
+  UWord counter = 0xffff;
+  if (cond == 0x01) {
+    // dbra
+    if ((body & 0xc1f8) == 0x00d8 && (body & 0x3000) != 0) {
+      if (!copyLoop(body, count)) return false;
+    } else if ((body & 0xc1f8) == 0x00c0 && (body & 0x3000) != 0) {
+      if (!fillLoop(body, count, reg)) return false;
+    } else {
+      return false;
+    }
+  } else if (cond == 0x06) {
+    // dbne
+    if ((body & 0xf138) != 0xb108 || (body & 0x00c0) == 0x00c0) return false;
+    ULong n = compareLoop(body, count);
+    if (n == 0) return false;
+    if (n < count || CCR_Z_REF() == 0) counter = count - n;
+  } else {
+    return false;
+  }
+
+  cpu.rd[reg] = (cpu.rd[reg] & 0xffff0000) | counter;
+  return true;
+}
+
 /*
  　機能：dbcc命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-static int Dbcc(char code1, char code2) {
+static bool Dbcc(char code1, char code2) {
   int reg = (code2 & 0x07);
   Word disp16 = imi_get_word();
-  UWord counter = (rd[reg] & 0xFFFF);
+  UWord counter = (cpu.rd[reg] & 0xFFFF);
 
 #ifdef TRACE
-  printf("trace: dbcc     src=%d PC=%06lX\n", counter, pc - 2);
+  printf("trace: dbcc     src=%d PC=%06lX\n", counter, cpu.pc - 2);
 #endif
 
   if (get_cond(code1 & 0x0F)) return false;
 
+  // 1命令だけのループならまとめて実行する
+  if (disp16 == -4 && fusionEnabled && runLoopIdiom(code1 & 0x0F, reg)) {
+    return false;
+  }
+
   counter--;
-  rd[reg] = ((rd[reg] & 0xFFFF0000) | counter);
+  cpu.rd[reg] = ((cpu.rd[reg] & 0xFFFF0000) | counter);
   if (counter != 0xFFFF) {
-    pc += extl(disp16) - 2;
+    cpu.pc += extl(disp16) - 2;
   }
   return false;
 }
@@ -50,7 +203,7 @@ static int Dbcc(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static int Scc(char code1, char code2) {
+static bool Scc(char code1, char code2) {
   char mode;
   char reg;
   Long src_data;
@@ -74,7 +227,7 @@ static int Scc(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static int Addq(char code1, char code2) {
+static bool Addq(char code1, char code2) {
   char size;
   char mode;
   char reg;
@@ -135,7 +288,7 @@ static int Addq(char code1, char code2) {
  戻り値： true = 実行終了
          false = 実行継続
 */
-static int Subq(char code1, char code2) {
+static bool Subq(char code1, char code2) {
   char size;
   char mode;
   char reg;
@@ -190,28 +343,44 @@ static int Subq(char code1, char code2) {
   return false;
 }
 
-/*
- 　機能：5ライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-bool line5(char *pc_ptr) {
-  char code1, code2;
+// addq、subq命令に続けて直後の条件分岐命令を実行する(命令の融合)
+static bool AddqBranch(char code1, char code2) {
+  if (Addq(code1, code2)) return true;
+  FuseBranch(FUSION_ADDQ);
+  return false;
+}
 
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
+static bool SubqBranch(char code1, char code2) {
+  if (Subq(code1, code2)) return true;
+  FuseBranch(FUSION_SUBQ);
+  return false;
+}
 
+/*
+ 　機能：5ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
+*/
+InstructionHandler decodeLine5(char code1, char code2) {
   if ((code2 & 0xC0) == 0xC0) {
     if ((code2 & 0x38) == 0x08)
-      return (Dbcc(code1, code2));
+      return Dbcc;
     else
-      return (Scc(code1, code2));
+      return Scc;
   }
   if ((code1 & 0x01) != 0)
-    return (Subq(code1, code2));
+    return Subq;
   else
-    return (Addq(code1, code2));
+    return Addq;
+}
+
+/*
+ 　機能：直後に条件分岐命令が続く場合の融合した命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 融合しない)
+*/
+InstructionHandler fuseLine5(InstructionHandler handler) {
+  if (handler == Addq) return AddqBranch;
+  if (handler == Subq) return SubqBranch;
+  return NULL;
 }
 
 /* $Id: line5.c,v 1.2 2009-08-08 06:49:44 masamic Exp $ */
@@ -29,39 +29,53 @@
 #include "run68.h"
 
 /*
- 　機能：6ライン命令を実行する
+ 　機能：bsr命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-bool line6(char *pc_ptr) {
-  int cond = (*pc_ptr & 0x0f);
-  Byte disp8 = *(pc_ptr + 1);
-  pc += 2;
+static bool Bsr(char code1, char code2) {
+  Byte disp8 = code2;
 
-  if (cond == 0x01) {  // bsr
-    ra[7] -= 4;
-    if (disp8 == 0) {
-      Word disp16 = imi_get_word();
-      mem_set(ra[7], pc, S_LONG);
-      pc += extl(disp16) - 2;
-    } else {
-      mem_set(ra[7], pc, S_LONG);
-      pc += extbl(disp8);
-    }
-    return false;
+  cpu.ra[7] -= 4;
+  if (disp8 == 0) {
+    Word disp16 = imi_get_word();
+    mem_set(cpu.ra[7], cpu.pc, S_LONG);
+    cpu.pc += extl(disp16) - 2;
+  } else {
+    mem_set(cpu.ra[7], cpu.pc, S_LONG);
+    cpu.pc += extbl(disp8);
   }
+  return false;
+}
+
+/*
+ 　機能：bcc命令を実行する
+ 戻り値： true = 実行終了
+         false = 実行継続
+*/
+static bool Bcc(char code1, char code2) {
+  int cond = (code1 & 0x0f);
+  Byte disp8 = code2;
 
   if (get_cond(cond)) {
     if (disp8 == 0) {
       Word disp16 = imi_get_word();
-      pc += extl(disp16) - 2;
+      cpu.pc += extl(disp16) - 2;
     } else {
-      pc += extbl(disp8);
+      cpu.pc += extbl(disp8);
     }
   } else {
     // Bcc.W の分岐不成立ならワードディスプレースメントを飛ばす
-    if (disp8 == 0) pc += 2;
+    if (disp8 == 0) cpu.pc += 2;
   }
 
   return false;
 }
+
+/*
+ 　機能：6ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
+*/
+InstructionHandler decodeLine6(char code1, char code2) {
+  return ((code1 & 0x0f) == 0x01) ? Bsr : Bcc;
+}
@@ -22,28 +22,32 @@
 #include "run68.h"
 
 /*
- 　機能：7ライン命令(moveq)を実行する
+ 　機能：moveq命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-bool line7(char *pc_ptr) {
-  char code = *(pc_ptr++);
-  pc += 2;
-  if ((code & 0x01) != 0) return IllegalInstruction();
-
-  int reg = (code >> 1) & 0x07;
-  rd[reg] = extbl((Byte)*pc_ptr);
+static bool Moveq(char code1, char code2) {
+  int reg = (code1 >> 1) & 0x07;
+  cpu.rd[reg] = extbl((Byte)code2);
 
   /* フラグの変化 */
-  general_conditions(rd[reg], S_LONG);
+  general_conditions(cpu.rd[reg], S_LONG);
 
 #ifdef TRACE
-  printf("trace: moveq    src=%d PC=%06lX\n", data, pc);
+  printf("trace: moveq    src=%d PC=%06lX\n", data, cpu.pc);
 #endif
 
   return false;
 }
 
+/*
+ 　機能：7ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 不当命令)
+*/
+InstructionHandler decodeLine7(char code1, char code2) {
+  return ((code1 & 0x01) != 0) ? NULL : Moveq;
+}
+
 /* $Id: line7.c,v 1.2 2009-08-08 06:49:44 masamic Exp $ */
 
 /*
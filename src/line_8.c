@@ -18,56 +18,72 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "bcd.h"
+#include "eaaccess.h"
+#include "muldiv.h"
 #include "run68.h"
 
-/*
- 　機能：divu命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Divu(char code1, char code2) {
-  char mode;
-  char src_reg;
-  ULong data;
-  ULong ans;
-  Long waru_l;
+// divu、divsの商が16ビットに収まらない場合のフラグを設定する。
+//   N、Zは変化しない(MC68000では未定義)。
+static void setDivideOverflow(void) {
+  mulDivCounts[MULDIV_DIV_OVERFLOW] += 1;
+  cpu.sr = (GetSr() & ~CCR_C) | CCR_V;
+}
 
-  mode = ((code2 & 0x38) >> 3);
-  src_reg = (code2 & 0x07);
-  int dst_reg = (code1 & 0x0E) >> 1;
-  data = rd[dst_reg];
+// divu命令の演算を行う。
+static inline bool divu(int dst_reg, UWord divisor) {
+  mulDivCounts[MULDIV_DIVU] += 1;
+  if (divisor == 0) {
+    err68a("０で除算しました", __FILE__, __LINE__);
+  }
 
-  /* ソースのアドレッシングモードに応じた処理 */
-  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &waru_l)) {
-    return true;
+  // 商が16ビットに収まらないことは除算せずに判定できる
+  ULong dividend = cpu.rd[dst_reg];
+  if ((dividend >> 16) >= divisor) {
+    setDivideOverflow();
+    return false;
   }
-  UWord waru = (UWord)waru_l;
 
-  if (waru == 0) {
+  ULong mod;
+  ULong ans = DivideUnsigned(dividend, divisor, &mod);
+  cpu.rd[dst_reg] = (mod << 16) | ans;
+  general_conditions(ans, S_WORD);
+  return false;
+}
+
+// divs命令の演算を行う。
+static inline bool divs(int dst_reg, Word divisor) {
+  mulDivCounts[MULDIV_DIVS] += 1;
+  if (divisor == 0) {
     err68a("０で除算しました", __FILE__, __LINE__);
   }
 
-  CCR_C_OFF();
-  ans = data / waru;
-  UWord mod = data % waru;
-  if (ans > 0xFFFF) {
-    CCR_V_ON();
+  Long mod;
+  Long ans = DivideSigned(cpu.rd[dst_reg], divisor, &mod);
+  if (ans > 32767 || ans < -32768) {
+    setDivideOverflow();
     return false;
   }
-  rd[dst_reg] = ((mod << 16) | ans);
+  cpu.rd[dst_reg] = (mod << 16) | (ans & 0xFFFF);
+  general_conditions(ans, S_WORD);
+  return false;
+}
 
-  CCR_V_OFF();
-  if (ans >= 0x8000) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (ans == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
+/*
+ 　機能：divu命令を実行する
+ 戻り値： true = 実行終了
+         false = 実行継続
+*/
+static bool Divu(char code1, char code2) {
+  int mode = (code2 >> 3) & 0x07;
+  int src_reg = code2 & 0x07;
+  Long waru;
+
+  /* ソースのアドレッシングモードに応じた処理 */
+  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &waru)) {
+    return true;
   }
-  return false;
+  return divu((code1 >> 1) & 0x07, (UWord)waru);
 }
 
 /*
@@ -76,49 +92,40 @@ static bool Divu(char code1, char code2) {
          false = 実行継続
 */
 static bool Divs(char code1, char code2) {
-  char mode;
-  char src_reg;
-  Long data;
-  Long ans;
-  Long waru_l;
-
-  mode = ((code2 & 0x38) >> 3);
-  src_reg = (code2 & 0x07);
-  int dst_reg = ((code1 & 0x0E) >> 1);
-  data = rd[dst_reg];
+  int mode = (code2 >> 3) & 0x07;
+  int src_reg = code2 & 0x07;
+  Long waru;
 
   /* ソースのアドレッシングモードに応じた処理 */
-  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &waru_l)) {
+  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &waru)) {
     return true;
   }
-  Word waru = (Word)waru_l;
+  return divs((code1 >> 1) & 0x07, (Word)waru);
+}
 
-  if (waru == 0) {
-    err68a("０で除算しました", __FILE__, __LINE__);
+// アドレッシングモードごとにdivu、divs命令ハンドラを作る(X-macro)
+//   アドレッシングモードは命令表の作成時に確認済み。
+#define DEFINE_DIVU_HANDLER(name, src)                          \
+  static bool name##_##src(char code1, char code2) {            \
+    UWord waru = (UWord)ReadEa(EA_##src, code2 & 0x07, S_WORD); \
+    return divu((code1 >> 1) & 0x07, waru);                     \
   }
-
-  CCR_C_OFF();
-  ans = data / waru;
-  Word mod = data % waru;
-  if (ans > 32767 || ans < -32768) {
-    CCR_V_ON();
-    return false;
+#define DEFINE_DIVS_HANDLER(name, src)                        \
+  static bool name##_##src(char code1, char code2) {          \
+    Word waru = (Word)ReadEa(EA_##src, code2 & 0x07, S_WORD); \
+    return divs((code1 >> 1) & 0x07, waru);                   \
   }
-  rd[dst_reg] = ((mod << 16) | (ans & 0xFFFF));
-
-  CCR_V_OFF();
-  if (ans < 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (ans == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-  return false;
-}
+EA_DATA_MODE_LIST(DEFINE_DIVU_HANDLER, Divu)
+EA_DATA_MODE_LIST(DEFINE_DIVS_HANDLER, Divs)
+#undef DEFINE_DIVU_HANDLER
+#undef DEFINE_DIVS_HANDLER
+
+#define DIV_HANDLER_ENTRY(name, src) [EA_##src] = name##_##src,
+static const InstructionHandler divuHandlers[EA_IM + 1] = {
+    EA_DATA_MODE_LIST(DIV_HANDLER_ENTRY, Divu)};
+static const InstructionHandler divsHandlers[EA_IM + 1] = {
+    EA_DATA_MODE_LIST(DIV_HANDLER_ENTRY, Divs)};
+#undef DIV_HANDLER_ENTRY
 
 /*
  　機能：or Dn,<ea>命令を実行する
@@ -218,9 +225,7 @@ static bool Or2(char code1, char code2) {
 }
 
 // BCD減算
-// Makoto Kamada氏のXEiJ (https://stdkmd.net/xeij/)
-//   MC68000.javaを参考にしています。
-static bool Sbcd(UByte code1, UByte code2) {
+static bool Sbcd(char code1, char code2) {
   int srcReg = code2 & 7;
   int dstReg = (code1 >> 1) & 7;
   int memToMem = code2 & 0x08;
@@ -232,7 +237,9 @@ static bool Sbcd(UByte code1, UByte code2) {
   if (get_data_at_ea(EA_All, readMode, srcReg, S_BYTE, &srcVal)) return true;
   if (get_data_at_ea(EA_All, readMode, dstReg, S_BYTE, &dstVal)) return true;
 
-  Long result = SubBcd(dstVal, srcVal);
+  UWord ccr = GetSr();
+  Long result = SubBcd(dstVal, srcVal, &ccr);
+  SetSr(ccr);
 
   const int writeMode = memToMem ? EA_AI : EA_DD;
   if (set_data_at_ea(EA_All, writeMode, dstReg, S_BYTE, result)) return true;
@@ -240,60 +247,65 @@ static bool Sbcd(UByte code1, UByte code2) {
   return false;
 }
 
-Long SubBcd(Long x, Long y) {
-  Long ccrX = CCR_X_REF() ? 1 : 0;
-  Long t = (x & 0xff) - (y & 0xff) - ccrX;
-  Long result = t;
-
-  if ((x & 0x0f) < ((y & 0x0f) + ccrX)) result = result - 0x10 + 10;
-  if (result < 0) {
-    if (t < 0) result = result - 0x100 + (10 << 4);
-    CCR_X_C_ON();
-  } else
-    CCR_X_C_OFF();
-
-  result &= 0xff;
-  if (result != 0) CCR_Z_OFF();
-
-  if (result & 0x80)
-    CCR_N_ON();
-  else
-    CCR_N_OFF();
+// アドレッシングモードとサイズを固定したor <ea>,Dn命令
+//   アドレッシングモードは命令表の作成時に確認済み。
+static inline bool or2Ea(int size, int srcMode, char code1, char code2) {
+  Long src_data = ReadEa(srcMode, code2 & 0x07, size);
+  int dst_reg = (code1 >> 1) & 0x07;
+  Long data = ReadEa(EA_DD, dst_reg, size) | src_data;
 
-  Long a = result - t;
-  if (((t ^ result) & (a ^ result)) & 0x80)
-    CCR_V_ON();
-  else
-    CCR_V_OFF();
+  SetDreg(dst_reg, data, size);
+  general_conditions(data, size);
+  return false;
+}
 
-  return result;
+// サイズ、ソースの組み合わせごとにor <ea>,Dn命令ハンドラを作る(X-macro)
+#define DEFINE_OR2_HANDLER(size, src)                      \
+  static bool Or2_##size##_##src(char code1, char code2) { \
+    return or2Ea(S_##size, EA_##src, code1, code2);        \
+  }
+EA_DATA_MODE_LIST(DEFINE_OR2_HANDLER, BYTE)
+EA_DATA_MODE_LIST(DEFINE_OR2_HANDLER, WORD)
+EA_DATA_MODE_LIST(DEFINE_OR2_HANDLER, LONG)
+#undef DEFINE_OR2_HANDLER
+
+// [サイズ][ソース]
+#define OR2_HANDLER_ENTRY(size, src) [S_##size][EA_##src] = Or2_##size##_##src,
+static const InstructionHandler or2Handlers[S_LONG + 1][EA_IM + 1] = {
+    EA_DATA_MODE_LIST(OR2_HANDLER_ENTRY, BYTE)
+    EA_DATA_MODE_LIST(OR2_HANDLER_ENTRY, WORD)
+    EA_DATA_MODE_LIST(OR2_HANDLER_ENTRY, LONG)};
+#undef OR2_HANDLER_ENTRY
+
+// or <ea>,Dn命令のハンドラを得る
+static InstructionHandler decodeOr2(char code2) {
+  int size = (code2 >> 6) & 0x03;
+  int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+  // 不正なアドレッシングモードは汎用のハンドラでエラーにする
+  if (src == EA_AD || src > EA_IM) return Or2;
+  return or2Handlers[size][src];
 }
 
 /*
- 　機能：8ライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
+ 　機能：8ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
 */
-bool line8(char *pc_ptr) {
-  char code1, code2;
-
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
-
+InstructionHandler decodeLine8(char code1, char code2) {
   if ((code2 & 0xC0) == 0xC0) {
-    if ((code1 & 0x01) == 0)
-      return (Divu(code1, code2));
-    else
-      return (Divs(code1, code2));
+    bool isDivu = (code1 & 0x01) == 0;
+    int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+    // 不正なアドレッシングモードは汎用のハンドラでエラーにする
+    if (src == EA_AD || src > EA_IM) return isDivu ? Divu : Divs;
+    return isDivu ? divuHandlers[src] : divsHandlers[src];
   }
-  if (((code1 & 0x01) == 0x01) && ((code2 & 0xF0) == 0))
-    return Sbcd(code1, code2);
+  if (((code1 & 0x01) == 0x01) && ((code2 & 0xF0) == 0)) return Sbcd;
 
   if ((code1 & 0x01) == 0x01)
-    return (Or1(code1, code2));
+    return Or1;
   else
-    return (Or2(code1, code2));
+    return decodeOr2(code2);
 }
 
 /* $Id: line8.c,v 1.3 2009-08-08 06:49:44 masamic Exp $ */
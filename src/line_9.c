@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "eaaccess.h"
 #include "operate.h"
 #include "run68.h"
 
@@ -27,7 +28,7 @@ static bool Suba(char code1, char code2) {
   char size;
   Long src_data;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
   int dst_reg = ((code1 & 0x0E) >> 1);
@@ -45,7 +46,7 @@ static bool Suba(char code1, char code2) {
   if (size == S_WORD) src_data = extl(src_data);
 
   // sub演算
-  ra[dst_reg] -= src_data;
+  cpu.ra[dst_reg] -= src_data;
 
 #ifdef TRACE
   printf("trace: suba.%c   src=%d PC=%06lX\n", size_char[size], src_data,
@@ -86,8 +87,8 @@ static bool Subx(char code1, char code2) {
   int dst_reg = ((code1 & 0x0E) >> 1);
   char size = ((code2 >> 6) & 0x03);
 
-  Long src_data = rd[src_reg];
-  Long dst_data = rd[dst_reg];
+  Long src_data = cpu.rd[src_reg];
+  Long dst_data = cpu.rd[dst_reg];
 
   bool save_z = CCR_Z_REF() != 0 ? true : false;
   Long result = dst_data - src_data - (CCR_X_REF() ? 1 : 0);
@@ -133,7 +134,7 @@ static bool Sub1(char code1, char code2) {
   }
 
 #ifdef TEST_CCR
-  short before = sr & 0x1f;
+  short before = GetSr() & 0x1f;
 #endif
 
   /* Sub演算 */
@@ -188,41 +189,79 @@ static bool Sub2(char code1, char code2) {
   }
 
 #ifdef TEST_CCR
-  short before = sr & 0x1f;
+  short before = GetSr() & 0x1f;
 #endif
 
   SetDreg(dst_reg, dest_data - src_data, size);
 
   /* フラグの変化 */
-  sub_conditions(src_data, dest_data, rd[dst_reg], size, true);
+  sub_conditions(src_data, dest_data, cpu.rd[dst_reg], size, true);
 
 #ifdef TEST_CCR
-  check("sub2", src_data, dest_data, rd[dst_reg], size, before);
+  check("sub2", src_data, dest_data, cpu.rd[dst_reg], size, before);
 #endif
 
   return false;
 }
 
+// アドレッシングモードとサイズを固定したsub <ea>,Dn命令
+//   アドレッシングモードは命令表の作成時に確認済み。
+static inline bool sub2Ea(int size, int srcMode, char code1, char code2) {
+  Long src_data = ReadEa(srcMode, code2 & 0x07, size);
+  int dst_reg = (code1 >> 1) & 0x07;
+  Long dest_data = cpu.rd[dst_reg];
+
+  SetDreg(dst_reg, dest_data - src_data, size);
+  sub_conditions(src_data, dest_data, cpu.rd[dst_reg], size, true);
+  return false;
+}
+
+// サイズ、ソースの組み合わせごとにsub <ea>,Dn命令ハンドラを作る(X-macro)
+//   SUB.B An,Dnは不正命令だが、表を単純にするためハンドラは作っておく
+//   (命令表には登録されない)。
+#define DEFINE_SUB2_HANDLER(size, src)                      \
+  static bool Sub2_##size##_##src(char code1, char code2) { \
+    return sub2Ea(S_##size, EA_##src, code1, code2);        \
+  }
+EA_ALL_MODE_LIST(DEFINE_SUB2_HANDLER, BYTE)
+EA_ALL_MODE_LIST(DEFINE_SUB2_HANDLER, WORD)
+EA_ALL_MODE_LIST(DEFINE_SUB2_HANDLER, LONG)
+#undef DEFINE_SUB2_HANDLER
+
+// [サイズ][ソース]
+#define SUB2_HANDLER_ENTRY(size, src) \
+  [S_##size][EA_##src] = Sub2_##size##_##src,
+static const InstructionHandler sub2Handlers[S_LONG + 1][EA_IM + 1] = {
+    EA_ALL_MODE_LIST(SUB2_HANDLER_ENTRY, BYTE)
+    EA_ALL_MODE_LIST(SUB2_HANDLER_ENTRY, WORD)
+    EA_ALL_MODE_LIST(SUB2_HANDLER_ENTRY, LONG)};
+#undef SUB2_HANDLER_ENTRY
+
+// sub <ea>,Dn命令のハンドラを得る
+static InstructionHandler decodeSub2(char code2) {
+  int size = (code2 >> 6) & 0x03;
+  int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+  // 不正なアドレッシングモードは汎用のハンドラでエラーにする
+  if (src > EA_IM || (size == S_BYTE && src == EA_AD)) return Sub2;
+  return sub2Handlers[size][src];
+}
+
 /*
- 　機能：9ライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
+ 　機能：9ライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
 */
-bool line9(char *pc_ptr) {
-  char code1 = *(pc_ptr++);
-  char code2 = *pc_ptr;
-  pc += 2;
-
-  if ((code2 & 0xC0) == 0xC0) return Suba(code1, code2);
+InstructionHandler decodeLine9(char code1, char code2) {
+  if ((code2 & 0xC0) == 0xC0) return Suba;
 
   if ((code1 & 0x01) == 1) {
     if ((code2 & 0x30) == 0x00) {
-      return (code2 & 0x08) ? SubxMem(code1, code2) : Subx(code1, code2);
+      return (code2 & 0x08) ? SubxMem : Subx;
     }
-    return Sub1(code1, code2);
+    return Sub1;
   }
 
-  return Sub2(code1, code2);
+  return decodeSub2(code2);
 }
 
 /* $Id: line9.c,v 1.3 2009-08-08 06:49:44 masamic Exp $ */
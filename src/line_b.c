@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "fusion.h"
 #include "operate.h"
 #include "run68.h"
 
@@ -50,7 +51,7 @@ static bool Cmp(char code1, char code2) {
   }
 
 #ifdef TEST_CCR
-  short before = sr & 0x1f;
+  short before = GetSr() & 0x1f;
 #endif
 
   Long result = dest_data - src_data;
@@ -82,7 +83,7 @@ static bool Cmpa(char code1, char code2) {
   short before;
 #endif
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
   if ((code1 & 0x01) == 0)
@@ -112,9 +113,9 @@ static bool Cmpa(char code1, char code2) {
 #endif
 
 #ifdef TEST_CCR
-  before = sr & 0x1f;
+  before = GetSr() & 0x1f;
 #endif
-  old = ra[dst_reg];
+  old = cpu.ra[dst_reg];
   ans = old - src_data;
 
   /* フラグの変化 */
@@ -175,7 +176,7 @@ static bool Eor(char code1, char code2) {
   Long src_data;
   int work_mode;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
   size = ((code2 >> 6) & 0x03);
@@ -217,35 +218,43 @@ static bool Eor(char code1, char code2) {
   general_conditions(data, size);
 
 #ifdef TRACE
-  printf("trace: eor.%c    src=%d PC=%06lX\n", size_char[size], rd[src_reg],
+  printf("trace: eor.%c    src=%d PC=%06lX\n", size_char[size], cpu.rd[src_reg],
          save_pc);
 #endif
 
   return false;
 }
 
+// cmp命令に続けて直後の条件分岐命令を実行する(命令の融合)
+static bool CmpBranch(char code1, char code2) {
+  if (Cmp(code1, code2)) return true;
+  FuseBranch(FUSION_CMP);
+  return false;
+}
+
 /*
- 　機能：Bライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
+ 　機能：Bライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
 */
-bool lineb(char *pc_ptr) {
-  char code1, code2;
-
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
-
+InstructionHandler decodeLineB(char code1, char code2) {
   if ((code1 & 0x01) == 0x00) {
-    if ((code2 & 0xC0) == 0xC0) return (Cmpa(code1, code2));
-    return (Cmp(code1, code2));
+    if ((code2 & 0xC0) == 0xC0) return Cmpa;
+    return Cmp;
   }
 
-  if ((code2 & 0xC0) == 0xC0) return (Cmpa(code1, code2));
+  if ((code2 & 0xC0) == 0xC0) return Cmpa;
+
+  if ((code2 & 0x38) == 0x08) return Cmpm;
 
-  if ((code2 & 0x38) == 0x08) return (Cmpm(code1, code2));
+  return Eor;
+}
 
-  return (Eor(code1, code2));
+/*
+ 　機能：直後に条件分岐命令が続く場合の融合した命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 融合しない)
+*/
+InstructionHandler fuseLineB(InstructionHandler handler) {
+  return (handler == Cmp) ? CmpBranch : NULL;
 }
 
 /* $Id: lineb.c,v 1.2 2009/08/08 06:49:44 masamic Exp $ */
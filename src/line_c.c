@@ -18,6 +18,9 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "bcd.h"
+#include "eaaccess.h"
+#include "muldiv.h"
 #include "run68.h"
 
 /*
@@ -132,66 +135,64 @@ static bool Exg(char code1, char code2) {
 
   switch (mode) {
     case 0x08:
-      tmp = rd[src_reg];
-      rd[src_reg] = rd[dst_reg];
-      rd[dst_reg] = tmp;
+      tmp = cpu.rd[src_reg];
+      cpu.rd[src_reg] = cpu.rd[dst_reg];
+      cpu.rd[dst_reg] = tmp;
       break;
     case 0x09:
-      tmp = ra[src_reg];
-      ra[src_reg] = ra[dst_reg];
-      ra[dst_reg] = tmp;
+      tmp = cpu.ra[src_reg];
+      cpu.ra[src_reg] = cpu.ra[dst_reg];
+      cpu.ra[dst_reg] = tmp;
       break;
     case 0x11:
-      tmp = rd[src_reg];
-      rd[src_reg] = ra[dst_reg];
-      ra[dst_reg] = tmp;
+      tmp = cpu.rd[src_reg];
+      cpu.rd[src_reg] = cpu.ra[dst_reg];
+      cpu.ra[dst_reg] = tmp;
       break;
     default:
       return IllegalInstruction();
   }
 
 #ifdef TRACE
-  printf("trace: exg      PC=%06lX\n", pc);
+  printf("trace: exg      PC=%06lX\n", cpu.pc);
 #endif
 
   return false;
 }
 
+// mulu命令の演算を行う。
+static inline bool mulu(int dst_reg, UWord src_data) {
+  mulDivCounts[MULDIV_MULU] += 1;
+  ULong ans = (ULong)src_data * (UWord)cpu.rd[dst_reg];
+  cpu.rd[dst_reg] = ans;
+  general_conditions(ans, S_LONG);
+  return false;
+}
+
+// muls命令の演算を行う。
+static inline bool muls(int dst_reg, Word src_data) {
+  mulDivCounts[MULDIV_MULS] += 1;
+  Long ans = (Long)src_data * (Word)cpu.rd[dst_reg];
+  cpu.rd[dst_reg] = ans;
+  general_conditions(ans, S_LONG);
+  return false;
+}
+
 /*
  　機能：mulu命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
 static bool Mulu(char code1, char code2) {
-  char src_reg;
-  char mode;
-  ULong ans;
-  Long src_data_l;
-#ifdef TRACE
-  Long save_pc = pc;
-#endif
-
-  mode = ((code2 & 0x38) >> 3);
-  src_reg = (code2 & 0x07);
-  int dst_reg = ((code1 & 0x0E) >> 1);
-  UWord dst_data = (rd[dst_reg] & 0xFFFF);
+  int mode = (code2 >> 3) & 0x07;
+  int src_reg = code2 & 0x07;
+  Long src_data;
 
   /* ソースのアドレッシングモードに応じた処理 */
-  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &src_data_l)) {
+  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &src_data)) {
     return true;
   }
-  UWord src_data = (UWord)src_data_l;
-
-  ans = src_data * dst_data;
-  rd[dst_reg] = ans;
-#ifdef TRACE
-  printf("trace: mulu     src=%u PC=%06lX\n", src_data, save_pc);
-#endif
-
-  /* フラグの変化 */
-  general_conditions(ans, S_LONG);
-
-  return false;
+  return mulu((code1 >> 1) & 0x07, (UWord)src_data);
 }
 
 /*
@@ -200,72 +201,43 @@ static bool Mulu(char code1, char code2) {
          false = 実行継続
 */
 static bool Muls(char code1, char code2) {
-  char src_reg;
-  char mode;
-  Long ans;
-  Long src_data_l;
-#ifdef TRACE
-  Long save_pc = pc;
-#endif
-
-  mode = ((code2 & 0x38) >> 3);
-  src_reg = (code2 & 0x07);
-  int dst_reg = ((code1 & 0x0E) >> 1);
-
-  Word dst_data = (rd[dst_reg] & 0xFFFF);
+  int mode = (code2 >> 3) & 0x07;
+  int src_reg = code2 & 0x07;
+  Long src_data;
 
   /* ソースのアドレッシングモードに応じた処理 */
-  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &src_data_l)) {
+  if (get_data_at_ea(EA_Data, mode, src_reg, S_WORD, &src_data)) {
     return true;
   }
-  Word src_data = (Word)src_data_l;
-
-  ans = src_data * dst_data;
-  rd[dst_reg] = ans;
-
-#ifdef TRACE
-  printf("trace: muls     src=%d PC=%06lX\n", src_data, save_pc);
-#endif
-
-  /* フラグの変化 */
-  general_conditions(ans, S_LONG);
-
-  return false;
+  return muls((code1 >> 1) & 0x07, (Word)src_data);
 }
 
-// BCD加算
-// Makoto Kamada氏のXEiJ (https://stdkmd.net/xeij/)
-//   MC68000.javaを参考にしています。
-static Long AddBcd(Long x, Long y) {
-  Long ccrX = CCR_X_REF() ? 1 : 0;
-  Long t = (x & 0xff) + (y & 0xff) + ccrX;
-  Long result = t;
-
-  if (10 <= ((x & 0x0f) + (y & 0x0f) + ccrX)) result = result + 0x10 - 10;
-  if ((10 << 4) <= result) {
-    result = result + 0x100 - (10 << 4);
-    CCR_X_C_ON();
-  } else
-    CCR_X_C_OFF();
-
-  result &= 0xff;
-  if (result != 0) CCR_Z_OFF();
-
-  if (result & 0x80)
-    CCR_N_ON();
-  else
-    CCR_N_OFF();
-
-  Long a = result - t;
-  if (((t ^ result) & (a ^ result)) & 0x80)
-    CCR_V_ON();
-  else
-    CCR_V_OFF();
-
-  return result;
-}
+// アドレッシングモードごとにmulu、muls命令ハンドラを作る(X-macro)
+//   アドレッシングモードは命令表の作成時に確認済み。
+#define DEFINE_MULU_HANDLER(name, src)                              \
+  static bool name##_##src(char code1, char code2) {                \
+    UWord src_data = (UWord)ReadEa(EA_##src, code2 & 0x07, S_WORD); \
+    return mulu((code1 >> 1) & 0x07, src_data);                     \
+  }
+#define DEFINE_MULS_HANDLER(name, src)                            \
+  static bool name##_##src(char code1, char code2) {              \
+    Word src_data = (Word)ReadEa(EA_##src, code2 & 0x07, S_WORD); \
+    return muls((code1 >> 1) & 0x07, src_data);                   \
+  }
+EA_DATA_MODE_LIST(DEFINE_MULU_HANDLER, Mulu)
+EA_DATA_MODE_LIST(DEFINE_MULS_HANDLER, Muls)
+#undef DEFINE_MULU_HANDLER
+#undef DEFINE_MULS_HANDLER
+
+#define MUL_HANDLER_ENTRY(name, src) [EA_##src] = name##_##src,
+static const InstructionHandler muluHandlers[EA_IM + 1] = {
+    EA_DATA_MODE_LIST(MUL_HANDLER_ENTRY, Mulu)};
+static const InstructionHandler mulsHandlers[EA_IM + 1] = {
+    EA_DATA_MODE_LIST(MUL_HANDLER_ENTRY, Muls)};
+#undef MUL_HANDLER_ENTRY
 
-static bool Abcd(UByte code1, UByte code2) {
+// BCD加算
+static bool Abcd(char code1, char code2) {
   int srcReg = code2 & 7;
   int dstReg = (code1 >> 1) & 7;
   int memToMem = code2 & 0x08;
@@ -277,7 +249,9 @@ static bool Abcd(UByte code1, UByte code2) {
   if (get_data_at_ea(EA_All, readMode, srcReg, S_BYTE, &srcVal)) return true;
   if (get_data_at_ea(EA_All, readMode, dstReg, S_BYTE, &dstVal)) return true;
 
-  Long result = AddBcd(dstVal, srcVal);
+  UWord ccr = GetSr();
+  Long result = AddBcd(dstVal, srcVal, &ccr);
+  SetSr(ccr);
 
   const int writeMode = memToMem ? EA_AI : EA_DD;
   if (set_data_at_ea(EA_All, writeMode, dstReg, S_BYTE, result)) return true;
@@ -285,24 +259,64 @@ static bool Abcd(UByte code1, UByte code2) {
   return false;
 }
 
+// アドレッシングモードとサイズを固定したand <ea>,Dn命令
+//   アドレッシングモードは命令表の作成時に確認済み。
+static inline bool and2Ea(int size, int srcMode, char code1, char code2) {
+  Long src_data = ReadEa(srcMode, code2 & 0x07, size);
+  int dst_reg = (code1 >> 1) & 0x07;
+  Long data = ReadEa(EA_DD, dst_reg, size) & src_data;
+
+  SetDreg(dst_reg, data, size);
+  general_conditions(data, size);
+  return false;
+}
+
+// サイズ、ソースの組み合わせごとにand <ea>,Dn命令ハンドラを作る(X-macro)
+#define DEFINE_AND2_HANDLER(size, src)                      \
+  static bool And2_##size##_##src(char code1, char code2) { \
+    return and2Ea(S_##size, EA_##src, code1, code2);        \
+  }
+EA_DATA_MODE_LIST(DEFINE_AND2_HANDLER, BYTE)
+EA_DATA_MODE_LIST(DEFINE_AND2_HANDLER, WORD)
+EA_DATA_MODE_LIST(DEFINE_AND2_HANDLER, LONG)
+#undef DEFINE_AND2_HANDLER
+
+// [サイズ][ソース]
+#define AND2_HANDLER_ENTRY(size, src) \
+  [S_##size][EA_##src] = And2_##size##_##src,
+static const InstructionHandler and2Handlers[S_LONG + 1][EA_IM + 1] = {
+    EA_DATA_MODE_LIST(AND2_HANDLER_ENTRY, BYTE)
+    EA_DATA_MODE_LIST(AND2_HANDLER_ENTRY, WORD)
+    EA_DATA_MODE_LIST(AND2_HANDLER_ENTRY, LONG)};
+#undef AND2_HANDLER_ENTRY
+
+// and <ea>,Dn命令のハンドラを得る
+static InstructionHandler decodeAnd2(char code2) {
+  int size = (code2 >> 6) & 0x03;
+  int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+  // 不正なアドレッシングモードは汎用のハンドラでエラーにする
+  if (src == EA_AD || src > EA_IM) return And2;
+  return and2Handlers[size][src];
+}
+
 /*
- 　機能：Cライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
+ 　機能：Cライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
 */
-bool linec(char *pc_ptr) {
-  char code1 = *(pc_ptr++);
-  char code2 = *pc_ptr;
-  pc += 2;
-
-  if ((code1 & 0x01) == 0) {
-    if ((code2 & 0xC0) == 0xC0) return Mulu(code1, code2);
-    return And2(code1, code2);
+InstructionHandler decodeLineC(char code1, char code2) {
+  if ((code2 & 0xC0) == 0xC0) {
+    bool isMulu = (code1 & 0x01) == 0;
+    int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+    // 不正なアドレッシングモードは汎用のハンドラでエラーにする
+    if (src == EA_AD || src > EA_IM) return isMulu ? Mulu : Muls;
+    return isMulu ? muluHandlers[src] : mulsHandlers[src];
   }
-  if ((code2 & 0xC0) == 0xC0) return Muls(code1, code2);
-  if ((code2 & 0xF0) == 0x00) return Abcd(code1, code2);
-  if ((code2 & 0x30) == 0x00) return Exg(code1, code2);
-  return (And1(code1, code2));
+  if ((code1 & 0x01) == 0) return decodeAnd2(code2);
+  if ((code2 & 0xF0) == 0x00) return Abcd;
+  if ((code2 & 0x30) == 0x00) return Exg;
+  return And1;
 }
 
 /* $Id: linec.c,v 1.3 2009-08-08 06:49:44 masamic Exp $ */
@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "eaaccess.h"
 #include "operate.h"
 #include "run68.h"
 
@@ -27,7 +28,7 @@ static bool Adda(char code1, char code2) {
   char size;
   Long src_data;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
   int dst_reg = ((code1 & 0x0E) >> 1);
@@ -50,7 +51,7 @@ static bool Adda(char code1, char code2) {
     }
   }
 
-  ra[dst_reg] += src_data;
+  cpu.ra[dst_reg] += src_data;
 
 #ifdef TRACE
   printf("trace: adda.%c   src=%d PC=%06lX\n", size_char[size], src_data,
@@ -87,8 +88,8 @@ static bool Addx(char code1, char code2) {
   int dst_reg = ((code1 & 0x0E) >> 1);
   char size = ((code2 >> 6) & 0x03);
 
-  Long src_data = rd[src_reg];
-  Long dst_data = rd[dst_reg];
+  Long src_data = cpu.rd[src_reg];
+  Long dst_data = cpu.rd[dst_reg];
 
   bool save_z = CCR_Z_REF() != 0 ? true : false;
   Long result = dst_data + src_data + (CCR_X_REF() ? 1 : 0);
@@ -165,7 +166,7 @@ static bool Add2(char code1, char code2) {
   Long src_data;
   Long dest_data;
 #ifdef TRACE
-  Long save_pc = pc;
+  Long save_pc = cpu.pc;
 #endif
 
   mode = ((code2 & 0x38) >> 3);
@@ -184,7 +185,7 @@ static bool Add2(char code1, char code2) {
   SetDreg(dst_reg, dest_data + src_data, size);
 
   /* フラグの変化 */
-  add_conditions(src_data, dest_data, rd[dst_reg], size, true);
+  add_conditions(src_data, dest_data, cpu.rd[dst_reg], size, true);
 
 #ifdef TRACE
   printf("trace: add.%c    src=%d PC=%06lX\n", size_char[size], src_data,
@@ -194,26 +195,64 @@ static bool Add2(char code1, char code2) {
   return false;
 }
 
+// アドレッシングモードとサイズを固定したadd <ea>,Dn命令
+//   アドレッシングモードは命令表の作成時に確認済み。
+static inline bool add2Ea(int size, int srcMode, char code1, char code2) {
+  Long src_data = ReadEa(srcMode, code2 & 0x07, size);
+  int dst_reg = (code1 >> 1) & 0x07;
+  Long dest_data = ReadEa(EA_DD, dst_reg, size);
+
+  SetDreg(dst_reg, dest_data + src_data, size);
+  add_conditions(src_data, dest_data, cpu.rd[dst_reg], size, true);
+  return false;
+}
+
+// サイズ、ソースの組み合わせごとにadd <ea>,Dn命令ハンドラを作る(X-macro)
+//   ADD.B An,Dnは不正命令だが、表を単純にするためハンドラは作っておく
+//   (命令表には登録されない)。
+#define DEFINE_ADD2_HANDLER(size, src)                      \
+  static bool Add2_##size##_##src(char code1, char code2) { \
+    return add2Ea(S_##size, EA_##src, code1, code2);        \
+  }
+EA_ALL_MODE_LIST(DEFINE_ADD2_HANDLER, BYTE)
+EA_ALL_MODE_LIST(DEFINE_ADD2_HANDLER, WORD)
+EA_ALL_MODE_LIST(DEFINE_ADD2_HANDLER, LONG)
+#undef DEFINE_ADD2_HANDLER
+
+// [サイズ][ソース]
+#define ADD2_HANDLER_ENTRY(size, src) \
+  [S_##size][EA_##src] = Add2_##size##_##src,
+static const InstructionHandler add2Handlers[S_LONG + 1][EA_IM + 1] = {
+    EA_ALL_MODE_LIST(ADD2_HANDLER_ENTRY, BYTE)
+    EA_ALL_MODE_LIST(ADD2_HANDLER_ENTRY, WORD)
+    EA_ALL_MODE_LIST(ADD2_HANDLER_ENTRY, LONG)};
+#undef ADD2_HANDLER_ENTRY
+
+// add <ea>,Dn命令のハンドラを得る
+static InstructionHandler decodeAdd2(char code2) {
+  int size = (code2 >> 6) & 0x03;
+  int src = GetEaMode((code2 >> 3) & 0x07, code2 & 0x07);
+
+  // 不正なアドレッシングモードは汎用のハンドラでエラーにする
+  if (src > EA_IM || (size == S_BYTE && src == EA_AD)) return Add2;
+  return add2Handlers[size][src];
+}
+
 /*
- 　機能：Dライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
+ 　機能：Dライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
 */
-bool lined(char *pc_ptr) {
-  char code1 = *(pc_ptr++);
-  char code2 = *pc_ptr;
-  pc += 2;
-
-  if ((code2 & 0xC0) == 0xC0) return Adda(code1, code2);
+InstructionHandler decodeLineD(char code1, char code2) {
+  if ((code2 & 0xC0) == 0xC0) return Adda;
 
   if ((code1 & 0x01) == 1) {
     if ((code2 & 0x30) == 0x00) {
-      return (code2 & 0x08) ? AddxMem(code1, code2) : Addx(code1, code2);
+      return (code2 & 0x08) ? AddxMem : Addx;
     }
-    return Add1(code1, code2);
+    return Add1;
   }
 
-  return Add2(code1, code2);
+  return decodeAdd2(code2);
 }
 
 /* $Id: lined.c,v 1.2 2009-08-08 06:49:44 masamic Exp $ */
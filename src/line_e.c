@@ -15,1239 +15,223 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
 
+
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "operate.h"
 #include "run68.h"
 
-/*
- 　機能：asl命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Asl(char code1, char code2) {
-  char size;
-  ULong top;
-  ULong mask;
-  ULong src;
-  ULong flag;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-  top = (src & mask);
-  flag = top;
-
-#ifdef TRACE
-  printf("trace: asl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  CCR_C_OFF();
-  CCR_V_OFF();
-  for (; cnt > 0; cnt--) {
-    src <<= 1;
-    if (top != 0) {
-      CCR_X_C_ON();
-    } else {
-      CCR_X_C_OFF();
-    }
-    top = (src & mask);
-    if (top != flag) CCR_V_ON();
-  }
-
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：asl.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Asl2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  ULong msb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最上位ビットを保存する */
-  msb = src & 0x8000;
-
-  src = ((ULong)src << 1) & 0xffff;
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* C および X フラグはシフト前の最上位ビット値を取る */
-  if (msb) {
-    CCR_X_C_ON();
-  } else {
-    CCR_X_C_OFF();
-  }
-
-  /* V フラグはシフト前の最上位ビットと */
-  /* 現在の最上位ビットが異なるとき 1 を立てる */
-  if (msb != (src & 0x8000)) {
-    CCR_V_ON();
-  } else {
-    CCR_V_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：asr命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Asr(char code1, char code2) {
-  char size;
-  char btm;
-  ULong mask;
-  ULong src;
-  ULong flag;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-  flag = (src & mask);
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      break;
-  }
-
-#ifdef TRACE
-  printf("trace: asr.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  CCR_C_OFF();
-  for (; cnt > 0; cnt--) {
-    btm = (char)(src & 0x01);
-    src >>= 1;
-    if (btm != 0) {
-      CCR_X_C_ON();
-    } else {
-      CCR_X_C_OFF();
-    }
-    src |= flag;
-  }
-
-  switch (size) {
-    case S_BYTE:
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：asr.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Asr2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  int msb;
-  int lsb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最上位ビットを保存する */
-  msb = src & 0x8000;
-
-  /* シフト前の最下位ビットを保存する */
-  lsb = src & 0x1;
-
-  src = ((ULong)src >> 1) | msb;
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* C および X フラグはシフト前の最下位ビット値を取る */
-  if (lsb) {
-    CCR_X_C_ON();
-  } else {
-    CCR_X_C_OFF();
-  }
-
-  /* V フラグは常に0 */
-  CCR_V_OFF();
-
-  return false;
-}
-
-/*
- 　機能：lsl命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Lsl(char code1, char code2) {
-  char size;
-  ULong mask;
-  ULong src;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-
-#ifdef TRACE
-  printf("trace: lsl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  CCR_C_OFF();
-  for (; cnt > 0; cnt--) {
-    if ((src & mask) != 0) {
-      CCR_X_C_ON();
-    } else {
-      CCR_X_C_OFF();
-    }
-    src <<= 1;
-  }
-
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：lsl.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Lsl2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  int msb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最上位ビットを保存する */
-  msb = src & 0x8000;
-
-  src = ((ULong)src << 1) & 0xffff;
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* C および X フラグはシフト前の最上位ビット値を取る */
-  if (msb) {
-    CCR_X_C_ON();
-  } else {
-    CCR_X_C_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：lsr命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Lsr(char code1, char code2) {
-  char size;
-  ULong mask;
-  ULong src;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      break;
-  }
-
-#ifdef TRACE
-  printf("trace: lsr.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  CCR_C_OFF();
-  for (; cnt > 0; cnt--) {
-    if ((src & 0x01) != 0) {
-      CCR_X_C_ON();
-    } else {
-      CCR_X_C_OFF();
-    }
-    src >>= 1;
-  }
-
-  switch (size) {
-    case S_BYTE:
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：lsr.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Lsr2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  int lsb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsr.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最下位ビットを保存する */
-  lsb = src & 0x1;
-
-  src = ((ULong)src >> 1) & 0xffff;
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* C および X フラグはシフト前の最下位ビット値を取る */
-  if (lsb) {
-    CCR_X_C_ON();
-  } else {
-    CCR_X_C_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：rol命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Rol(char code1, char code2) {
-  char size;
-  ULong top;
-  ULong mask;
-  ULong src;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
+// シフト・ローテート命令の種類(命令コードのビット配置と同じ値)
+typedef enum {
+  SHIFT_AS,   // asl、asr
+  SHIFT_LS,   // lsl、lsr
+  SHIFT_ROX,  // roxl、roxr
+  SHIFT_RO,   // rol、ror
+} ShiftType;
+
+typedef unsigned long long WideValue;
+
+/*
+ 　機能：シフト・ローテートの演算を行う
+ 　　　　*ccrにはX、N、Z、V、Cの値を返す(Xが変化しない命令では元の値)
+ 戻り値：演算結果
+*/
+// 1ビットずつ繰り返す代わりにホストのシフト演算でまとめて求めるので、
+// 回数(0～63)によらず一定時間で終わる。種類、方向、サイズに定数を指定して
+// 呼び出せば、インライン展開によりその組み合わせ専用の処理になる。
+static inline ULong shiftOperand(ShiftType type, bool left, int size,
+                                 ULong value, int count, UWord* ccr) {
+  const int bits = 8 << size;
+  const ULong msb = (ULong)1 << (bits - 1);
+  const ULong mask = (msb << 1) - 1;
+  WideValue v = value & mask;
+  WideValue r;
+  UWord x = cpu.sr & CCR_X;
+  UWord c = 0;
+  UWord overflow = 0;
+
+  switch (type) {
+    default:  // SHIFT_AS, SHIFT_LS
+      if (left) {
+        // 最後に押し出されたビットは、シフト後のbitsビット目
+        r = v << count;
+        if ((r >> bits) & 1) c = CCR_C;
+
+        // asl: シフト中に最上位ビットが一度でも変化したらV=1
+        if (type == SHIFT_AS) {
+          if (count >= bits) {
+            if (v != 0) overflow = CCR_V;
+          } else {
+            WideValue top = v >> (bits - 1 - count);
+            if (top != 0 && top != ((WideValue)2 << count) - 1)
+              overflow = CCR_V;
+          }
+        }
+      } else {
+        // asr: 符号ビットを上位に拡張しておき、論理シフトで求める
+        //   bitsビット以上のシフトは全ビットが符号ビットになる
+        int n = count;
+        if (type == SHIFT_AS) {
+          if (v & msb) v |= ~(WideValue)mask;
+          if (n > bits) n = bits;
+        }
+        r = v >> n;
+        if (n != 0 && ((v >> (n - 1)) & 1)) c = CCR_C;
+      }
+      if (count != 0) x = c ? CCR_X : 0;
+      break;
+
+    case SHIFT_RO: {
+      // Xは変化しない
+      int n = count & (bits - 1);
+      if (left) {
+        r = ((v << n) | (v >> (bits - n))) & mask;
+        if (count != 0 && (r & 1)) c = CCR_C;
+      } else {
+        r = ((v >> n) | (v << (bits - n))) & mask;
+        if (count != 0 && (r & msb)) c = CCR_C;
+      }
       break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-
-#ifdef TRACE
-  printf("trace: rol.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  CCR_C_OFF();
-  for (; cnt > 0; cnt--) {
-    top = (src & mask);
-    src <<= 1;
-    if (top != 0) {
-      CCR_C_ON();
-      src |= 0x01;
-    } else {
-      CCR_C_OFF();
     }
-  }
-
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：rol.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Rol2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  int msb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最上位ビットを保存する */
-  msb = src & 0x8000;
-
-  src = ((ULong)src << 1) & 0xfffe;
-  if (msb) {
-    src |= 1;
-  }
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
 
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* X フラグは変化せず */
-  /* C および X フラグはシフト前の最上位ビット値を取る */
-  if (msb) {
-    CCR_C_ON();
-  } else {
-    CCR_C_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：roxl命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Roxl(char code1, char code2) {
-  char size;
-  ULong top;
-  ULong mask;
-  ULong src;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
+    case SHIFT_ROX: {
+      // 最上位ビットの上にXを置いたbits+1ビットの値としてローテートする
+      //   回数が0ならC=X
+      int n = count % (bits + 1);
+      if (!left) n = bits + 1 - n;
+      WideValue w = v | ((WideValue)(x ? 1 : 0) << bits);
+      WideValue wmask = ((WideValue)mask << 1) | 1;
+      w = ((w << n) | (w >> (bits + 1 - n))) & wmask;
+      r = w;
+      x = ((w >> bits) & 1) ? CCR_X : 0;
+      c = x ? CCR_C : 0;
       break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-
-#ifdef TRACE
-  printf("trace: roxl.%c   src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  if (CCR_X_REF() != 0)
-    CCR_C_ON();
-  else
-    CCR_C_OFF();
-  for (; cnt > 0; cnt--) {
-    top = (src & mask);
-    src <<= 1;
-    if (CCR_X_REF() != 0) src |= 0x01;
-    if (top != 0) {
-      CCR_X_C_ON();
-    } else {
-      CCR_X_C_OFF();
     }
   }
 
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
+  r &= mask;
+  *ccr = x | ((r & msb) ? CCR_N : 0) | ((r == 0) ? CCR_Z : 0) | overflow | c;
+  return (ULong)r;
 }
 
-/*
- 　機能：roxl.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Roxl2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  int msb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsl.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最上位ビットを保存する */
-  msb = src & 0x8000;
-
-  src = ((ULong)src << 1) & 0xfffe;
-  if (CCR_X_REF()) {
-    src |= 1;
-  }
-
-  /* X フラグは押し出されたビット */
-  if (msb) {
-    CCR_X_ON();
-  } else {
-    CCR_X_OFF();
-  }
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* C および X フラグはシフト前の最上位ビット値を取る */
-  if (msb) {
-    CCR_C_ON();
-  } else {
-    CCR_C_OFF();
-  }
-
-  return false;
+// シフト・ローテート命令のコンディションコードを設定する。
+//   N、Z、V、Cはすべて求めてあるので遅延評価はしない。
+static inline void setShiftConditions(UWord ccr) {
+  lazyConditions.kind = LAZY_CC_NONE;
+  cpu.sr = (cpu.sr & ~(CCR_X | CCR_N | CCR_Z | CCR_V | CCR_C)) | ccr;
 }
 
 /*
- 　機能：ror命令を実行する
+ 　機能：データレジスタのシフト・ローテート命令を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Ror(char code1, char code2) {
-  char size;
-  char btm;
-  ULong mask;
-  ULong src;
+static inline bool shiftRegister(ShiftType type, bool left, int size,
+                                 char code1, char code2) {
+  int reg = code2 & 0x07;
+  int cnt = (code1 >> 1) & 0x07;
 
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      break;
-  }
-
-#ifdef TRACE
-  printf("trace: ror.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  CCR_C_OFF();
-  for (; cnt > 0; cnt--) {
-    btm = (char)(src & 0x01);
-    src >>= 1;
-    if (btm != 0) {
-      CCR_C_ON();
-      src |= mask;
-    } else {
-      CCR_C_OFF();
-    }
-  }
-
-  switch (size) {
-    case S_BYTE:
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
+  // 回数はデータレジスタの下位6ビット、または即値(0は8を表す)
+  if (code2 & 0x20) {
+    cnt = cpu.rd[cnt] & 63;
+  } else if (cnt == 0) {
+    cnt = 8;
   }
 
+  UWord ccr;
+  ULong result = shiftOperand(type, left, size, cpu.rd[reg], cnt, &ccr);
+  SetDreg(reg, result, size);
+  setShiftConditions(ccr);
   return false;
 }
 
 /*
- 　機能：ror.w <ea> 命令を実行する
+ 　機能：メモリのシフト・ローテート命令(xxx{.w} <ea>)を実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-static bool Ror2(char code2) {
-  char reg;
+static bool shiftMemory(ShiftType type, bool left, char code2) {
+  int reg = code2 & 0x07;
+  int mode = (code2 >> 3) & 0x07;
   Long src;
-  int mode;
-  int work_mode;
-  int lsb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
 
   /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
+  int work_mode = (mode == EA_AIPI) ? EA_AI : mode;
   if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
     return true;
   }
 
-#ifdef TRACE
-  printf("trace: lsr.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最下位ビットを保存する */
-  lsb = src & 0x1;
-
-  src = ((ULong)src >> 1) & 0x7fff;
-  if (lsb) {
-    src |= 0x8000;
-  }
+  UWord ccr;
+  ULong result = shiftOperand(type, left, S_WORD, src, 1, &ccr);
 
   /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* X フラグは変化せず */
-  /* C はシフト前の最下位ビット値を取る */
-  if (lsb) {
-    CCR_C_ON();
-  } else {
-    CCR_C_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：roxr命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Roxr(char code1, char code2) {
-  char size;
-  char btm;
-  ULong mask;
-  ULong src;
-  int i;
-
-  int cnt = ((code1 & 0x0E) >> 1);
-  size = ((code2 >> 6) & 0x03);
-  switch (size) {
-    case S_BYTE:
-      mask = 0x80;
-      break;
-    case S_WORD:
-      mask = 0x8000;
-      break;
-    default: /* S_LONG */
-      mask = 0x80000000;
-      break;
-  }
-  int reg = (code2 & 0x07);
-  if ((code2 & 0x20) != 0) {
-    cnt = rd[cnt] % 64;
-  } else {
-    if (cnt == 0) cnt = 8;
-  }
-  src = rd[reg];
-  switch (size) {
-    case S_BYTE:
-      src &= 0xFF;
-      break;
-    case S_WORD:
-      src &= 0xFFFF;
-      break;
-  }
-
-  if (CCR_X_REF() != 0)
-    CCR_C_ON();
-  else
-    CCR_C_OFF();
-  for (i = 0; i < cnt; i++) {
-    btm = (char)(src & 0x01);
-    src >>= 1;
-    if (CCR_X_REF() != 0) src |= mask;
-    if (btm != 0) {
-      CCR_X_C_ON();
-    } else {
-      CCR_X_C_OFF();
-    }
-  }
-
-#ifdef TRACE
-  printf("trace: roxr.%c   src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  switch (size) {
-    case S_BYTE:
-      rd[reg] = ((rd[reg] & 0xFFFFFF00) | src);
-      break;
-    case S_WORD:
-      rd[reg] = ((rd[reg] & 0xFFFF0000) | src);
-      break;
-    default: /* S_LONG */
-      rd[reg] = src;
-      break;
-  }
-
-  /* CCRセット */
-  CCR_V_OFF();
-  if ((src & mask) != 0) {
-    CCR_N_ON();
-    CCR_Z_OFF();
-  } else {
-    CCR_N_OFF();
-    if (src == 0)
-      CCR_Z_ON();
-    else
-      CCR_Z_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：roxr.w <ea> 命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-static bool Roxr2(char code2) {
-  char reg;
-  Long src;
-  int mode;
-  int work_mode;
-  int lsb;
-
-  reg = (code2 & 0x07);
-  mode = ((code2 >> 3) & 0x07);
-
-  /* アドレッシングモードがポストインクリメント間接の場合は間接でデータの取得 */
-  if (mode == EA_AIPI) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (get_data_at_ea_noinc(EA_VariableMemory, work_mode, reg, S_WORD, &src)) {
-    return true;
-  }
-
-#ifdef TRACE
-  printf("trace: lsr.%c    src=%d PC=%06lX\n", size_char[size], cnt, pc);
-#endif
-
-  /* シフト前の最下位ビットを保存する */
-  lsb = src & 0x1;
-
-  src = ((ULong)src >> 1) & 0x7fff;
-  if (CCR_X_REF()) {
-    src |= 0x8000;
-  }
-
-  /* X フラグは押し出されたビット */
-  if (lsb) {
-    CCR_X_ON();
-  } else {
-    CCR_X_OFF();
-  }
-
-  /* アドレッシングモードがプレデクリメント間接の場合は間接でデータの設定 */
-  if (mode == EA_AIPD) {
-    work_mode = EA_AI;
-  } else {
-    work_mode = mode;
-  }
-  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, src)) {
-    return true;
-  }
-
-  /* フラグの設定 */
-  general_conditions(src, S_WORD);
-
-  /* C はシフト前の最下位ビット値を取る */
-  if (lsb) {
-    CCR_C_ON();
-  } else {
-    CCR_C_OFF();
-  }
-
-  return false;
-}
-
-/*
- 　機能：Eライン命令を実行する
- 戻り値： true = 実行終了
-         false = 実行継続
-*/
-bool linee(char *pc_ptr) {
-  char code1, code2;
-
-  code1 = *(pc_ptr++);
-  code2 = *pc_ptr;
-  pc += 2;
-
-  if ((code1 & 0x01) != 0) {
-    /* 左 */
-    if ((code2 & 0xC0) == 0xC0) {
-      /* xxl{.w} <ea> 形式 */
-      switch (code1 & 0x0e) {
-        case 0x00:
-          return (Asl2(code2)); /* asl{.w} <ea> */
-        case 0x02:
-          return (Lsl2(code2)); /* lsl{.w} <ea> */
-        case 0x04:
-          return (Roxl2(code2)); /* roxl{.w} <ea> */
-        case 0x06:
-          return (Rol2(code2)); /* rol{.w} <ea> */
-        default:
-          break;
-      }
-    } else {
-      switch (code2 & 0x18) {
-        case 0x00:
-          return (Asl(code1, code2));
-        case 0x08:
-          return (Lsl(code1, code2));
-        case 0x10:
-          return (Roxl(code1, code2));
-        case 0x18:
-          return (Rol(code1, code2));
-        default:
-          break;
-      }
-    }
-  } else {
-    /* 右 */
-    if ((code2 & 0xC0) == 0xC0) {
-      /* xxr{.w} <ea> 形式 */
-      switch (code1 & 0x0e) {
-        case 0x00:
-          return (Asr2(code2)); /* asr{.w} <ea> */
-        case 0x02:
-          return (Lsr2(code2)); /* lsr{.w} <ea> */
-        case 0x04:
-          return (Roxr2(code2)); /* roxr{.w} <ea> */
-        case 0x06:
-          return (Ror2(code2)); /* ror{.w} <ea> */
-        default:
-          break;
-      }
-    } else {
-      switch (code2 & 0x18) {
-        case 0x00:
-          return (Asr(code1, code2));
-        case 0x08:
-          return (Lsr(code1, code2));
-        case 0x10:
-          return (Roxr(code1, code2));
-        case 0x18:
-          return (Ror(code1, code2));
-        default:
-          break;
-      }
-    }
-  }
-
-  return IllegalInstruction();
+  work_mode = (mode == EA_AIPD) ? EA_AI : mode;
+  if (set_data_at_ea(EA_VariableMemory, work_mode, reg, S_WORD, result)) {
+    return true;
+  }
+
+  setShiftConditions(ccr);
+  return false;
+}
+
+// 命令の種類と方向ごとにサイズ別のハンドラを作る(X-macro)
+#define SHIFT_LIST(X)       \
+  X(Asr, SHIFT_AS, false)   \
+  X(Asl, SHIFT_AS, true)    \
+  X(Lsr, SHIFT_LS, false)   \
+  X(Lsl, SHIFT_LS, true)    \
+  X(Roxr, SHIFT_ROX, false) \
+  X(Roxl, SHIFT_ROX, true)  \
+  X(Ror, SHIFT_RO, false)   \
+  X(Rol, SHIFT_RO, true)
+
+#define DEFINE_SHIFT_HANDLERS(name, type, left)             \
+  static bool name##_BYTE(char code1, char code2) {         \
+    return shiftRegister(type, left, S_BYTE, code1, code2); \
+  }                                                         \
+  static bool name##_WORD(char code1, char code2) {         \
+    return shiftRegister(type, left, S_WORD, code1, code2); \
+  }                                                         \
+  static bool name##_LONG(char code1, char code2) {         \
+    return shiftRegister(type, left, S_LONG, code1, code2); \
+  }                                                         \
+  static bool name##_Memory(char code1, char code2) {       \
+    return shiftMemory(type, left, code2);                  \
+  }
+SHIFT_LIST(DEFINE_SHIFT_HANDLERS)
+#undef DEFINE_SHIFT_HANDLERS
+
+// [方向(1 = 左)][種類][サイズ]
+static const InstructionHandler shiftHandlers[2][SHIFT_RO + 1][S_LONG + 1] = {
+#define SHIFT_HANDLER_ENTRY(name, type, left) \
+  [left][type] = {name##_BYTE, name##_WORD, name##_LONG},
+    SHIFT_LIST(SHIFT_HANDLER_ENTRY)
+#undef SHIFT_HANDLER_ENTRY
+};
+
+// [方向(1 = 左)][種類]
+static const InstructionHandler shiftMemoryHandlers[2][SHIFT_RO + 1] = {
+#define SHIFT_MEMORY_HANDLER_ENTRY(name, type, left) \
+  [left][type] = name##_Memory,
+    SHIFT_LIST(SHIFT_MEMORY_HANDLER_ENTRY)
+#undef SHIFT_MEMORY_HANDLER_ENTRY
+};
+
+/*
+ 　機能：Eライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ(NULL = 不当命令)
+*/
+InstructionHandler decodeLineE(char code1, char code2) {
+  int left = code1 & 0x01;
+  int size = (code2 >> 6) & 0x03;
+
+  // xxx{.bwl} #<data>,Dn / xxx{.bwl} Dm,Dn 形式
+  if (size <= S_LONG) return shiftHandlers[left][(code2 >> 3) & 0x03][size];
+
+  // xxx{.w} <ea> 形式(それ以外はMC68020以降のビットフィールド命令)
+  if (code1 & 0x08) return NULL;
+  return shiftMemoryHandlers[left][(code1 >> 1) & 0x03];
 }
 
 /* $Id: linee.c,v 1.2 2009-08-08 06:49:44 masamic Exp $ */
@@ -26,27 +26,28 @@
 #include "fefunc.h"
 #include "human68k.h"
 #include "mem.h"
+#include "muldiv.h"
 #include "operate.h"
 #include "run68.h"
 
-#define CCR_N_C_ON() (sr |= (CCR_N | CCR_C))
-#define CCR_N_C_OFF() (sr &= ~(CCR_N | CCR_C))
-#define CCR_V_C_ON() (sr |= (CCR_V | CCR_C))
-#define CCR_Z_C_ON() (sr |= (CCR_Z | CCR_C))
+#define CCR_N_C_ON() (EvaluateConditions(), cpu.sr |= (CCR_N | CCR_C))
+#define CCR_N_C_OFF() (EvaluateConditions(), cpu.sr &= ~(CCR_N | CCR_C))
+#define CCR_V_C_ON() (EvaluateConditions(), cpu.sr |= (CCR_V | CCR_C))
+#define CCR_Z_C_ON() (EvaluateConditions(), cpu.sr |= (CCR_Z | CCR_C))
 
 /*
  　機能：倍精度浮動小数点数をレジスタ2つに移動する
  戻り値：なし
 */
 static void From_dbl(DBL *p, int reg) {
-  rd[reg] = (p->c[7] << 24);
-  rd[reg] |= (p->c[6] << 16);
-  rd[reg] |= (p->c[5] << 8);
-  rd[reg] |= p->c[4];
-  rd[reg + 1] = (p->c[3] << 24);
-  rd[reg + 1] |= (p->c[2] << 16);
-  rd[reg + 1] |= (p->c[1] << 8);
-  rd[reg + 1] |= p->c[0];
+  cpu.rd[reg] = (p->c[7] << 24);
+  cpu.rd[reg] |= (p->c[6] << 16);
+  cpu.rd[reg] |= (p->c[5] << 8);
+  cpu.rd[reg] |= p->c[4];
+  cpu.rd[reg + 1] = (p->c[3] << 24);
+  cpu.rd[reg + 1] |= (p->c[2] << 16);
+  cpu.rd[reg + 1] |= (p->c[1] << 8);
+  cpu.rd[reg + 1] |= p->c[0];
 }
 
 /*
@@ -67,7 +68,7 @@ static void To_dbl(DBL *dbl, Long d0, Long d1) {
  　機能：FEFUNC _LMULを実行する(エラーは未サポート)
  戻り値：演算結果
 */
-static Long Lmul(Long d0, Long d1) { return (d0 * d1); }
+static Long Lmul(Long d0, Long d1) { return (Long)((ULong)d0 * (ULong)d1); }
 
 /*
  　機能：FEFUNC _LDIVを実行する
@@ -80,7 +81,9 @@ static Long Ldiv(Long d0, Long d1) {
   }
 
   CCR_C_OFF();
-  return (d0 / d1);
+  mulDivCounts[MULDIV_FEFUNC_DIV] += 1;
+  Long mod;
+  return DivideSigned(d0, d1, &mod);
 }
 
 /*
@@ -94,7 +97,10 @@ static Long Lmod(Long d0, Long d1) {
   }
 
   CCR_C_OFF();
-  return (d0 % d1);
+  mulDivCounts[MULDIV_FEFUNC_DIV] += 1;
+  Long mod;
+  DivideSigned(d0, d1, &mod);
+  return mod;
 }
 
 /*
@@ -114,7 +120,9 @@ static ULong Udiv(ULong d0, ULong d1) {
   }
 
   CCR_C_OFF();
-  return (d0 / d1);
+  mulDivCounts[MULDIV_FEFUNC_DIV] += 1;
+  ULong mod;
+  return DivideUnsigned(d0, d1, &mod);
 }
 
 /*
@@ -128,7 +136,10 @@ static ULong Umod(ULong d0, ULong d1) {
   }
 
   CCR_C_OFF();
-  return (d0 % d1);
+  mulDivCounts[MULDIV_FEFUNC_DIV] += 1;
+  ULong mod;
+  DivideUnsigned(d0, d1, &mod);
+  return mod;
 }
 
 /*
@@ -238,7 +249,7 @@ static Long Stol(Long adr) {
       CCR_V_OFF();
     } else {
       CCR_C_OFF();
-      ra[0] += Strl(p, 10);
+      cpu.ra[0] += Strl(p, 10);
     }
   } else {
     if (errno == ERANGE) {
@@ -246,7 +257,7 @@ static Long Stol(Long adr) {
       CCR_N_OFF();
     } else {
       CCR_C_OFF();
-      ra[0] += Strl(p, 10);
+      cpu.ra[0] += Strl(p, 10);
     }
   }
   return (ret);
@@ -266,16 +277,16 @@ static void Stod(Long adr) {
     CCR_N_OFF();
   } else {
     CCR_C_OFF();
-    ra[0] += Strl(p, 10);
+    cpu.ra[0] += Strl(p, 10);
   }
 
   From_dbl(&ret, 0);
 
   if (ret.dbl == (Long)ret.dbl) {
-    rd[2] |= 0xFFFF;
-    rd[3] = (Long)ret.dbl;
+    cpu.rd[2] |= 0xFFFF;
+    cpu.rd[3] = (Long)ret.dbl;
   } else {
-    rd[2] &= 0xFFFF0000;
+    cpu.rd[2] &= 0xFFFF0000;
   }
 }
 
@@ -300,7 +311,7 @@ static void Dtos(Long d0, Long d1, Long a0) {
   char buf[32];
   snprintf(buf, sizeof(buf), "%.14g", arg1.dbl);
   WriteStringSuper(a0, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -311,7 +322,7 @@ static void Ltos(Long num, Long adr) {
   char buf[32];
   snprintf(buf, sizeof(buf), "%d", num);
   WriteStringSuper(adr, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -322,7 +333,7 @@ static void Htos(Long num, Long adr) {
   char buf[32];
   snprintf(buf, sizeof(buf), "%X", num);
   WriteStringSuper(adr, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -333,7 +344,7 @@ static void Otos(Long num, Long adr) {
   char buf[32];
   snprintf(buf, sizeof(buf), "%o", num);
   WriteStringSuper(adr, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -358,7 +369,7 @@ static void Btos(Long num, Long adr) {
   *p = '\0';
 
   WriteStringSuper(adr, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -400,15 +411,15 @@ static void Val(Long str) {
       return;
     }
   }
-  ra[0] += Strl((base == 10) ? p : p + 2, base);
+  cpu.ra[0] += Strl((base == 10) ? p : p + 2, base);
 
   From_dbl(&ret, 0);
 
   if (base == 10 && ret.dbl == (Long)ret.dbl) {
-    rd[2] |= 0xFFFF;
-    rd[3] = (Long)ret.dbl;
+    cpu.rd[2] |= 0xFFFF;
+    cpu.rd[3] = (Long)ret.dbl;
   } else {
-    rd[2] &= 0xFFFF0000;
+    cpu.rd[2] &= 0xFFFF0000;
   }
   CCR_C_OFF();
 }
@@ -424,7 +435,7 @@ static void Iusing(Long num, Long keta, Long adr) {
   char buf[256];
   snprintf(buf, sizeof(buf), "%*d", keta, num);
   WriteStringSuper(adr, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -506,7 +517,7 @@ static void Using(Long d0, Long d1, Long isz, Long dsz, Long atr, Long a0) {
   }
 
   WriteStringSuper(a0, buf);
-  ra[0] += strlen(buf);
+  cpu.ra[0] += strlen(buf);
 }
 
 /*
@@ -994,13 +1005,13 @@ static void Cltod(Long adr) {
   Long num = mem_get(adr, S_LONG);
   DBL arg1 = {.dbl = num};
 
-  Long d0 = rd[0];
-  Long d1 = rd[1];
+  Long d0 = cpu.rd[0];
+  Long d1 = cpu.rd[1];
   From_dbl(&arg1, 0);
-  mem_set(adr, rd[0], S_LONG);
-  mem_set(adr + 4, rd[1], S_LONG);
-  rd[0] = d0;
-  rd[1] = d1;
+  mem_set(adr, cpu.rd[0], S_LONG);
+  mem_set(adr + 4, cpu.rd[1], S_LONG);
+  cpu.rd[0] = d0;
+  cpu.rd[1] = d1;
 }
 
 /*
@@ -1032,13 +1043,13 @@ static void Cftod(Long adr) {
   FLT fl = LongToFLT(d0);
   DBL db = {.dbl = fl.flt};
 
-  d0 = rd[0];
-  d1 = rd[1];
+  d0 = cpu.rd[0];
+  d1 = cpu.rd[1];
   From_dbl(&db, 0);
-  mem_set(adr, rd[0], S_LONG);
-  mem_set(adr + 4, rd[1], S_LONG);
-  rd[0] = d0;
-  rd[1] = d1;
+  mem_set(adr, cpu.rd[0], S_LONG);
+  mem_set(adr + 4, cpu.rd[1], S_LONG);
+  cpu.rd[0] = d0;
+  cpu.rd[1] = d1;
 }
 
 /*
@@ -1050,13 +1061,13 @@ static void Cdtof(Long adr) {
   Long d0;
   Long d1;
 
-  d0 = rd[0];
-  d1 = rd[1];
-  rd[0] = mem_get(adr, S_LONG);
-  rd[1] = mem_get(adr + 4, S_LONG);
+  d0 = cpu.rd[0];
+  d1 = cpu.rd[1];
+  cpu.rd[0] = mem_get(adr, S_LONG);
+  cpu.rd[1] = mem_get(adr + 4, S_LONG);
   To_dbl(&arg, d0, d1);
-  rd[0] = d0;
-  rd[1] = d1;
+  cpu.rd[0] = d0;
+  cpu.rd[1] = d1;
 
   FLT fl = {.flt = (float)arg.dbl};
   CCR_C_OFF();
@@ -1078,16 +1089,16 @@ static void Cdcmp(Long adr) {
   Long d0;
   Long d1;
 
-  d0 = rd[0];
-  d1 = rd[1];
-  rd[0] = mem_get(adr, S_LONG);
-  rd[1] = mem_get(adr + 4, S_LONG);
+  d0 = cpu.rd[0];
+  d1 = cpu.rd[1];
+  cpu.rd[0] = mem_get(adr, S_LONG);
+  cpu.rd[1] = mem_get(adr + 4, S_LONG);
   To_dbl(&arg1, d0, d1);
-  rd[0] = mem_get(adr + 8, S_LONG);
-  rd[1] = mem_get(adr + 12, S_LONG);
+  cpu.rd[0] = mem_get(adr + 8, S_LONG);
+  cpu.rd[1] = mem_get(adr + 12, S_LONG);
   To_dbl(&arg2, d0, d1);
-  rd[0] = d0;
-  rd[1] = d1;
+  cpu.rd[0] = d0;
+  cpu.rd[1] = d1;
 
   arg1.dbl = arg1.dbl - arg2.dbl;
 
@@ -1209,227 +1220,227 @@ static bool fefunc(UByte code) {
   /* F系列のベクタが書き換えられているかどうか検査 */
   ULong adr = mem_get(VECNO_FLINE * 4, S_LONG);
   if (adr != DefaultExceptionHandler[VECNO_FLINE]) {
-    ra[7] -= 4;
-    mem_set(ra[7], pc - 2, S_LONG);
-    ra[7] -= 2;
-    mem_set(ra[7], sr, S_WORD);
-    pc = adr;
+    cpu.ra[7] -= 4;
+    mem_set(cpu.ra[7], cpu.pc - 2, S_LONG);
+    cpu.ra[7] -= 2;
+    mem_set(cpu.ra[7], GetSr(), S_WORD);
+    cpu.pc = adr;
     return false;
   }
   if (save_s == 0) SR_S_OFF();
 
 #ifdef TRACE
-  printf("trace: FEFUNC   0xFE%02X PC=%06lX\n", code, pc);
+  printf("trace: FEFUNC   0xFE%02X PC=%06lX\n", code, cpu.pc);
 #endif
   switch (code) {
     case 0x00:
-      rd[0] = Lmul(rd[0], rd[1]);
+      cpu.rd[0] = Lmul(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x01:
-      rd[0] = Ldiv(rd[0], rd[1]);
+      cpu.rd[0] = Ldiv(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x02:
-      rd[0] = Lmod(rd[0], rd[1]);
+      cpu.rd[0] = Lmod(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x04:
-      rd[0] = Umul((ULong)rd[0], (ULong)rd[1]);
+      cpu.rd[0] = Umul((ULong)cpu.rd[0], (ULong)cpu.rd[1]);
       break;
     case 0x05:
-      rd[0] = Udiv((ULong)rd[0], (ULong)rd[1]);
+      cpu.rd[0] = Udiv((ULong)cpu.rd[0], (ULong)cpu.rd[1]);
       break;
     case 0x06:
-      rd[0] = Umod((ULong)rd[0], (ULong)rd[1]);
+      cpu.rd[0] = Umod((ULong)cpu.rd[0], (ULong)cpu.rd[1]);
       break;
     case 0x08: /* _IMUL */
-      rd[1] = (ULong)rd[0] * (ULong)rd[1];
-      if (rd[1] < 0)
-        rd[0] = -1; /* 本当は上位4バイトが入る */
+      cpu.rd[1] = (ULong)cpu.rd[0] * (ULong)cpu.rd[1];
+      if (cpu.rd[1] < 0)
+        cpu.rd[0] = -1; /* 本当は上位4バイトが入る */
       else
-        rd[0] = 0; /* 本当は上位4バイトが入る */
+        cpu.rd[0] = 0; /* 本当は上位4バイトが入る */
       break;
     case 0x09: /* _IDIV */ /* unsigned int 除算 d0..d1 d0/d1 */
     {
       ULong d0;
       ULong d1;
 
-      d0 = (ULong)rd[0];
-      d1 = (ULong)rd[1];
+      d0 = (ULong)cpu.rd[0];
+      d1 = (ULong)cpu.rd[1];
 
-      rd[0] = Udiv(d0, d1);
-      rd[1] = Umod(d0, d1);
+      cpu.rd[0] = Udiv(d0, d1);
+      cpu.rd[1] = Umod(d0, d1);
     } break;
     case 0x0C: /* _RANDOMIZE */
-      if (rd[0] >= -32768 && rd[0] <= 32767) srand(rd[0] + 32768);
+      if (cpu.rd[0] >= -32768 && cpu.rd[0] <= 32767) srand(cpu.rd[0] + 32768);
       break;
     case 0x0D: /* _SRAND */
-      if (rd[0] >= 0 && rd[0] <= 65535) srand(rd[0]);
+      if (cpu.rd[0] >= 0 && cpu.rd[0] <= 65535) srand(cpu.rd[0]);
       break;
     case 0x0E: /* _RAND */
-      rd[0] = ((unsigned)(rand()) % 32768);
+      cpu.rd[0] = ((unsigned)(rand()) % 32768);
       break;
     case 0x10:
-      rd[0] = Stol(ra[0]);
+      cpu.rd[0] = Stol(cpu.ra[0]);
       break;
     case 0x11:
-      Ltos(rd[0], ra[0]);
+      Ltos(cpu.rd[0], cpu.ra[0]);
       break;
     case 0x12:
-      rd[0] = FefuncStoh(&ra[0]);
+      cpu.rd[0] = FefuncStoh(&cpu.ra[0]);
       break;
     case 0x13:
-      Htos(rd[0], ra[0]);
+      Htos(cpu.rd[0], cpu.ra[0]);
       break;
     case 0x15:
-      Otos(rd[0], ra[0]);
+      Otos(cpu.rd[0], cpu.ra[0]);
       break;
     case 0x17:
-      Btos(rd[0], ra[0]);
+      Btos(cpu.rd[0], cpu.ra[0]);
       break;
     case 0x18:
-      Iusing(rd[0], rd[1], ra[0]);
+      Iusing(cpu.rd[0], cpu.rd[1], cpu.ra[0]);
       break;
     case 0x1A:
-      Ltod(rd[0]);
+      Ltod(cpu.rd[0]);
       break;
     case 0x1B:
-      rd[0] = Dtol(rd[0], rd[1]);
+      cpu.rd[0] = Dtol(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x1C:
-      rd[0] = Ltof(rd[0]);
+      cpu.rd[0] = Ltof(cpu.rd[0]);
       break;
     case 0x1D:
-      rd[0] = Ftol(rd[0]);
+      cpu.rd[0] = Ftol(cpu.rd[0]);
       break;
     case 0x1E:
-      Ftod(rd[0]);
+      Ftod(cpu.rd[0]);
       break;
     case 0x20:
-      Val(ra[0]);
+      Val(cpu.ra[0]);
       break;
     case 0x21:
-      Using(rd[0], rd[1], rd[2], rd[3], rd[4], ra[0]);
+      Using(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3], cpu.rd[4], cpu.ra[0]);
       break;
     case 0x22:
-      Stod(ra[0]);
+      Stod(cpu.ra[0]);
       break;
     case 0x23:
-      Dtos(rd[0], rd[1], ra[0]);
+      Dtos(cpu.rd[0], cpu.rd[1], cpu.ra[0]);
       break;
     case 0x25:
-      FefuncFcvt(&rd[0], &rd[1], rd[2], ra[0]);
+      FefuncFcvt(&cpu.rd[0], &cpu.rd[1], cpu.rd[2], cpu.ra[0]);
       break;
     case 0x28:
-      Dtst(rd[0], rd[1]);
+      Dtst(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x29:
-      Dcmp(rd[0], rd[1], rd[2], rd[3]);
+      Dcmp(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x2A:
-      Dneg(rd[0], rd[1]);
+      Dneg(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x2B:
-      Dadd(rd[0], rd[1], rd[2], rd[3]);
+      Dadd(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x2C:
-      Dsub(rd[0], rd[1], rd[2], rd[3]);
+      Dsub(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x2D:
-      Dmul(rd[0], rd[1], rd[2], rd[3]);
+      Dmul(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x2E:
-      Ddiv(rd[0], rd[1], rd[2], rd[3]);
+      Ddiv(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x2F:
-      Dmod(rd[0], rd[1], rd[2], rd[3]);
+      Dmod(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x30:
-      Dabs(rd[0], rd[1]);
+      Dabs(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x33:
-      Dfloor(rd[0], rd[1]);
+      Dfloor(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x36:
-      Sin(rd[0], rd[1]);
+      Sin(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x37:
-      Cos(rd[0], rd[1]);
+      Cos(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x38:
-      Tan(rd[0], rd[1]);
+      Tan(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x39:
-      Atan(rd[0], rd[1]);
+      Atan(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x3A:
-      Log(rd[0], rd[1]);
+      Log(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x3B:
-      Exp(rd[0], rd[1]);
+      Exp(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x3C:
-      Sqr(rd[0], rd[1]);
+      Sqr(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x3F:
-      Pow(rd[0], rd[1], rd[2], rd[3]);
+      Pow(cpu.rd[0], cpu.rd[1], cpu.rd[2], cpu.rd[3]);
       break;
     case 0x40: /* _RND */
-      rd[0] = rand() * rand() * 4;
-      rd[1] = rand() * rand() * 4;
+      cpu.rd[0] = rand() * rand() * 4;
+      cpu.rd[1] = rand() * rand() * 4;
       break;
     case 0x58:
-      Ftst(rd[0]);
+      Ftst(cpu.rd[0]);
       break;
     case 0x5D:
-      rd[0] = Fmul(rd[0], rd[1]);
+      cpu.rd[0] = Fmul(cpu.rd[0], cpu.rd[1]);
       break;
     case 0x5E:
-      rd[0] = Fdiv(rd[0], rd[1]);
+      cpu.rd[0] = Fdiv(cpu.rd[0], cpu.rd[1]);
       break;
 
     case 0xE0: /* __CLMUL : signed int 乗算 */
-      Clmul(ra[7]);
+      Clmul(cpu.ra[7]);
       break;
     case 0xE1: /* __CLDIV : signed int 除算 */
-      Cldiv(ra[7]);
+      Cldiv(cpu.ra[7]);
       break;
     case 0xE2: /* __CLMOD : signed int 除算の剰余 */
-      Clmod(ra[7]);
+      Clmod(cpu.ra[7]);
       break;
     case 0xE3: /* __CUMUL : unsigned int 乗算 */
-      Cumul(ra[7]);
+      Cumul(cpu.ra[7]);
       break;
     case 0xE4: /* __CUDIV : unsigned int 除算 */
-      Cudiv(ra[7]);
+      Cudiv(cpu.ra[7]);
       break;
     case 0xE5: /* __CUMOD : unsigned int 除算の剰余 */
-      Cumod(ra[7]);
+      Cumod(cpu.ra[7]);
       break;
     case 0xE6:
-      Cltod(ra[7]);
+      Cltod(cpu.ra[7]);
       break;
     case 0xE7:
-      Cdtol(ra[7]);
+      Cdtol(cpu.ra[7]);
       break;
     case 0xEA:
-      Cftod(ra[7]);
+      Cftod(cpu.ra[7]);
       break;
     case 0xEB:
-      Cdtof(ra[7]);
+      Cdtof(cpu.ra[7]);
       break;
     case 0xEC:
-      Cdcmp(ra[7]);
+      Cdcmp(cpu.ra[7]);
       break;
     case 0xED:
-      Cdadd(ra[7]);
+      Cdadd(cpu.ra[7]);
       break;
     case 0xEE:
-      Cdsub(ra[7]);
+      Cdsub(cpu.ra[7]);
       break;
     case 0xEF:
-      Cdmul(ra[7]);
+      Cdmul(cpu.ra[7]);
       break;
     case 0xF0:
-      Cddiv(ra[7]);
+      Cddiv(cpu.ra[7]);
       break;
     default:
       printf("0x%X\n", code);
@@ -1441,23 +1452,40 @@ static bool fefunc(UByte code) {
 }
 
 /*
- 　機能：Fライン命令を実行する
+ 　機能：DOSコールを実行する
  戻り値： true = 実行終了
          false = 実行継続
 */
-bool linef(char *pc_ptr) {
-  char code;
+static bool Doscall(char code1, char code2) { return dos_call(code2); }
 
-  code = *(pc_ptr++);
-  pc += 2;
+/*
+ 　機能：FLOATコールを実行する
+ 戻り値： true = 実行終了
+         false = 実行継続
+*/
+static bool Fecall(char code1, char code2) { return fefunc(code2); }
+
+/*
+ 　機能：未定義のFライン命令を実行する
+ 戻り値： true = 実行終了
+         false = 実行継続
+*/
+static bool UndefinedLinef(char code1, char code2) {
+  err68a("未定義のＦライン命令を実行しました", __FILE__, __LINE__);
+}
 
+/*
+ 　機能：Fライン命令の命令ハンドラを得る
+ 戻り値：命令ハンドラ
+*/
+InstructionHandler decodeLineF(char code1, char code2) {
   /* DOSコールの処理 */
-  if (code == (char)0xFF) return (dos_call(*pc_ptr));
+  if (code1 == (char)0xFF) return Doscall;
 
   /* FLOATコールの処理 */
-  if (code == (char)0xFE) return (fefunc(*pc_ptr));
+  if (code1 == (char)0xFE) return Fecall;
 
-  err68a("未定義のＦライン命令を実行しました", __FILE__, __LINE__);
+  return UndefinedLinef;
 }
 
 /* $Id: linef.c,v 1.3 2009-08-08 06:49:44 masamic Exp $ */
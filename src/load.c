@@ -19,6 +19,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #ifdef _WIN32
 #include <direct.h>
 #else
@@ -26,16 +28,62 @@
 #endif
 
 #include "dos_misc.h"  // Getenv()
+#include "hle.h"
 #include "host.h"
 #include "human68k.h"
 #include "mem.h"
 #include "operate.h"
 #include "run68.h"
 
-static UByte xhead[XHEAD_SIZE];
+static THREAD_LOCAL UByte xhead[XHEAD_SIZE];
 
 static Long xhead_getl(int);
 
+// 実行ファイルのキャッシュ
+//   makeによるビルドなどで同じ実行ファイルを何度も起動する場合のために、
+//   読み込んでリロケートした後のメモリイメージを記録しておき、
+//   次回からはヘッダの解析やリロケートを行わずにメモリに複写する。
+//   ファイルの内容は毎回読み込み、記録した時と内容、読み込みアドレス、
+//   実行形式が全て一致した場合だけ使用する。更新日時などで判定すると、
+//   同じ秒のうちに同じ大きさで書き換えられたファイルを区別できない。
+//   マシンごとに保持し続けるので、-batchや-serverで続けて実行する場合にも
+//   有効になる。
+#define EXEC_IMAGE_CACHE_ENTRIES 16
+
+// キャッシュを検索するキー
+typedef struct {
+  ULong loadAddress;
+  ExecType execType;
+  bool xname;      // Xファイルとして扱う名前か(isXFileName()の結果)
+  ULong size;      // ファイルの大きさ
+  char* contents;  // ファイルの内容
+} ExecImageKey;
+
+typedef struct {
+  ExecImageKey key;  // key.contentsがNULLなら未使用
+  unsigned long long lastUsed;
+
+  char* image;      // 読み込み後のメモリイメージ
+  ULong imageSize;  // Xファイルならヘッダを除いたファイルの大きさ
+  Long entryOffset;  // 実行開始アドレスの読み込みアドレスからのオフセット
+  bool xfile;
+  ULong codeSize;
+  ULong textAndData;
+  ULong bssSize;
+  char* symbols;  // シンボルテーブル(-hle用、NULLならなし)
+  ULong symbolsSize;
+} ExecImage;
+
+struct ExecImageCache {
+  ExecImage images[EXEC_IMAGE_CACHE_ENTRIES];
+  unsigned long long clock;
+};
+
+// 実行中のマシンのキャッシュ
+static THREAD_LOCAL ExecImageCache* execImageCache;
+static THREAD_LOCAL unsigned long long execImageHits;
+static THREAD_LOCAL unsigned long long execImageMisses;
+
 #ifdef _WIN32
 #define PATH_DELIMITER ';'
 #else
@@ -187,7 +235,7 @@ static bool xrelocate(Long reloc_adr, Long reloc_size, Long read_top) {
  　　　　!0 = プログラム開始アドレス
 */
 static Long xfile_cnv(Long* prog_size, Long* prog_sz2, Long read_top,
-                      void (*onError)(const char*)) {
+                      void (*onError)(const char*), bool hle) {
   if (xhead_getl(0x3C) != 0) {
     onError("BINDされているファイルです\n");
     return (0);
@@ -198,8 +246,18 @@ static Long xfile_cnv(Long* prog_size, Long* prog_sz2, Long read_top,
   Long data_size = xhead_getl(0x10);
   Long bss_size = xhead_getl(0x14);
   Long reloc_size = xhead_getl(0x18);
+  Long symbol_size = xhead_getl(0x1C);
   Long textAndData = code_size + data_size;
 
+  // シンボルテーブルはbssの初期化で消えるので、先に調べておく
+  if (hle && symbol_size > 0) {
+    Span sym = GetReadableMemorySuper(read_top + textAndData + reloc_size,
+                                      symbol_size);
+    if (sym.bufptr) {
+      HleInstallFromSymbols(read_top, code_size, sym.bufptr, symbol_size);
+    }
+  }
+
   if (reloc_size != 0) {
     if (!xrelocate(textAndData, reloc_size, read_top)) {
       onError("未対応のリロケート情報があります\n");
@@ -222,16 +280,223 @@ static Long xfile_cnv(Long* prog_size, Long* prog_sz2, Long read_top,
   return (read_top + pc_begin);
 }
 
+// ファイル名と実行形式の指定から、Xファイルとして扱うか調べる。
+//   実際にXファイルとして読み込むのは、ファイルの先頭が"HU"の場合だけ。
+static bool isXFileName(const char* fname, ExecType execType) {
+  if (execType == EXEC_TYPE_R) return false;
+  if (execType == EXEC_TYPE_X) return true;
+
+  size_t len = strlen(fname);
+  if (len <= 2) return false;
+  const char* ext = &fname[len - 2];
+  return strcmp(ext, ".x") == 0 || strcmp(ext, ".X") == 0;
+}
+
 /*
- 　機能：プログラムをメモリに読み込む(fpはクローズされる)
+   機能：
+     開いた実行ファイルの内容を読み込み、キャッシュを検索するキーを作成する
+     ファイルの位置は先頭に戻す。
+   パラメータ：
+     FILE*          fp           <in>   実行ファイル
+     const char*    fname        <in>   ファイル名
+     ULong          loadAddress  <in>   読み込むアドレス
+     ULong          limit        <in>   読み込めるメモリの末尾+1
+     ExecType       execType     <in>   実行形式
+     ExecImageKey*  key          <out>  キー(contentsは呼び出し側で解放する)
+   戻り値：
+     true = 成功
+     false = キャッシュを使わない(通常のファイルでない、大きすぎるなど)
+*/
+static bool getExecImageKey(FILE* fp, const char* fname, ULong loadAddress,
+                            ULong limit, ExecType execType,
+                            ExecImageKey* key) {
+  struct stat st;
+  if (fstat(fileno(fp), &st) != 0) return false;
+  if ((st.st_mode & S_IFMT) != S_IFREG) return false;
+  if (st.st_size <= 0 || (unsigned long long)st.st_size > limit - loadAddress)
+    return false;  // エラーはファイルから読み込む時に処理する
+
+  ULong size = (ULong)st.st_size;
+  char* contents = malloc(size);
+  if (!contents) return false;
+  bool ok = fread(contents, 1, size, fp) == size;
+  if (fseek(fp, 0, SEEK_SET) != 0 || !ok) {
+    free(contents);
+    return false;
+  }
+
+  *key = (ExecImageKey){loadAddress, execType, isXFileName(fname, execType),
+                        size, contents};
+  return true;
+}
+
+static bool isSameExecImageKey(const ExecImageKey* a, const ExecImageKey* b) {
+  return a->loadAddress == b->loadAddress && a->execType == b->execType &&
+         a->xname == b->xname && a->size == b->size &&
+         memcmp(a->contents, b->contents, a->size) == 0;
+}
+
+static ExecImage* findExecImage(const ExecImageKey* key) {
+  for (int i = 0; i < EXEC_IMAGE_CACHE_ENTRIES; i += 1) {
+    ExecImage* entry = &execImageCache->images[i];
+    if (entry->key.contents && isSameExecImageKey(&entry->key, key))
+      return entry;
+  }
+  return NULL;
+}
+
+static void freeExecImage(ExecImage* entry) {
+  free(entry->key.contents);
+  free(entry->image);
+  free(entry->symbols);
+  memset(entry, 0, sizeof(*entry));
+}
+
+/*
+   機能：
+     キャッシュしたメモリイメージをメモリに複写する
+     ファイルから読み込んだ場合と同じ値をprog_sz、prog_sz2に返す。
+   戻り値：
+     正 = 実行開始アドレス
+     負 = 複写できない(ファイルから読み込んでエラー処理を行うこと)
+*/
+static Long loadExecImage(const ExecImage* entry, Long read_top,
+                          Long* prog_sz, Long* prog_sz2, bool hle) {
+  // メモリが足りるかはファイルから読み込む場合と同じ条件で判定する
+  ULong limit = (ULong)*prog_sz2;
+  if ((ULong)read_top + (ULong)entry->key.size > limit) return -1;
+  ULong bssEnd = entry->textAndData + entry->bssSize;
+  if (entry->xfile && (ULong)read_top + bssEnd > limit) return -1;
+
+  Span mem = GetWritableMemorySuper(read_top, entry->imageSize);
+  if (!mem.bufptr) return -1;
+  memcpy(mem.bufptr, entry->image, entry->imageSize);
+
+  if (!entry->xfile) {
+    *prog_sz = *prog_sz2 = (Long)entry->imageSize;
+    return read_top;
+  }
+
+  if (hle && entry->symbols) {
+    HleInstallFromSymbols(read_top, entry->codeSize, entry->symbols,
+                          entry->symbolsSize);
+  }
+
+  // bssのうちファイルの大きさを超える部分は、イメージに含まれていない
+  ULong start = (entry->imageSize > entry->textAndData) ? entry->imageSize
+                                                        : entry->textAndData;
+  if (start < bssEnd) {
+    Span bss = GetWritableMemorySuper(read_top + start, bssEnd - start);
+    if (bss.bufptr) memset(bss.bufptr, 0, bssEnd - start);
+  }
+
+  *prog_sz = (Long)bssEnd;
+  *prog_sz2 = (Long)entry->textAndData;
+  return read_top + entry->entryOffset;
+}
+
+// Xファイルのシンボルテーブルを複製する(bssの初期化で消えるため)。
+//   xheadを読み込んだ後、xfile_cnv()の前に呼び出すこと。
+static char* copySymbols(Long read_top, ULong* outSize) {
+  ULong offset = xhead_getl(0x0C) + xhead_getl(0x10) + xhead_getl(0x18);
+  ULong size = xhead_getl(0x1C);
+  *outSize = 0;
+  if (size == 0) return NULL;
+
+  Span sym = GetReadableMemorySuper(read_top + offset, size);
+  if (!sym.bufptr) return NULL;
+
+  char* copy = malloc(size);
+  if (!copy) return NULL;
+  memcpy(copy, sym.bufptr, size);
+  *outSize = size;
+  return copy;
+}
+
+// 読み込んだプログラムのメモリイメージをキャッシュに記録する。
+//   key->contentsとsymbolsの所有権は引き継ぐ。
+//   記録できなかった場合は何もしない(次回もファイルから読み込む)。
+static void storeExecImage(const ExecImageKey* key, Long read_top,
+                           ULong imageSize, bool xfile, Long pc_begin,
+                           Long prog_sz, Long prog_sz2, char* symbols,
+                           ULong symbolsSize) {
+  // 空きがなければ最も長く使われていないものを置き換える
+  ExecImage* images = execImageCache->images;
+  ExecImage* entry = &images[0];
+  for (int i = 0; i < EXEC_IMAGE_CACHE_ENTRIES; i += 1) {
+    if (!images[i].key.contents) {
+      entry = &images[i];
+      break;
+    }
+    if (images[i].lastUsed < entry->lastUsed) entry = &images[i];
+  }
+  freeExecImage(entry);
+
+  Span mem = GetReadableMemorySuper(read_top, imageSize);
+  char* image = malloc(imageSize ? imageSize : 1);
+  if (!mem.bufptr || !image) {
+    free(key->contents);
+    free(image);
+    free(symbols);
+    return;
+  }
+  memcpy(image, mem.bufptr, imageSize);
+
+  entry->key = *key;
+  entry->lastUsed = ++execImageCache->clock;
+  entry->image = image;
+  entry->imageSize = imageSize;
+  entry->entryOffset = pc_begin - read_top;
+  entry->xfile = xfile;
+  entry->codeSize = xfile ? (ULong)xhead_getl(0x0C) : 0;
+  entry->textAndData = (ULong)prog_sz2;
+  entry->bssSize = (ULong)(prog_sz - prog_sz2);
+  entry->symbols = symbols;
+  entry->symbolsSize = symbolsSize;
+}
+
+// マシンごとの実行ファイルのキャッシュを作成する。
+//   NULLならメモリ不足。
+ExecImageCache* CreateExecImageCache(void) {
+  return calloc(1, sizeof(ExecImageCache));
+}
+
+// 実行ファイルのキャッシュを、記録したイメージとともに破棄する。
+void DestroyExecImageCache(ExecImageCache* cache) {
+  for (int i = 0; i < EXEC_IMAGE_CACHE_ENTRIES; i += 1) {
+    freeExecImage(&cache->images[i]);
+  }
+  free(cache);
+}
+
+// 実行ファイルのキャッシュを実行するスレッドに結び付ける(NULLなら切り離す)。
+void AttachExecImageCache(ExecImageCache* cache) { execImageCache = cache; }
+
+// 実行ファイルのキャッシュの統計情報を消去する(キャッシュは残す)。
+void ClearExecImageStatistics(void) {
+  execImageHits = 0;
+  execImageMisses = 0;
+}
+
+// 実行ファイルのキャッシュの統計情報を表示する。
+void PrintExecImageStatistics(void) {
+  printFmt("実行ファイルキャッシュ: ヒット %llu回 ミス %llu回\n", execImageHits,
+           execImageMisses);
+}
+
+/*
+ 　機能：プログラムをファイルからメモリに読み込む(fpはクローズされる)
+ 　　　　keyがNULLでなければ、読み込んだメモリイメージをキャッシュに記録する
+ 　　　　(記録した場合はkey->contentsの所有権を引き継ぎ、NULLにする)。
  戻り値：正 = 実行開始アドレス
  　　　　負 = エラーコード
 */
-Long prog_read(FILE* fp, char* fname, Long read_top, Long* prog_sz,
-               Long* prog_sz2, void (*err)(const char*), ExecType execType) {
+static Long readProgramFile(FILE* fp, char* fname, Long read_top,
+                            Long* prog_sz, Long* prog_sz2,
+                            void (*onError)(const char*), ExecType execType,
+                            bool hle, ExecImageKey* key) {
   Long read_sz;
   bool x_file = false;
-  void (*onError)(const char*) = err ? err : onErrorDummy;
 
   if (fseek(fp, 0, SEEK_END) != 0) {
     fclose(fp);
@@ -271,20 +536,10 @@ Long prog_read(FILE* fp, char* fname, Long read_top, Long* prog_sz,
     }
     read_sz -= XHEAD_SIZE;
 
-    int i;
-    if (execType == EXEC_TYPE_R)
-      i = 0; /* Rファイル */
-    else if (execType == EXEC_TYPE_X)
-      i = 1; /* Xファイル */
-    else
-      i = strlen(fname) - 2;
-    if (mem_get(read_top, S_WORD) == 0x4855 && i > 0) {
-      if (execType == EXEC_TYPE_X || strcmp(&(fname[i]), ".x") == 0 ||
-          strcmp(&(fname[i]), ".X") == 0) {
-        x_file = true;
-        memcpy(xhead, read_ptr, XHEAD_SIZE);
-        *prog_sz = read_sz;
-      }
+    if (mem_get(read_top, S_WORD) == 0x4855 && isXFileName(fname, execType)) {
+      x_file = true;
+      memcpy(xhead, read_ptr, XHEAD_SIZE);
+      *prog_sz = read_sz;
     }
     if (!x_file) {
       // R形式実行ファイルなら最初に読み込んだ64バイトはヘッダではないので、
@@ -303,17 +558,64 @@ Long prog_read(FILE* fp, char* fname, Long read_top, Long* prog_sz,
   fclose(fp);
 
   /* Xファイルの処理 */
+  const ULong imageSize = *prog_sz;
+  char* symbols = NULL;
+  ULong symbolsSize = 0;
   Long pc_begin = read_top;
   if (x_file) {
-    pc_begin = xfile_cnv(prog_sz, prog_sz2, read_top, onError);
-    if (pc_begin == 0) return DOSE_ILGFMT;
+    if (key) symbols = copySymbols(read_top, &symbolsSize);
+    pc_begin = xfile_cnv(prog_sz, prog_sz2, read_top, onError, hle);
+    if (pc_begin == 0) {
+      free(symbols);
+      return DOSE_ILGFMT;
+    }
   } else {
     *prog_sz2 = *prog_sz;
   }
 
+  if (key) {
+    storeExecImage(key, read_top, imageSize, x_file, pc_begin, *prog_sz,
+                   *prog_sz2, symbols, symbolsSize);
+    key->contents = NULL;
+  }
   return (pc_begin);
 }
 
+/*
+ 　機能：プログラムをメモリに読み込む(fpはクローズされる)
+ 戻り値：正 = 実行開始アドレス
+ 　　　　負 = エラーコード
+*/
+Long prog_read(FILE* fp, char* fname, Long read_top, Long* prog_sz,
+               Long* prog_sz2, void (*err)(const char*), ExecType execType,
+               bool hle) {
+  void (*onError)(const char*) = err ? err : onErrorDummy;
+
+  ExecImageKey key;
+  if (!getExecImageKey(fp, fname, read_top, *prog_sz2, execType, &key)) {
+    return readProgramFile(fp, fname, read_top, prog_sz, prog_sz2, onError,
+                           execType, hle, NULL);
+  }
+
+  ExecImage* entry = findExecImage(&key);
+  if (entry) {
+    Long pc_begin = loadExecImage(entry, read_top, prog_sz, prog_sz2, hle);
+    if (pc_begin >= 0) {
+      fclose(fp);
+      free(key.contents);
+      entry->lastUsed = ++execImageCache->clock;
+      execImageHits += 1;
+      return pc_begin;
+    }
+  }
+  execImageMisses += 1;
+
+  Long pc_begin = readProgramFile(fp, fname, read_top, prog_sz, prog_sz2,
+                                  onError, execType, hle, &key);
+  free(key.contents);
+  return pc_begin;
+}
+
 /*
  　機能：xheadからロングデータをゲットする
  戻り値：データの値
@@ -0,0 +1,116 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "librun68.h"
+#ifdef RUN68_SERVER
+#include "server.h"
+#endif
+
+// 実行ファイル自身のパス名を絶対パスにする。
+//   -batch、-serverではジョブごとにカレントディレクトリを移動するので、
+//   run68.iniを同じ場所から読み込めるようにしておく。
+static char* getRun68Path(const char* path) {
+#ifdef _WIN32
+  char* fullpath = _fullpath(NULL, path, 0);
+#else
+  char* fullpath = realpath(path, NULL);
+#endif
+  if (fullpath) return fullpath;
+
+  char* copy = malloc(strlen(path) + 1);
+  if (copy) strcpy(copy, path);
+  return copy;
+}
+
+// -batchの-jobs=<n>オプションを解析する。
+//   戻り値は同時に実行するジョブの数(-1 = 不正な指定)。
+static int analyzeJobsOption(const char* arg) {
+  const char* p = strchr(arg, '=');
+  char* endptr = NULL;
+  unsigned long n = p ? strtoul(p + 1, &endptr, 10) : 0;
+  if (endptr && *endptr) n = 0;
+
+  if (1 <= n && n <= MAX_BATCH_JOBS) return (int)n;
+
+  fprintf(stderr, "run68:-jobsは1～%dの範囲で指定する必要があります。\n",
+          MAX_BATCH_JOBS);
+  return -1;
+}
+
+// -batch、-serverを実行する。
+static int runResident(Run68Machine* machine, int argc, char* argv[]) {
+  const char* mode = argv[1];
+  bool batch = strcmp(mode, "-batch") == 0;
+
+  int workers = 0;
+  int arg = 2;
+  const char jobs[] = "-jobs=";
+  if (batch && argc > arg && strncmp(argv[arg], jobs, strlen(jobs)) == 0) {
+    workers = analyzeJobsOption(argv[arg]);
+    if (workers < 0) return EXIT_FAILURE;
+    arg += 1;
+  }
+
+  int rest = argc - arg;
+  if (batch ? (rest != 1 && rest != 2) : (rest != 1)) {
+    fputs(batch ? "Usage: run68 -batch [-jobs=<n>] manifest_filename "
+                  "[summary_filename]\n"
+                : "Usage: run68 -server socket_filename\n",
+          stderr);
+    return EXIT_FAILURE;
+  }
+
+  char* run68Path = getRun68Path(argv[0]);
+  if (!run68Path) return EXIT_FAILURE;
+
+  int ret;
+  if (batch) {
+    ret = RunBatch(machine, run68Path, argv[arg],
+                   (rest == 2) ? argv[arg + 1] : NULL, workers);
+  } else {
+#ifdef RUN68_SERVER
+    ret = RunServer(machine, run68Path, argv[arg]);
+#else
+    fputs("run68:-serverはこの環境では使用できません。\n", stderr);
+    ret = EXIT_FAILURE;
+#endif
+  }
+  free(run68Path);
+  return ret;
+}
+
+int main(int argc, char* argv[]) {
+  Run68Machine* machine = Run68CreateMachine();
+  if (!machine) return EXIT_FAILURE;
+
+  int ret;
+  if (argc >= 2 &&
+      (strcmp(argv[1], "-batch") == 0 || strcmp(argv[1], "-server") == 0)) {
+    ret = runResident(machine, argc, argv);
+  } else {
+    ret = Run68Execute(machine, argc, argv);
+  }
+  Run68DestroyMachine(machine);
+  return ret;
+}
@@ -19,8 +19,10 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "host.h"
 #include "run68.h"
 
 enum {
@@ -31,46 +33,471 @@ enum {
   IOCSROM = 0x00fc0000,
 };
 
-char* mainMemoryPtr;  // 確保したメインメモリの配列
-char* highMemoryPtr;  // 確保したハイメモリの配列
-ULong mainMemoryEnd;  // メインメモリの終端(+1)アドレス、容量に等しい
-ULong highMemoryEnd;  // ハイメモリの終端(+1)アドレス
-ULong supervisorEnd;  // $0～supervisorEndがスーパーバイザ領域
+THREAD_LOCAL char* mainMemoryPtr;  // 確保したメインメモリの配列
+THREAD_LOCAL char* highMemoryPtr;  // 確保したハイメモリの配列
+THREAD_LOCAL ULong mainMemoryEnd;  // メインメモリの終端(+1)、容量に等しい
+THREAD_LOCAL ULong highMemoryEnd;  // ハイメモリの終端(+1)アドレス
+THREAD_LOCAL ULong supervisorEnd;  // $0～supervisorEndがスーパーバイザ領域
+
+THREAD_LOCAL MemoryPage* memoryPages;
+THREAD_LOCAL FetchWindow fetchWindow;
+
+// 書き込まれたページの記録
+//   メモリを確保したまま次の実行に使えるように、物理アドレスのページごとに
+//   最後に初期状態に戻してから書き込まれたかを記録する。
+//   書き込まれていないページはページテーブル上で書き込み不可能にしておき、
+//   最初の書き込みで詳細な判定に回った時に記録して書き込み可能にする。
+//   ページテーブルで判定できる書き込みは記録済みのページだけなので、
+//   通常のメモリアクセスの速度には影響しない。
+#define PHYSICAL_PAGE_COUNT ((HIMEM_ADDRESS_MASK + 1UL) >> MEMORY_PAGE_SHIFT)
+
+static THREAD_LOCAL bool* pageDirty;    // [PHYSICAL_PAGE_COUNT]
+static THREAD_LOCAL ULong* dirtyPages;  // 書き込まれたページの番号
+static THREAD_LOCAL ULong dirtyPageCount;
+
+// 保存したメモリの状態(SaveMachineMemory())
+//   ページごとの内容(NULLなら全て0)と、スーパーバイザ領域。
+static THREAD_LOCAL char** savedPages;  // [PHYSICAL_PAGE_COUNT]
+static THREAD_LOCAL bool memorySaved;
+static THREAD_LOCAL ULong savedSupervisorEnd;
+static THREAD_LOCAL bool allocatedHugePages;
+
+struct MachineMemory {
+  char* mainMemoryPtr;
+  char* highMemoryPtr;
+  ULong mainMemoryEnd;
+  ULong highMemoryEnd;
+  ULong supervisorEnd;
+  MemoryPage* memoryPages;
+  bool* pageDirty;
+  ULong* dirtyPages;
+  ULong dirtyPageCount;
+  char** savedPages;
+  bool memorySaved;
+  ULong savedSupervisorEnd;
+  bool allocatedHugePages;
+};
+
+// ページ全体を同じ条件でアクセス可能にする。
+static MemoryPage mapPage(char* bufptr, ULong start) {
+  return (MemoryPage){bufptr, {start, start, start, start}};
+}
+
+// 物理アドレスのページに対応するホストメモリとアクセス可能な範囲を求める。
+static MemoryPage getPhysicalPage(ULong adr) {
+  ULong end = adr + MEMORY_PAGE_SIZE;
+
+  if (adr < mainMemoryEnd) {
+    if (mainMemoryEnd < end) return mapPage(NULL, MEMORY_PAGE_SIZE);
+
+    MemoryPage page = mapPage(mainMemoryPtr + adr, 0);
+    if (adr < supervisorEnd) {
+      ULong start =
+          (end <= supervisorEnd) ? MEMORY_PAGE_SIZE : supervisorEnd - adr;
+      page.start[PAGE_READ_USER] = start;
+      page.start[PAGE_WRITE_USER] = start;
+    }
+    return page;
+  }
+
+  if (HIMEM_START <= adr && adr < highMemoryEnd) {
+    if (highMemoryEnd < end) return mapPage(NULL, MEMORY_PAGE_SIZE);
+
+    return mapPage(highMemoryPtr + (adr - HIMEM_START), 0);
+  }
+
+  // GVRAM等は実装していない。
+  return mapPage(NULL, MEMORY_PAGE_SIZE);
+}
+
+// ページを書き込み不可能にする(書き込みを記録するため)。
+static void protectPage(MemoryPage* page) {
+  page->start[PAGE_WRITE_SUPER] = MEMORY_PAGE_SIZE;
+  page->start[PAGE_WRITE_USER] = MEMORY_PAGE_SIZE;
+}
+
+// ページテーブルを作り直す。
+//   メモリの確保、スーパーバイザ領域の設定のたびに呼び出す。
+//   ページテーブル上で書き込み可能にするのは、書き込みを記録済みのページの
+//   論理アドレスと物理アドレスが等しい(別名でない)ページだけ。
+static void buildPageTable(void) {
+  for (ULong i = 0; i < MEMORY_PAGE_COUNT; i += 1) {
+    ULong adr = i << MEMORY_PAGE_SHIFT;
+    ULong physAdr = ToPhysicalAddress(adr);
+    memoryPages[i] = getPhysicalPage(physAdr);
+    if (physAdr != adr || !pageDirty[i]) protectPage(&memoryPages[i]);
+  }
+  fetchWindow = (FetchWindow){0, 0, NULL};
+}
+
+// 物理アドレスの範囲に書き込まれたことを記録する。
+static void markDirty(ULong physAdr, ULong len) {
+  if (len == 0) return;
+
+  ULong first = physAdr >> MEMORY_PAGE_SHIFT;
+  ULong last = (physAdr + (len - 1)) >> MEMORY_PAGE_SHIFT;
+  for (ULong i = first; i <= last && i < PHYSICAL_PAGE_COUNT; i += 1) {
+    if (pageDirty[i]) continue;
+
+    pageDirty[i] = true;
+    dirtyPages[dirtyPageCount++] = i;
+    memoryPages[i] = getPhysicalPage(i << MEMORY_PAGE_SHIFT);
+  }
+}
+
+// 物理アドレスのページに対応するホストメモリと、その大きさを得る。
+static char* getPageBuffer(ULong page, ULong* outSize) {
+  ULong adr = page << MEMORY_PAGE_SHIFT;
+  ULong end = 0;
+  char* bufptr = NULL;
+
+  if (adr < mainMemoryEnd) {
+    end = mainMemoryEnd;
+    bufptr = mainMemoryPtr + adr;
+  } else if (HIMEM_START <= adr && adr < highMemoryEnd) {
+    end = highMemoryEnd;
+    bufptr = highMemoryPtr + (adr - HIMEM_START);
+  }
+  *outSize = (end - adr < MEMORY_PAGE_SIZE) ? end - adr : MEMORY_PAGE_SIZE;
+  return bufptr;
+}
+
+// 保存したメモリの状態を破棄する。
+static void discardSavedMemory(void) {
+  for (ULong i = 0; i < PHYSICAL_PAGE_COUNT; i += 1) {
+    free(savedPages[i]);
+    savedPages[i] = NULL;
+  }
+  memorySaved = false;
+}
+
+// 書き込みの記録を消去する。
+static void clearDirtyPages(void) {
+  for (ULong i = 0; i < dirtyPageCount; i += 1) {
+    ULong page = dirtyPages[i];
+    pageDirty[page] = false;
+    protectPage(&memoryPages[page]);
+  }
+  dirtyPageCount = 0;
+  fetchWindow = (FetchWindow){0, 0, NULL};
+}
+
+// 命令フェッチ用のメモリウィンドウに範囲がなかった場合に、
+// 通常の方法で調べ、ウィンドウを指定アドレスのページに移動する。
+Span getFetchMemorySlow(ULong adr, ULong len) {
+  Span mem = GetReadableMemory(adr, len);
+  if (!mem.bufptr) return mem;
+
+  const MemoryPage* page = &memoryPages[adr >> MEMORY_PAGE_SHIFT];
+  ULong start = page->start[PAGE_READ_USER];
+  if (start < MEMORY_PAGE_SIZE) {
+    ULong pageAdr = adr & ~(MEMORY_PAGE_SIZE - 1);
+    fetchWindow = (FetchWindow){pageAdr + start, MEMORY_PAGE_SIZE - start,
+                                page->bufptr + start};
+  }
+  return mem;
+}
+
+// マシンごとのメモリの状態を作成する。
+//   メモリ自体は最初の実行でAllocateMachineMemory()が確保する。
+//   NULLならメモリ不足。
+MachineMemory* CreateMachineMemory(void) {
+  MachineMemory* memory = calloc(1, sizeof(*memory));
+  if (!memory) return NULL;
+
+  memory->memoryPages = calloc(MEMORY_PAGE_COUNT, sizeof(MemoryPage));
+  memory->pageDirty = calloc(PHYSICAL_PAGE_COUNT, sizeof(bool));
+  memory->dirtyPages = calloc(PHYSICAL_PAGE_COUNT, sizeof(ULong));
+  memory->savedPages = calloc(PHYSICAL_PAGE_COUNT, sizeof(char*));
+  if (!memory->memoryPages || !memory->pageDirty || !memory->dirtyPages ||
+      !memory->savedPages) {
+    DestroyMachineMemory(memory);
+    return NULL;
+  }
+  return memory;
+}
+
+// マシンごとのメモリの状態を、確保したメモリとともに破棄する。
+//   実行中でないスレッドから呼び出すこと(スレッドごとの変数を使う)。
+void DestroyMachineMemory(MachineMemory* memory) {
+  if (memory->memoryPages && memory->pageDirty && memory->dirtyPages &&
+      memory->savedPages) {
+    AttachMachineMemory(memory);
+    FreeMachineMemory();
+    DetachMachineMemory(memory);
+  }
+  free(memory->memoryPages);
+  free(memory->pageDirty);
+  free(memory->dirtyPages);
+  free(memory->savedPages);
+  free(memory);
+}
+
+// マシンごとのメモリの状態を、実行するスレッドの変数に読み込む。
+void AttachMachineMemory(const MachineMemory* memory) {
+  mainMemoryPtr = memory->mainMemoryPtr;
+  highMemoryPtr = memory->highMemoryPtr;
+  mainMemoryEnd = memory->mainMemoryEnd;
+  highMemoryEnd = memory->highMemoryEnd;
+  supervisorEnd = memory->supervisorEnd;
+  memoryPages = memory->memoryPages;
+  pageDirty = memory->pageDirty;
+  dirtyPages = memory->dirtyPages;
+  dirtyPageCount = memory->dirtyPageCount;
+  savedPages = memory->savedPages;
+  memorySaved = memory->memorySaved;
+  savedSupervisorEnd = memory->savedSupervisorEnd;
+  allocatedHugePages = memory->allocatedHugePages;
+  fetchWindow = (FetchWindow){0, 0, NULL};
+}
+
+// スレッドの変数からマシンごとのメモリの状態に書き戻す。
+//   スレッドの変数は、他のマシンの状態を参照しないように消去する。
+void DetachMachineMemory(MachineMemory* memory) {
+  memory->mainMemoryPtr = mainMemoryPtr;
+  memory->highMemoryPtr = highMemoryPtr;
+  memory->mainMemoryEnd = mainMemoryEnd;
+  memory->highMemoryEnd = highMemoryEnd;
+  memory->supervisorEnd = supervisorEnd;
+  memory->memoryPages = memoryPages;
+  memory->pageDirty = pageDirty;
+  memory->dirtyPages = dirtyPages;
+  memory->dirtyPageCount = dirtyPageCount;
+  memory->savedPages = savedPages;
+  memory->memorySaved = memorySaved;
+  memory->savedSupervisorEnd = savedSupervisorEnd;
+  memory->allocatedHugePages = allocatedHugePages;
+
+  static const MachineMemory detached;
+  AttachMachineMemory(&detached);
+}
 
 // メインメモリ、ハイメモリを確保する。
 bool AllocateMachineMemory(const Settings* settings, ULong* outHimemAddress) {
+  FreeMachineMemory();
+
   *outHimemAddress = 0;
   highMemoryEnd = 0;
   highMemoryPtr = NULL;
 
+  // 物理メモリはアクセスしたページにだけ割り当てられるので、
+  // 大きなハイメモリを指定しても使わなければ負担にならない。
   mainMemoryEnd = settings->mainMemorySize;
-  mainMemoryPtr = calloc(1, settings->mainMemorySize);
+  mainMemoryPtr =
+      HOST_ALLOCATE_MEMORY(settings->mainMemorySize, settings->hugePages);
 
   ULong himemSize = settings->highMemorySize;
   if (himemSize) {
     *outHimemAddress = HIMEM_START;
     highMemoryEnd = HIMEM_START + himemSize;
-    highMemoryPtr = calloc(1, himemSize);
+    highMemoryPtr = HOST_ALLOCATE_MEMORY(himemSize, settings->hugePages);
   }
 
+  allocatedHugePages = settings->hugePages;
+
   if (!mainMemoryPtr || (himemSize && !highMemoryPtr)) {
     FreeMachineMemory();
     return false;
   }
+  buildPageTable();
   return true;
 }
 
 // メインメモリ、ハイメモリを解放する。
 void FreeMachineMemory(void) {
-  free(mainMemoryPtr);
+  discardSavedMemory();
+  for (ULong i = 0; i < dirtyPageCount; i += 1) {
+    pageDirty[dirtyPages[i]] = false;
+  }
+  dirtyPageCount = 0;
+
+  HOST_FREE_MEMORY(mainMemoryPtr, mainMemoryEnd);
   mainMemoryPtr = NULL;
 
-  free(highMemoryPtr);
+  if (highMemoryEnd) {
+    HOST_FREE_MEMORY(highMemoryPtr, highMemoryEnd - HIMEM_START);
+  }
   highMemoryPtr = NULL;
+
+  mainMemoryEnd = 0;
+  highMemoryEnd = 0;
+  buildPageTable();
+}
+
+// 現在のメモリの状態を保存する。
+//   確保直後からの書き込みを記録したページだけを保存し、
+//   以後はここからの書き込みを記録する。
+bool SaveMachineMemory(void) {
+  discardSavedMemory();
+
+  for (ULong i = 0; i < dirtyPageCount; i += 1) {
+    ULong page = dirtyPages[i];
+    ULong size;
+    char* bufptr = getPageBuffer(page, &size);
+    if (!bufptr) continue;
+
+    char* copy = malloc(size);
+    if (!copy) {
+      discardSavedMemory();
+      return false;
+    }
+    memcpy(copy, bufptr, size);
+    savedPages[page] = copy;
+  }
+
+  clearDirtyPages();
+  savedSupervisorEnd = supervisorEnd;
+  memorySaved = true;
+  return true;
+}
+
+/*
+   機能：
+     確保済みのメモリを、SaveMachineMemory()で保存した状態に戻す
+     保存後に書き込まれたページだけを書き戻すので、メモリを確保し直して
+     初期化するより速い。
+   パラメータ：
+     const Settings*  settings         <in>   メモリの容量などの設定
+     ULong*           outHimemAddress  <out>  ハイメモリの先頭アドレス
+   戻り値：
+     true = 元に戻した
+     false = 保存した状態がないか、設定が異なるため戻せない
+*/
+bool RestoreMachineMemory(const Settings* settings, ULong* outHimemAddress) {
+  if (!memorySaved || mainMemoryEnd != settings->mainMemorySize ||
+      (highMemoryEnd ? highMemoryEnd - HIMEM_START : 0) !=
+          settings->highMemorySize ||
+      allocatedHugePages != settings->hugePages) {
+    return false;
+  }
+
+  for (ULong i = 0; i < dirtyPageCount; i += 1) {
+    ULong page = dirtyPages[i];
+    ULong size;
+    char* bufptr = getPageBuffer(page, &size);
+    if (!bufptr) continue;
+
+    if (savedPages[page]) {
+      memcpy(bufptr, savedPages[page], size);
+    } else {
+      memset(bufptr, 0, size);
+    }
+  }
+  clearDirtyPages();
+
+  if (supervisorEnd != savedSupervisorEnd) {
+    SetSupervisorArea(savedSupervisorEnd);
+  }
+  *outHimemAddress = highMemoryEnd ? HIMEM_START : 0;
+  return true;
+}
+
+// 内容が全て0か調べる。
+static bool isZeroFilled(const char* p, ULong size) {
+  return p[0] == 0 && memcmp(p, p + 1, size - 1) == 0;
+}
+
+// メモリ領域をファイルのoffsetの位置に書き込む。
+//   内容が全て0のページは書き込まずに飛ばすので、ファイルシステムが
+//   対応していればスパースファイルになる。
+static bool writeMemoryArea(FILE* fp, long offset, const char* ptr,
+                            ULong size) {
+  for (ULong pos = 0; pos < size; pos += MEMORY_PAGE_SIZE) {
+    ULong len = (size - pos < MEMORY_PAGE_SIZE) ? size - pos : MEMORY_PAGE_SIZE;
+    if (isZeroFilled(ptr + pos, len)) continue;
+
+    if (fseek(fp, offset + (long)pos, SEEK_SET) != 0) return false;
+    if (fwrite(ptr + pos, 1, len, fp) != len) return false;
+  }
+
+  // 末尾のページを飛ばした場合でもファイルの大きさを揃えるため、
+  // 最後の1バイトは必ず書き込む
+  if (fseek(fp, offset + (long)size - 1, SEEK_SET) != 0) return false;
+  return fputc((UByte)ptr[size - 1], fp) != EOF;
+}
+
+// メモリの内容をファイルに書き込む。
+//   offsetの位置からメインメモリ、ハイメモリの順に容量のまま書き込む。
+bool WriteMemoryImage(FILE* fp, long offset) {
+  if (!writeMemoryArea(fp, offset, mainMemoryPtr, mainMemoryEnd)) return false;
+  if (!highMemoryEnd) return true;
+
+  return writeMemoryArea(fp, offset + (long)mainMemoryEnd, highMemoryPtr,
+                         highMemoryEnd - HIMEM_START);
+}
+
+// WriteMemoryImage()で書き込んだ内容を確保済みのメモリに読み込む。
+//   メモリの容量は書き込んだ時と同じであること。
+//   SaveMachineMemory()で保存した状態には戻せなくなるので、
+//   次の実行ではメモリを確保し直す。
+bool ReadMemoryImage(FILE* fp, long offset) {
+  discardSavedMemory();
+
+  if (!HOST_MAP_MEMORY_IMAGE(mainMemoryPtr, mainMemoryEnd, fp, offset)) {
+    return false;
+  }
+  if (!highMemoryEnd) return true;
+
+  return HOST_MAP_MEMORY_IMAGE(highMemoryPtr, highMemoryEnd - HIMEM_START, fp,
+                               offset + (long)mainMemoryEnd);
 }
 
 // メインメモリをスーパーバイザ領域として設定する。
-void SetSupervisorArea(ULong adr) { supervisorEnd = adr; }
+void SetSupervisorArea(ULong adr) {
+  supervisorEnd = adr;
+  buildPageTable();
+}
+
+// 指定したメモリ範囲がアクセス可能か調べ、バッファアドレスを返す。
+static Span getAccessibleMemorySpan(ULong adr, ULong len, bool super) {
+  adr = ToPhysicalAddress(adr);
+  ULong end = mainMemoryEnd;
+
+  if (adr < end) {
+    // 開始アドレスはメインメモリ内。
+    if (!super && adr < supervisorEnd) {
+      // ユーザーモードでスーパーバイザ領域をアクセスしようとした。
+      return (Span){NULL, 0};
+    }
+    ULong max = end - adr;  // 開始アドレスからメモリが実装されている長さ
+    if (max < len) {
+      // 指定範囲の途中までアクセス可能。
+      return (Span){NULL, max};
+    }
+    // 指定範囲はすべてアクセス可能。
+    return (Span){mainMemoryPtr + adr, len};
+  }
+
+  if (adr < HIMEM_START) {
+    // メインメモリ未搭載領域と、$00c00000-$00ffffffはすべてアクセス不可能。
+    // 実機の仕様としてはGVRAM等は読み書きできるが、run68では実装していない。
+    return (Span){NULL, 0};
+  }
+
+  end = highMemoryEnd;
+  if (adr < end) {
+    // 開始アドレスはハイメモリ内。
+    ULong max = end - adr;
+    if (max < len) {
+      return (Span){NULL, max};
+    }
+    return (Span){highMemoryPtr + (adr - HIMEM_START), len};
+  }
+
+  // ハイメモリ未搭載領域(実機と異なると思われるが、とりあえず仕様とする)
+  return (Span){NULL, 0};
+}
+
+// 指定したメモリ範囲がアクセス可能か調べ、バッファアドレスを返す。
+//   ページテーブルで判定できなかった場合に呼ばれる。
+//   アクセス可能かどうかは読み書きを区別しないが、書き込みなら記録する。
+Span getAccessibleMemorySlow(ULong adr, ULong len, int kind) {
+  Span mem = getAccessibleMemorySpan(adr, len, kind < PAGE_READ_USER);
+  if (kind == PAGE_WRITE_SUPER || kind == PAGE_WRITE_USER) {
+    markDirty(ToPhysicalAddress(adr), mem.bufptr ? len : mem.length);
+  }
+  return mem;
+}
 
 // アクセス可能なメモリ範囲を調べる。
 //   指定範囲の先頭部分がアクセス可能ならtrueを返す。
@@ -123,6 +550,22 @@ bool getAccessibleMemoryRange(ULong adr, ULong len, bool super, Span* result) {
   return false;
 }
 
+// 書き込み可能なメモリ範囲を調べる。
+//   戻り値はgetAccessibleMemoryRange()と同じで、範囲への書き込みを記録する。
+bool getWritableMemoryRange(ULong adr, ULong len, bool super, Span* result) {
+  if (!getAccessibleMemoryRange(adr, len, super, result)) return false;
+
+  markDirty(ToPhysicalAddress(adr), result->length);
+  return true;
+}
+
+// ホスト側から直接書き込んだメモリ範囲を記録する。
+//   書き込むバイト数が事前にわからない処理で、バッファ全体ではなく
+//   実際に書き込んだ範囲だけを記録するために使う。
+void MarkMemoryWritten(ULong adr, ULong len) {
+  markDirty(ToPhysicalAddress(adr), len);
+}
+
 // 文字列(ASCIIZ)として読み込み可能なメモリか調べ、バッファへのポインタを返す。
 //   読み込み不可能ならエラー終了する。
 char* GetStringSuper(ULong adr) {
@@ -138,6 +581,14 @@ char* GetStringSuper(ULong adr) {
   throwBusError(adr + mem.length, false);
 }
 
+// 書き換える文字列(ASCIIZ)のバッファへのポインタを返す。
+//   文字列の長さを超えて書き込まないこと。
+char* GetWritableStringSuper(ULong adr) {
+  char* s = GetStringSuper(adr);
+  markDirty(ToPhysicalAddress(adr), (ULong)strlen(s) + 1);
+  return s;
+}
+
 // メモリに文字列(ASCIIZ)を書き込む。
 //   書き込み不可能ならエラー終了する。
 void WriteStringSuper(ULong adr, const char* s) {
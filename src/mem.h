@@ -30,14 +30,29 @@ typedef struct {
   ULong length;
 } Span;
 
-extern char* mainMemoryPtr;
-extern char* highMemoryPtr;
-extern ULong mainMemoryEnd;
-extern ULong highMemoryEnd;
-extern ULong supervisorEnd;
+extern THREAD_LOCAL char* mainMemoryPtr;
+extern THREAD_LOCAL char* highMemoryPtr;
+extern THREAD_LOCAL ULong mainMemoryEnd;
+extern THREAD_LOCAL ULong highMemoryEnd;
+extern THREAD_LOCAL ULong supervisorEnd;
+
+// マシンごとのメモリの状態
+//   確保したメモリ、ページテーブル、書き込みの記録、保存した状態を持つ。
+//   実行中はAttachMachineMemory()でスレッドごとの変数に読み込んで使い、
+//   終了後にDetachMachineMemory()で書き戻す。
+typedef struct MachineMemory MachineMemory;
+
+MachineMemory* CreateMachineMemory(void);
+void DestroyMachineMemory(MachineMemory* memory);
+void AttachMachineMemory(const MachineMemory* memory);
+void DetachMachineMemory(MachineMemory* memory);
 
 bool AllocateMachineMemory(const Settings* settings, ULong* outHimemAddress);
 void FreeMachineMemory(void);
+bool SaveMachineMemory(void);
+bool RestoreMachineMemory(const Settings* settings, ULong* outHimemAddress);
+bool WriteMemoryImage(FILE* fp, long offset);
+bool ReadMemoryImage(FILE* fp, long offset);
 
 void SetSupervisorArea(ULong adr);
 
@@ -53,64 +68,96 @@ static inline ULong ToPhysicalAddress(ULong adr) {
   return adr & ADDRESS_MASK;
 }
 
-// 指定したメモリ範囲がアクセス可能か調べ、バッファアドレスを返す。
-//   アクセス不可能なら(Span){NULL, (先頭からのアクセス可能なバイト数)}を返す。
-//   現在のところ読み書きを区別しない。
-static inline Span getAccessibleMemory(ULong adr, ULong len, bool super) {
-  adr = ToPhysicalAddress(adr);
-  ULong end = mainMemoryEnd;
-
-  if (adr < end) {
-    // 開始アドレスはメインメモリ内。
-    if (!super && adr < supervisorEnd) {
-      // ユーザーモードでスーパーバイザ領域をアクセスしようとした。
-      return (Span){NULL, 0};
-    }
-    ULong max = end - adr;  // 開始アドレスからメモリが実装されている長さ
-    if (max < len) {
-      // 指定範囲の途中までアクセス可能。
-      return (Span){NULL, max};
-    }
-    // 指定範囲はすべてアクセス可能。
-    return (Span){mainMemoryPtr + adr, len};
-  }
+// ページテーブル
+//   論理アドレス空間(4GB)を64KB単位のページに分け、ページごとに対応する
+//   ホストメモリのアドレスとアクセス権を記録する。
+//   GVRAM等の領域を実装する場合も、ページを割り当てるだけで済む。
+#define MEMORY_PAGE_SHIFT 16
+#define MEMORY_PAGE_SIZE (1UL << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_COUNT (1UL << (32 - MEMORY_PAGE_SHIFT))
+
+// アクセスの種類
+enum {
+  PAGE_READ_SUPER,   // スーパーバイザモードで読み込み
+  PAGE_WRITE_SUPER,  // スーパーバイザモードで書き込み
+  PAGE_READ_USER,    // ユーザーモードで読み込み
+  PAGE_WRITE_USER,   // ユーザーモードで書き込み
+  PAGE_ACCESS_KINDS
+};
+
+// メモリ終端を含むページはアクセス不可能として、詳細な判定に任せる。
+typedef struct {
+  char* bufptr;  // ページ先頭に対応するホストメモリのアドレス
 
-  if (adr < HIMEM_START) {
-    // メインメモリ未搭載領域と、$00c00000-$00ffffffはすべてアクセス不可能。
-    // 実機の仕様としてはGVRAM等は読み書きできるが、run68では実装していない。
-    return (Span){NULL, 0};
-  }
+  // アクセス可能なページ内の開始位置
+  //   0ならページ全体、MEMORY_PAGE_SIZEならページ全体がアクセス不可能。
+  //   スーパーバイザ領域の境界を含むページではユーザーモードの値が境界になる。
+  ULong start[PAGE_ACCESS_KINDS];
+} MemoryPage;
 
-  end = highMemoryEnd;
-  if (adr < end) {
-    // 開始アドレスはハイメモリ内。
-    ULong max = end - adr;
-    if (max < len) {
-      return (Span){NULL, max};
-    }
-    return (Span){highMemoryPtr + (adr - HIMEM_START), len};
+extern THREAD_LOCAL MemoryPage* memoryPages;  // [MEMORY_PAGE_COUNT]
+
+Span getAccessibleMemorySlow(ULong adr, ULong len, int kind);
+
+// 指定したメモリ範囲がアクセス可能か調べ、バッファアドレスを返す。
+//   アクセス不可能なら(Span){NULL, (先頭からのアクセス可能なバイト数)}を返す。
+//   kind ... アクセスの種類(PAGE_*)
+static inline Span getAccessibleMemory(ULong adr, ULong len, int kind) {
+  const MemoryPage* page = &memoryPages[adr >> MEMORY_PAGE_SHIFT];
+  ULong offset = adr & (MEMORY_PAGE_SIZE - 1);
+
+  // ほとんどのアクセスはページ内に収まるので、ページテーブルだけで判定する。
+  if (page->start[kind] <= offset && len <= MEMORY_PAGE_SIZE - offset) {
+    return (Span){page->bufptr + offset, len};
   }
+  return getAccessibleMemorySlow(adr, len, kind);
+}
 
-  // ハイメモリ未搭載領域(実機と異なると思われるが、とりあえず仕様とする)
-  return (Span){NULL, 0};
+static inline int getUserAccessKind(void) {
+  return SR_S_REF() ? 0 : PAGE_READ_USER;
 }
 
 static inline Span GetReadableMemorySuper(ULong adr, ULong len) {
-  return getAccessibleMemory(adr, len, true);
+  return getAccessibleMemory(adr, len, PAGE_READ_SUPER);
 }
 static inline Span GetWritableMemorySuper(ULong adr, ULong len) {
-  return getAccessibleMemory(adr, len, true);
+  return getAccessibleMemory(adr, len, PAGE_WRITE_SUPER);
 }
 static inline Span GetReadableMemory(ULong adr, ULong len) {
-  bool super = SR_S_REF() ? true : false;
-  return getAccessibleMemory(adr, len, super);
+  return getAccessibleMemory(adr, len, PAGE_READ_SUPER + getUserAccessKind());
 }
 static inline Span GetWritableMemory(ULong adr, ULong len) {
-  bool super = SR_S_REF() ? true : false;
-  return getAccessibleMemory(adr, len, super);
+  return getAccessibleMemory(adr, len, PAGE_WRITE_SUPER + getUserAccessKind());
+}
+
+// 命令フェッチ用のメモリウィンドウ
+//   PCの指すページのうちユーザーモードでも読み込み可能な範囲を記録して、
+//   拡張ワードの読み込みではページテーブルの参照も省略する。
+//   スーパーバイザモードでもそのまま使える。
+typedef struct {
+  ULong start;   // 先頭アドレス
+  ULong size;    // 大きさ(0なら無効)
+  char* bufptr;  // 先頭アドレスに対応するホストメモリのアドレス
+} FetchWindow;
+
+extern THREAD_LOCAL FetchWindow fetchWindow;
+
+Span getFetchMemorySlow(ULong adr, ULong len);
+
+// 命令のあるメモリ範囲が読み込み可能か調べ、バッファアドレスを返す。
+//   戻り値はGetReadableMemory()と同じ。
+static inline Span GetFetchMemory(ULong adr, ULong len) {
+  ULong offset = adr - fetchWindow.start;
+
+  if (offset < fetchWindow.size && len <= fetchWindow.size - offset) {
+    return (Span){fetchWindow.bufptr + offset, len};
+  }
+  return getFetchMemorySlow(adr, len);
 }
 
 bool getAccessibleMemoryRange(ULong adr, ULong len, bool super, Span* result);
+bool getWritableMemoryRange(ULong adr, ULong len, bool super, Span* result);
+void MarkMemoryWritten(ULong adr, ULong len);
 
 static inline bool GetReadableMemoryRangeSuper(ULong adr, ULong len,
                                                Span* result) {
@@ -118,10 +165,11 @@ static inline bool GetReadableMemoryRangeSuper(ULong adr, ULong len,
 }
 static inline bool GetWritableMemoryRangeSuper(ULong adr, ULong len,
                                                Span* result) {
-  return getAccessibleMemoryRange(adr, len, true, result);
+  return getWritableMemoryRange(adr, len, true, result);
 }
 
 char* GetStringSuper(ULong adr);
+char* GetWritableStringSuper(ULong adr);
 void WriteStringSuper(ULong adr, const char* s);
 
 NORETURN void throwBusError(ULong adr, bool onWrite);
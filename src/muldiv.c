@@ -0,0 +1,44 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include "muldiv.h"
+
+#include <string.h>
+
+#include "run68.h"
+
+// 乗除算命令とFEFUNCの整数除算は、除算の中心部分(DivideUnsigned()、
+// DivideSigned())を共有して同じ結果になるようにしている。
+
+THREAD_LOCAL unsigned long long mulDivCounts[MULDIV_COUNTERS];
+
+// 乗除算の実行回数を消去する。
+void ClearMulDivStatistics(void) {
+  memset(mulDivCounts, 0, sizeof(mulDivCounts));
+}
+
+// 乗除算の実行回数を表示する。
+void PrintMulDivStatistics(void) {
+  static const char* const names[MULDIV_COUNTERS] = {
+      "mulu", "muls", "divu", "divs", "div overflow", "fefunc div",
+  };
+
+  for (int i = 0; i < MULDIV_COUNTERS; i += 1) {
+    printFmt("乗除算 %-12s: %llu\n", names[i], mulDivCounts[i]);
+  }
+}
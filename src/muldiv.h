@@ -0,0 +1,59 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#ifndef MULDIV_H
+#define MULDIV_H
+
+#include "run68.h"
+
+// 乗除算の実行回数(-stat)
+typedef enum {
+  MULDIV_MULU,
+  MULDIV_MULS,
+  MULDIV_DIVU,
+  MULDIV_DIVS,
+  MULDIV_DIV_OVERFLOW,  // divu、divsの商が16ビットに収まらなかった回数
+  MULDIV_FEFUNC_DIV,    // FEFUNCの整数除算
+  MULDIV_COUNTERS,
+} MulDivCounter;
+
+extern THREAD_LOCAL unsigned long long mulDivCounts[MULDIV_COUNTERS];
+
+void ClearMulDivStatistics(void);
+void PrintMulDivStatistics(void);
+
+// 32ビットの符号なし除算を行う(除数は0以外であること)。
+static inline ULong DivideUnsigned(ULong dividend, ULong divisor,
+                                   ULong* remainder) {
+  *remainder = dividend % divisor;
+  return dividend / divisor;
+}
+
+// 32ビットの符号付き除算を行う(除数は0以外であること)。
+//   商は0方向に切り捨て、剰余の符号は被除数と同じになる。
+//   -2147483648 / -1 はホストでは例外になるので、商は桁あふれした値を返す。
+static inline Long DivideSigned(Long dividend, Long divisor, Long* remainder) {
+  if (divisor == -1) {
+    *remainder = 0;
+    return (Long)(0 - (ULong)dividend);
+  }
+  *remainder = dividend % divisor;
+  return dividend / divisor;
+}
+
+#endif
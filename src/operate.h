@@ -22,8 +22,8 @@
 #include "run68.h"
 
 static inline Word imi_get_word(void) {
-  Span mem = GetReadableMemory(pc, 2);
-  pc += 2;
+  Span mem = GetFetchMemory(cpu.pc, 2);
+  cpu.pc += 2;
   return mem.bufptr ? PeekW(mem.bufptr) : 0;
 }
 
@@ -31,10 +31,10 @@ static inline Word imi_get_word(void) {
 //   サイズに応じてpcを進める。
 static inline Long imi_get(char size) {
   ULong len = (size == S_LONG) ? 4 : 2;
-  Span mem = GetReadableMemory(pc, len);
-  if (!mem.bufptr) throwBusErrorOnRead(pc + mem.length);
+  Span mem = GetFetchMemory(cpu.pc, len);
+  if (!mem.bufptr) throwBusErrorOnRead(cpu.pc + mem.length);
 
-  pc += len;
+  cpu.pc += len;
   switch (size) {
     case S_BYTE:
       return PeekB(mem.bufptr + 1);  // 1ワード中の下位バイトが実データ。
@@ -82,13 +82,13 @@ static inline void mem_set(ULong adr, Long d, char size) {
 static inline void SetDreg(int regno, ULong n, int size) {
   switch (size) {
     case S_BYTE:
-      rd[regno] = (rd[regno] & 0xffffff00) | (n & 0xff);
+      cpu.rd[regno] = (cpu.rd[regno] & 0xffffff00) | (n & 0xff);
       break;
     case S_WORD:
-      rd[regno] = (rd[regno] & 0xffff0000) | (n & 0xffff);
+      cpu.rd[regno] = (cpu.rd[regno] & 0xffff0000) | (n & 0xffff);
       break;
     default:  // S_LONG
-      rd[regno] = n;
+      cpu.rd[regno] = n;
       break;
   }
 }
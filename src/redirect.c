@@ -0,0 +1,70 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include "redirect.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+   機能：
+     標準入出力のファイルディスクリプタを別のファイルに付け替える
+   パラメータ：
+     FILE*  stream  <in>  stdin、stdout、stderr
+     int    fd      <in>  付け替え先のファイルディスクリプタ(呼び出し側で閉じる)
+   戻り値：
+     元のファイルディスクリプタの複製(-1 = 失敗)
+*/
+int RedirectStream(FILE* stream, int fd) {
+  fflush(stream);
+
+  int target = fileno(stream);
+  int saved = dup(target);
+  if (saved < 0) return -1;
+  if (dup2(fd, target) < 0) {
+    close(saved);
+    return -1;
+  }
+  clearerr(stream);
+  return saved;
+}
+
+/*
+   機能：
+     付け替えた標準入出力を元に戻す
+     入力側はバッファに残ったデータを後で読まないようにfflush()で捨てる
+     (glibc、MSVCの動作に依存している)。
+   パラメータ：
+     FILE*  stream  <in>  stdin、stdout、stderr
+     int    saved   <in>  RedirectStream()の戻り値(-1なら何もしない)
+   戻り値：
+     なし
+*/
+void RestoreStream(FILE* stream, int saved) {
+  if (saved < 0) return;
+
+  fflush(stream);
+  dup2(saved, fileno(stream));
+  close(saved);
+  clearerr(stream);
+}
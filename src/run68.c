@@ -24,38 +24,46 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "blockcache.h"
+#include "checkpoint.h"
 #include "dos_file.h"
 #include "dos_memory.h"
+#include "fusion.h"
+#include "hle.h"
 #include "host.h"
 #include "human68k.h"
 #include "hupair.h"
+#include "librun68.h"
 #include "mem.h"
+#include "muldiv.h"
 #include "operate.h"
 #include "version.h"
 
-ULong DefaultExceptionHandler[256];
+THREAD_LOCAL ULong DefaultExceptionHandler[256];
 
-EXEC_INSTRUCTION_INFO OP_info;
-FILEINFO finfo[FILE_MAX];
+THREAD_LOCAL EXEC_INSTRUCTION_INFO OP_info;
+THREAD_LOCAL FILEINFO finfo[FILE_MAX];
 const char size_char[3] = {'b', 'w', 'l'};
-Long ra[8];
-Long rd[8];
-Long usp;
-Long pc;
-UWord sr;
-Long superjsr_ret;
-Long psp[NEST_MAX];
-Long nest_pc[NEST_MAX];
-Long nest_sp[NEST_MAX];
-unsigned int nest_cnt;
-jmp_buf jmp_when_abort;
-UWord cwatchpoint = 0x4afc;
-
-static bool debug_flag = false;
-
-static char ini_file_name[MAX_PATH];
-
-Settings settings;
+THREAD_LOCAL Cpu cpu;
+THREAD_LOCAL Long superjsr_ret;
+THREAD_LOCAL Long psp[NEST_MAX];
+THREAD_LOCAL Long nest_pc[NEST_MAX];
+THREAD_LOCAL Long nest_sp[NEST_MAX];
+THREAD_LOCAL unsigned int nest_cnt;
+THREAD_LOCAL jmp_buf jmp_when_abort;
+THREAD_LOCAL UWord cwatchpoint = 0x4afc;
+
+static THREAD_LOCAL bool debug_flag = false;
+static THREAD_LOCAL bool cont_flag = true;  // exec_notrap()の実行を継続する
+static THREAD_LOCAL bool running = true;    // プログラムが終了していない
+
+static THREAD_LOCAL char ini_file_name[MAX_PATH];
+
+// コマンドラインで指定したプログラムの範囲(チェックポイントに保存する)
+static THREAD_LOCAL ULong mainProgramSize;
+static THREAD_LOCAL ULong mainProgramEntry;
+
+THREAD_LOCAL Settings settings;
 static const Settings defaultSettings = {
     DEFAULT_MAIN_MEMORY_SIZE,  // mainMemorySize
     DEFAULT_HIGH_MEMORY_SIZE,  // highMemorySize
@@ -64,8 +72,15 @@ static const Settings defaultSettings = {
     false,  // traceFunc
     false,  // debug
     false,  // readFileUtf8
+    false,  // statistics
+    false,  // hle
 
-    false  // iothrough
+    0,     // checkpointPc
+    NULL,  // checkpointFile
+    NULL,  // restoreFile
+
+    false,  // iothrough
+    false   // hugePages
 };
 
 static void print_title(void) {
@@ -85,11 +100,18 @@ static void print_title(void) {
 static void print_usage(void) {
   const char* usage =
       "Usage: run68 [options] execute_filename [commandline]\n"
+      "       run68 -batch manifest_filename [summary_filename]\n"
+      "       run68 -server socket_filename\n"
+      "  -mem=<mb>    main memory size (1-12)\n"
       "  -himem=<mb>  allocate high memory\n"
       "  -f           function call trace\n"
       "  -tr <adr>    mpu instruction trap\n"
       "  -debug       run with debugger\n"
-      "  -read-file-utf8  convert file encoding from UTF-8 on read\n";
+      "  -read-file-utf8  convert file encoding from UTF-8 on read\n"
+      "  -stat        print statistics on exit\n"
+      "  -hle         run known library routines natively\n"
+      "  -checkpoint-at=<adr>,<file>  save machine state when pc reaches adr\n"
+      "  -restore=<file>  resume from checkpoint with new commandline\n";
   print(usage);
 }
 
@@ -133,6 +155,41 @@ static void trap_table_make(void) {
   WriteUWordSuper(0x972, 24);  // 画面の行数-1
 }
 
+// デバッガ等による命令ごとの確認が不要か調べる。
+static bool canRunFast(void) {
+  return !settings.debug && stepcount == 0 && settings.trapPc == 0 &&
+         cwatchpoint == 0x4afc && superjsr_ret == 0 &&
+         settings.checkpointPc == 0;
+}
+
+/*
+   機能：
+     命令ごとの確認をせずに実行する(ブレークポイント等を使っていない場合用)
+   戻り値：
+     true = 実行終了
+     false = 命令ごとの確認が必要になった
+*/
+static bool runFast(void) {
+  bool finished;
+  fusionEnabled = true;
+
+  for (;;) {
+    if (cpu.pc & 1) {
+      err68b("アドレスエラーが発生しました", cpu.pc, OPBuf_getentry(0)->pc);
+    }
+    OP_info.pc = cpu.pc;
+    finished = prog_exec();
+    OPBuf_insert(&OP_info);
+    if (finished) break;
+
+    // DOS _SUPER_JSRからの復帰を確認する必要がある
+    if (superjsr_ret != 0) break;
+  }
+
+  fusionEnabled = false;
+  return finished;
+}
+
 /*
    機能：
      割り込みをエミュレートせずに実行する
@@ -140,33 +197,43 @@ static void trap_table_make(void) {
      終了コード
 */
 static int exec_notrap(bool* restart) {
-  static bool cont_flag = true;
-  static bool running = true;
-
   *restart = false;
   OPBuf_clear();
+
+  // アボート処理からの戻り先は命令ごとではなく、ここで一度だけ設定する。
+  // アボートした場合はデバッガを起動して実行を継続する。
+  if (setjmp(jmp_when_abort) != 0) {
+    fusionEnabled = false;
+    settings.debug = true;
+  }
+
   do {
-    /* 実行した命令の情報を保存しておく */
-    OP_info.pc = 0;
-    OP_info.rmem = 0;
-    OP_info.rsize = 'N';
-    OP_info.wmem = 0;
-    OP_info.wsize = 'N';
-    OP_info.mnemonic[0] = 0;
-    if (superjsr_ret == pc) {
+    if (canRunFast()) {
+      if (!runFast()) continue;
+      goto ProgramEnd;
+    }
+
+    if (superjsr_ret == cpu.pc) {
       SR_S_OFF();
       superjsr_ret = 0;
     }
-    if (settings.trapPc != 0 && (ULong)pc == settings.trapPc) {
+    if (settings.checkpointPc != 0 &&
+        (ULong)cpu.pc == settings.checkpointPc) {
+      // 作成するのは最初に到達した時だけ
+      WriteCheckpoint(settings.checkpointFile, mainProgramSize,
+                      mainProgramEntry);
+      settings.checkpointPc = 0;
+    }
+    if (settings.trapPc != 0 && (ULong)cpu.pc == settings.trapPc) {
       printFmt("(run68) breakpoint:MPUがアドレス$%08xの命令を実行しました。\n",
-               pc);
+               cpu.pc);
       settings.debug = true;
       if (stepcount != 0) {
         printFmt("(run68) breakpoint:%d counts left.\n", stepcount);
         stepcount = 0;
       }
     } else if (cwatchpoint != 0x4afc) {
-      Span mem = GetReadableMemorySuper(pc, 2);
+      Span mem = GetReadableMemorySuper(cpu.pc, 2);
       if (mem.bufptr && cwatchpoint == PeekW(mem.bufptr)) {
         printFmt("(run68) watchpoint:MPUが命令$%04xを実行しました。\n",
                  cwatchpoint);
@@ -203,29 +270,27 @@ static int exec_notrap(bool* restart) {
         settings.debug = true;
       }
     }
-    if (pc & 1) {
-      err68b("アドレスエラーが発生しました", pc, OPBuf_getentry(0)->pc);
+    if (cpu.pc & 1) {
+      err68b("アドレスエラーが発生しました", cpu.pc, OPBuf_getentry(0)->pc);
       break;
     }
   NextInstruction:
     /* PCの値を保存する */
-    OP_info.pc = pc;
-    if (setjmp(jmp_when_abort) != 0) {
+    OP_info.pc = cpu.pc;
+    bool finished = prog_exec();
+    OPBuf_insert(&OP_info);
+    if (!finished) continue;
+
+  ProgramEnd:
+    running = false;
+    if (debug_flag) {
       settings.debug = true;
-      continue;
-    }
-    if (prog_exec()) {
-      running = false;
-      if (debug_flag) {
-        settings.debug = true;
-      } else {
-        cont_flag = false;
-      }
+    } else {
+      cont_flag = false;
     }
-    OPBuf_insert(&OP_info);
   } while (cont_flag);
 EndOfFunc:
-  return rd[0];
+  return cpu.rd[0];
 }
 
 static void init_fileinfo(int fileno, FileOpenMode mode) {
@@ -244,6 +309,57 @@ static void init_all_fileinfo(void) {
   }
 }
 
+// エミュレータの実行単位
+//   実行していない間も保持する状態を持つ。実行中の状態はスレッドごとの
+//   変数にあり、Run68Execute()の開始時に初期化する。
+struct Run68Machine {
+  Settings settings;  // 実行開始時の設定(コマンドラインのオプションで変更する)
+  const char* const* environment;  // 追加する環境変数(NULL = なし)
+
+  MachineMemory* memory;  // メモリとその初期状態
+  BlockCache* blockCache;
+  ExecImageCache* execImageCache;
+  Human68kHostState human68k;  // 保存したメモリの状態に対応するホスト側の状態
+  bool running;  // 実行中(同じマシンを同時に2つのスレッドで実行できない)
+};
+
+// このスレッドで実行中のマシン
+static THREAD_LOCAL Run68Machine* activeMachine;
+
+// 環境変数の領域に変数を設定する。
+//   同じ名前の変数があれば削除してから末尾に追加する。
+static void setEnvironmentVariable(ULong envbuf, const char* var) {
+  const char* eq = strchr(var, '=');
+  if (!eq || eq == var) return;
+  size_t nameLen = (size_t)(eq - var) + 1;  // '='を含む
+
+  const ULong envSize = ReadULongSuper(envbuf);
+  Span mem = GetWritableMemorySuper(envbuf + 4, envSize - 4);
+  if (!mem.bufptr || mem.length < 1) return;
+  char* top = mem.bufptr;
+
+  // 変数の並びの末尾は空文字列
+  char* p = top;
+  while (*p) {
+    size_t len = strlen(p) + 1;
+    if (strncmp(p, var, nameLen) == 0) {
+      char* next = p + len;
+      size_t rest = 1;  // 末尾の空文字列
+      for (char* q = next; *q; q += strlen(q) + 1) rest += strlen(q) + 1;
+      memmove(p, next, rest);
+      continue;
+    }
+    p += len;
+  }
+
+  // run68.iniから読み込む場合と同じく、領域の末尾には余裕を残す
+  size_t used = (size_t)(p - top);
+  size_t len = strlen(var) + 1;
+  if ((used + len) >= (size_t)envSize - 5) return;
+  memcpy(p, var, len);
+  p[len] = '\0';
+}
+
 static ULong init_env(ULong size, ULong parent) {
   Long buf = Malloc(MALLOC_FROM_LOWER, size, parent);
   if (buf < 0) return 0;
@@ -251,6 +367,11 @@ static ULong init_env(ULong size, ULong parent) {
   WriteULongSuper(buf, size);
   WriteUByteSuper(buf + 4, 0);
   readenv_from_ini(ini_file_name, buf);
+
+  const char* const* envp = activeMachine->environment;
+  if (envp) {
+    for (; *envp; envp += 1) setEnvironmentVariable(buf, *envp);
+  }
   return buf;
 }
 
@@ -268,6 +389,7 @@ static bool initMachineMemory(Settings* settings, ULong* outHimemAdr) {
     printFmt("メモリが確保できません。\n");
     return false;
   }
+  ClearBlockCache();
 
   WriteULongSuper(OSWORK_MEMORY_END, settings->mainMemorySize);
   return true;
@@ -287,6 +409,30 @@ static void linkHimemToMemblkLink(ULong himemAdr, ULong himemSize,
   WriteULongSuper(OSWORK_MEMORY_END, himemAdr + himemSize);
 }
 
+// Human68kを初期化した直後の状態のメモリを用意する。
+//   前回の実行とメモリの設定が同じなら、保存しておいたメモリの状態に
+//   書き込まれたページだけを戻す。trap_table_make()とInitHuman68k()が
+//   設定するホスト側の変数はスレッドごとにあり、前回と別のスレッドや
+//   別のマシンの実行で値が変わっているので、保存しておいた値に戻す。
+static bool prepareMachineMemory(ULong humanPsp, ULong* outHimemAdr) {
+  if (RestoreMachineMemory(&settings, outHimemAdr)) {
+    RestoreHuman68kHostState(&activeMachine->human68k);
+    // HLEの有無などで命令ハンドラが変わるので、ブロックは記録し直す
+    ClearBlockCache();
+    return true;
+  }
+
+  if (!initMachineMemory(&settings, outHimemAdr)) return false;
+  trap_table_make();
+  if (InitHuman68k(humanPsp) != 0) return false;
+  linkHimemToMemblkLink(*outHimemAdr, settings.highMemorySize, humanPsp);
+
+  // 保存できなかった場合は、次回も初期化し直すだけなので続行する
+  SaveMachineMemory();
+  SaveHuman68kHostState(&activeMachine->human68k);
+  return true;
+}
+
 static bool analyzeHimemOption(const char* arg) {
   static const unsigned long sizes[] = {0, 16, 32, 64, 128, 256, 384, 512, 768};
   const size_t sizes_len = sizeof(sizes) / sizeof(sizes[0]);
@@ -309,16 +455,170 @@ static bool analyzeHimemOption(const char* arg) {
   return false;
 }
 
-int main(int argc, char* argv[]) {
+static bool analyzeMemOption(const char* arg) {
+  const char* p = strchr(arg, '=');
+  char* endptr = NULL;
+  unsigned long mb = p ? strtoul(p + 1, &endptr, 10) : 0;
+  if (endptr && *endptr) mb = 0;
+
+  if (1 <= mb && mb <= MAIN_MEMORY_MB_MAX) {
+    settings.mainMemorySize = (ULong)(mb * 1024 * 1024);
+    return true;
+  }
+
+  print("メインメモリの容量は1～12の範囲で指定する必要があります。\n");
+  return false;
+}
+
+static bool analyzeCheckpointOption(const char* arg) {
+  const char* p = strchr(arg, '=') + 1;
+  char* endptr = NULL;
+  unsigned long adr = strtoul(p, &endptr, 16);
+
+  if (endptr != p && *endptr == ',' && endptr[1] != '\0' && adr != 0 &&
+      (adr & 1) == 0) {
+    settings.checkpointPc = (ULong)adr;
+    settings.checkpointFile = endptr + 1;
+    return true;
+  }
+
+  print(
+      "チェックポイントを作成するアドレス(偶数の16進数)とファイル名を"
+      "指定する必要があります。\n");
+  return false;
+}
+
+// 実行統計を表示する。
+static void printStatistics(void) {
+  print("** RUN68 STATISTICS **\n");
+  printFmt("メインメモリ: %uKB\n", settings.mainMemorySize / 1024);
+  printFmt("ハイメモリ: %uKB\n", settings.highMemorySize / 1024);
+
+  ULong rss = HOST_GET_PEAK_RESIDENT_SIZE();
+  if (rss) printFmt("最大常駐メモリ: %uKB\n", rss);
+
+  PrintFusionStatistics();
+  PrintMulDivStatistics();
+  PrintExecImageStatistics();
+  if (settings.hle) PrintHleStatistics();
+}
+
+// エミュレータの状態を初期化する。
+//   ライブラリとして組み込まれた場合は同じプロセスで何度も実行するので、
+//   前回の実行で変更された状態を全て初期状態に戻す。
+static void resetMachineState(void) {
+  memset(&cpu, 0, sizeof(cpu));
+  SetSr(0);
+  OP_info = (EXEC_INSTRUCTION_INFO){0};
+  superjsr_ret = 0;
+  memset(psp, 0, sizeof(psp));
+  memset(nest_pc, 0, sizeof(nest_pc));
+  memset(nest_sp, 0, sizeof(nest_sp));
+  nest_cnt = 0;
+  cwatchpoint = 0x4afc;
+  stepcount = 0;
+
+  debug_flag = false;
+  cont_flag = true;
+  running = true;
+
+  OPBuf_clear();
+  clear_fnckey();
+  HleClear();
+  ClearFusionStatistics();
+  ClearMulDivStatistics();
+  ClearExecImageStatistics();
+}
+
+// 全ての階層のプロセスが開いたファイルを閉じる。
+static void closeAllProcessFiles(void) {
+  for (;;) {
+    close_all_files();
+    if (nest_cnt == 0) break;
+    nest_cnt -= 1;
+  }
+}
+
+// 読み込んだプログラムを実行し、終了コードを返す。
+static int executeProgram(bool* restart) {
+  int ret = exec_notrap(restart);
+
+  /* 終了 */
+  if (settings.traceFunc) {
+    printf("d0-7=%08x", cpu.rd[0]);
+    for (int i = 1; i < 8; i++) {
+      printf(",%08x", cpu.rd[i]);
+    }
+    printf("\n");
+    printf("a0-7=%08x", cpu.ra[0]);
+    for (int i = 1; i < 8; i++) {
+      printf(",%08x", cpu.ra[i]);
+    }
+    printf("\n");
+    printf("  pc=%08x    sr=%04x\n", cpu.pc, GetSr());
+  }
+  if (settings.statistics) printStatistics();
+
+  return ret;
+}
+
+// 長いコマンドラインをHUPAIR非対応のプログラムに渡せない時のエラー表示
+static void printHupairError(void) {
+  print(
+      "コマンドライン文字列の長さが255バイトを超えましたが、"
+      "プログラムがHUPAIRに対応していないため実行できません。\n");
+}
+
+// チェックポイントファイルからマシンの状態を復元して実行を再開する。
+//   プログラムのコマンドラインは新しい引数に置き換える。
+static int resumeProgram(int argc, char* argv[], bool* restart) {
+  CheckpointHeader header;
+  FILE* fp = OpenCheckpoint(settings.restoreFile, &header);
+  if (!fp) return EXIT_FAILURE;
+
+  // メモリの容量はチェックポイントを作成した時に合わせる
+  settings.mainMemorySize = header.mainMemorySize;
+  settings.highMemorySize = header.highMemorySize;
+
+  ULong himemAdr;
+  bool restored = prepareMachineMemory(HUMAN_PSP, &himemAdr) &&
+                  RestoreCheckpoint(fp, &header);
+  fclose(fp);
+  if (!restored) return EXIT_FAILURE;
+  SetAllocArea(ALLOC_AREA_UNLIMITED);
+
+  bool needHupair;
+  ULong cmdline = ReadULongSuper(psp[0] + PSP_CMDLINE);
+  if (!ReplaceHupair(cmdline, argc, argv, &needHupair)) {
+    print("run68:コマンドラインが長すぎるため置き換えられません。\n");
+    return EXIT_FAILURE;
+  }
+  if (needHupair && !IsCompliantWithHupair(header.psp + SIZEOF_PSP,
+                                           header.programSize, header.entry)) {
+    printHupairError();
+    return EXIT_FAILURE;
+  }
+
+  init_all_fileinfo();
+  return executeProgram(restart);
+}
+
+/*
+   機能：
+     コマンドラインを解析してプログラムを読み込み、実行する
+   パラメータ：
+     bool*  restart  <out>  デバッガでプログラムの再実行が指示された
+   戻り値：
+     終了コード
+*/
+static int runProgram(int argc, char* argv[], bool* restart) {
   char fname[89]; /* 実行ファイル名 */
   FILE* fp;       /* 実行ファイルのファイルポインタ */
   int i, j;
-  bool restart;
 
-  debug_flag = false;
-  settings = defaultSettings;
+  *restart = false;
+  SetAllocArea(ALLOC_AREA_MAIN_ONLY);
 
-Restart:
   /* コマンドライン解析 */
   for (i = 1; i < argc; i++) {
     /* フラグを調べる。 */
@@ -364,14 +664,50 @@ Restart:
           settings.traceFunc = true;
           print("ファンクションコールトレースフラグ=ON\n");
           break;
-        case 'r':
+        case 'r': {
+          const char restore[] = "-restore=";
+          if (strncmp(argv[i], restore, strlen(restore)) == 0 &&
+              argv[i][strlen(restore)] != '\0') {
+            settings.restoreFile = argv[i] + strlen(restore);
+            break;
+          }
           if (strcmp(argv[i], "-read-file-utf8") != 0) {
             invalid_flag = true;
             break;
           }
           settings.readFileUtf8 = true;
           break;
+        }
+        case 'c': {
+          const char checkpoint[] = "-checkpoint-at=";
+          if (strncmp(argv[i], checkpoint, strlen(checkpoint)) == 0) {
+            if (!analyzeCheckpointOption(argv[i])) invalid_flag = true;
+            break;
+          }
+          invalid_flag = true;
+          break;
+        }
+        case 'm': {
+          const char mem[] = "-mem=";
+          if (strncmp(argv[i], mem, strlen(mem)) == 0) {
+            if (!analyzeMemOption(argv[i])) invalid_flag = true;
+            break;
+          }
+          invalid_flag = true;
+          break;
+        }
+        case 's':
+          if (strcmp(argv[i], "-stat") != 0) {
+            invalid_flag = true;
+            break;
+          }
+          settings.statistics = true;
+          break;
         case 'h': {
+          if (strcmp(argv[i], "-hle") == 0) {
+            settings.hle = true;
+            break;
+          }
           const char himem[] = "-himem=";
           if (strncmp(argv[i], himem, strlen(himem)) == 0) {
             if (!analyzeHimemOption(argv[i])) invalid_flag = true;
@@ -391,7 +727,7 @@ Restart:
   }
 
   int argbase = i;  // アプリケーションコマンドラインの開始位置
-  if (argc - argbase == 0) {
+  if (argc - argbase == 0 && !settings.restoreFile) {
     print_title();
     print_usage();
     return EXIT_FAILURE;
@@ -402,16 +738,15 @@ Restart:
   /* iniファイルのフルパス名が得られる。*/
   read_ini(ini_file_name);
 
-  ULong himemAdr;
-  if (!initMachineMemory(&settings, &himemAdr)) return EXIT_FAILURE;
-  trap_table_make();
+  if (settings.restoreFile) {
+    return resumeProgram(argc - argbase, &argv[argbase], restart);
+  }
 
   const ULong humanPsp = HUMAN_PSP;
-  if (InitHuman68k(humanPsp) != 0) return EXIT_FAILURE;
+  ULong himemAdr;
+  if (!prepareMachineMemory(humanPsp, &himemAdr)) return EXIT_FAILURE;
   nest_cnt = 0;
 
-  linkHimemToMemblkLink(himemAdr, settings.highMemorySize, humanPsp);
-
   // 環境変数を初期化
   const ULong humanEnv = init_env(DEFAULT_ENV_SIZE, humanPsp);
 
@@ -447,8 +782,9 @@ Restart:
 
   // コマンドライン文字列を作成
   bool needHupair;
-  ULong cmdline = EncodeHupair(argc - (argbase + 1), &argv[argbase + 1],
-                               hpn.name, humanPsp, &needHupair);
+  ULong cmdline = EncodeHupair(
+      argc - (argbase + 1), &argv[argbase + 1], hpn.name, humanPsp,
+      settings.checkpointPc ? CHECKPOINT_COMMAND_LINE_SIZE : 0, &needHupair);
 
   // スタックを確保
   const Long programStack =
@@ -466,6 +802,7 @@ Restart:
 
   if (humanEnv == 0 || cmdline == 0 || programStack < 0 || child.address < 0) {
     print("プロセス用のメモリを確保できません\n");
+    fclose(fp);
     return EXIT_FAILURE;
   }
   const ULong programPsp = child.address - SIZEOF_MEMBLK;
@@ -475,61 +812,110 @@ Restart:
   Long prog_size2 = child.address + child.length;
   const Long entryAddress =
       prog_read(fp, fname, programPsp + SIZEOF_PSP, &prog_size, &prog_size2,
-                print, EXEC_TYPE_DEFAULT);
-  if (entryAddress < 0) {
-    FreeMachineMemory();
-    return EXIT_FAILURE;
-  }
+                print, EXEC_TYPE_DEFAULT, settings.hle);
+  if (entryAddress < 0) return EXIT_FAILURE;
 
   if (needHupair) {
     if (!IsCompliantWithHupair(programPsp + SIZEOF_PSP, prog_size,
                                entryAddress)) {
-      print(
-          "コマンドライン文字列の長さが255バイトを超えましたが、"
-          "プログラムがHUPAIRに対応していないため実行できません。\n");
+      printHupairError();
       return EXIT_FAILURE;
     }
   }
+  mainProgramSize = prog_size;
+  mainProgramEntry = entryAddress;
 
   const ProgramSpec progSpec = {prog_size2, prog_size - prog_size2};
-  BuildPsp(programPsp, humanEnv, cmdline, sr, humanPsp, &progSpec, &hpn);
+  BuildPsp(programPsp, humanEnv, cmdline, GetSr(), humanPsp, &progSpec, &hpn);
 
   init_all_fileinfo();
 
   /* レジスタに値を設定 */
-  pc = entryAddress;
-  ra[0] = programPsp;
-  ra[1] =
+  cpu.pc = entryAddress;
+  cpu.ra[0] = programPsp;
+  cpu.ra[1] =
       programPsp + SIZEOF_PSP + prog_size;  // プログラムの終わり+1のアドレス
-  ra[2] = cmdline;                          // コマンドラインのアドレス
-  ra[3] = humanEnv;                         // 環境のアドレス
-  ra[4] = pc;                               // 実行開始アドレス
-  ra[7] = stackBottom;
+  cpu.ra[2] = cmdline;                      // コマンドラインのアドレス
+  cpu.ra[3] = humanEnv;                     // 環境のアドレス
+  cpu.ra[4] = cpu.pc;                       // 実行開始アドレス
+  cpu.ra[7] = stackBottom;
 
   /* 実行 */
   psp[nest_cnt] = programPsp;
   superjsr_ret = 0;
-  usp = 0;
-  int ret = exec_notrap(&restart);
+  cpu.usp = 0;
+  return executeProgram(restart);
+}
 
-  /* 終了 */
-  if (settings.traceFunc) {
-    printf("d0-7=%08x", rd[0]);
-    for (i = 1; i < 8; i++) {
-      printf(",%08x", rd[i]);
-    }
-    printf("\n");
-    printf("a0-7=%08x", ra[0]);
-    for (i = 1; i < 8; i++) {
-      printf(",%08x", ra[i]);
-    }
-    printf("\n");
-    printf("  pc=%08x    sr=%04x\n", pc, sr);
+// マシンを作成する。
+//   NULLならメモリ不足。
+Run68Machine* Run68CreateMachine(void) {
+  // 命令表などスレッド間で共有する表は最初のマシンの作成時に用意する
+  static bool instructionTableReady = false;
+  if (!instructionTableReady) {
+    InitInstructionTable();
+    instructionTableReady = true;
+  }
+
+  Run68Machine* machine = calloc(1, sizeof(*machine));
+  if (!machine) return NULL;
+
+  machine->settings = defaultSettings;
+  machine->environment = NULL;
+  machine->memory = CreateMachineMemory();
+  machine->blockCache = CreateBlockCache();
+  machine->execImageCache = CreateExecImageCache();
+  if (!machine->memory || !machine->blockCache || !machine->execImageCache) {
+    Run68DestroyMachine(machine);
+    return NULL;
+  }
+  return machine;
+}
+
+// マシンを破棄する。
+//   次の実行のために残しておいたメモリと実行ファイルのキャッシュも解放する。
+void Run68DestroyMachine(Run68Machine* machine) {
+  if (machine->memory) DestroyMachineMemory(machine->memory);
+  if (machine->blockCache) DestroyBlockCache(machine->blockCache);
+  if (machine->execImageCache) DestroyExecImageCache(machine->execImageCache);
+  free(machine);
+}
+
+// 実行するプログラムに渡す環境変数を設定する。
+void Run68SetEnvironment(Run68Machine* machine, const char* const* envp) {
+  machine->environment = envp;
+}
+
+// コマンドラインで指定されたプログラムを実行し、終了コードを返す。
+int Run68Execute(Run68Machine* machine, int argc, char* argv[]) {
+  if (machine->running) {
+    print("run68:このマシンは実行中です。\n");
+    return EXIT_FAILURE;
   }
+  machine->running = true;
+
+  // マシンの状態をこのスレッドに結び付ける
+  activeMachine = machine;
+  AttachMachineMemory(machine->memory);
+  AttachBlockCache(machine->blockCache);
+  AttachExecImageCache(machine->execImageCache);
+  resetMachineState();
+  settings = machine->settings;
+
+  int ret;
+  bool restart;
+  do {
+    ret = runProgram(argc, argv, &restart);
 
-  FreeMachineMemory();
+    // メモリは次の実行で書き込まれたページだけを初期状態に戻して使う
+    closeAllProcessFiles();
+  } while (restart);
 
-  if (restart) goto Restart;
+  AttachExecImageCache(NULL);
+  DetachBlockCache();
+  DetachMachineMemory(machine->memory);
+  activeMachine = NULL;
+  machine->running = false;
   return ret;
 }
 
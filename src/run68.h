@@ -40,6 +40,17 @@
 #define GCC_FORMAT(a, b)
 #endif
 
+// 実行中のマシンの状態を持つ変数
+//   マシンは実行するスレッドに結び付けるので、スレッドごとの変数にする
+//   (librun68.h参照)。
+#if __STDC_VERSION__ >= 202311L
+#define THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
 #include <limits.h>
 #include <setjmp.h>
 #include <stdbool.h>
@@ -61,6 +72,7 @@
 #endif
 
 #define DEFAULT_MAIN_MEMORY_SIZE (12 * 1024 * 1024)
+#define MAIN_MEMORY_MB_MAX 12
 #define DEFAULT_HIGH_MEMORY_SIZE (0)
 #define DEFAULT_STACK_SIZE (64 * 1024)
 #define DEFAULT_ENV_SIZE (8 * 1024)
@@ -126,28 +138,30 @@
 #define EA_Variable 0x01ff       /* 0000 0001 1111 1111 */
 #define EA_VariableMemory 0x01fc /* 0000 0001 1111 1100 */
 
-#define CCR_X_ON() (sr |= CCR_X)
-#define CCR_X_OFF() (sr &= ~CCR_X)
-#define CCR_X_REF() (sr & CCR_X)
-#define CCR_N_ON() (sr |= CCR_N)
-#define CCR_N_OFF() (sr &= ~CCR_N)
-#define CCR_N_REF() (sr & CCR_N)
-#define CCR_Z_ON() (sr |= CCR_Z)
-#define CCR_Z_OFF() (sr &= ~CCR_Z)
-#define CCR_Z_REF() (sr & CCR_Z)
-#define CCR_V_ON() (sr |= CCR_V)
-#define CCR_V_OFF() (sr &= ~CCR_V)
-#define CCR_V_REF() (sr & CCR_V)
-#define CCR_C_ON() (sr |= CCR_C)
-#define CCR_C_OFF() (sr &= ~CCR_C)
-#define CCR_C_REF() (sr & CCR_C)
-#define SR_S_ON() (sr |= SR_S)
-#define SR_S_OFF() (sr &= ~SR_S)
-#define SR_S_REF() (sr & SR_S)
-#define SR_T_REF() (sr & SR_T1)
-
-#define CCR_X_C_ON() (sr |= (CCR_X | CCR_C))
-#define CCR_X_C_OFF() (sr &= ~(CCR_X | CCR_C))
+// N、Z、V、Cは遅延評価されるので、参照・変更する前に評価しておく。
+// (Xは常に評価済み)
+#define CCR_X_ON() (cpu.sr |= CCR_X)
+#define CCR_X_OFF() (cpu.sr &= ~CCR_X)
+#define CCR_X_REF() (cpu.sr & CCR_X)
+#define CCR_N_ON() (EvaluateConditions(), cpu.sr |= CCR_N)
+#define CCR_N_OFF() (EvaluateConditions(), cpu.sr &= ~CCR_N)
+#define CCR_N_REF() (EvaluateConditions(), cpu.sr & CCR_N)
+#define CCR_Z_ON() (EvaluateConditions(), cpu.sr |= CCR_Z)
+#define CCR_Z_OFF() (EvaluateConditions(), cpu.sr &= ~CCR_Z)
+#define CCR_Z_REF() (EvaluateConditions(), cpu.sr & CCR_Z)
+#define CCR_V_ON() (EvaluateConditions(), cpu.sr |= CCR_V)
+#define CCR_V_OFF() (EvaluateConditions(), cpu.sr &= ~CCR_V)
+#define CCR_V_REF() (EvaluateConditions(), cpu.sr & CCR_V)
+#define CCR_C_ON() (EvaluateConditions(), cpu.sr |= CCR_C)
+#define CCR_C_OFF() (EvaluateConditions(), cpu.sr &= ~CCR_C)
+#define CCR_C_REF() (EvaluateConditions(), cpu.sr & CCR_C)
+#define SR_S_ON() (cpu.sr |= SR_S)
+#define SR_S_OFF() (cpu.sr &= ~SR_S)
+#define SR_S_REF() (cpu.sr & SR_S)
+#define SR_T_REF() (cpu.sr & SR_T1)
+
+#define CCR_X_C_ON() (EvaluateConditions(), cpu.sr |= (CCR_X | CCR_C))
+#define CCR_X_C_OFF() (EvaluateConditions(), cpu.sr &= ~(CCR_X | CCR_C))
 
 #ifdef _WIN32
 typedef struct {
@@ -182,20 +196,32 @@ typedef struct {
   bool traceFunc;     // -f ファンクションコールトレース
   bool debug;         // -debug デバッガ有効
   bool readFileUtf8;  // -read-file-utf8
+  bool statistics;    // -stat 終了時に実行統計を表示
+  bool hle;           // -hle 既知のライブラリルーチンをネイティブ実装で実行
+
+  ULong checkpointPc;          // -checkpoint-at 作成するアドレス
+  const char* checkpointFile;  // -checkpoint-at 作成するファイル
+  const char* restoreFile;     // -restore 復元するチェックポイントファイル
 
   bool iothrough;
+  bool hugePages;  // エミュレートするメモリにHuge Pageを使う
 } Settings;
 
+// CPUのレジスタ
+//   実行中の状態をまとめて保存・復元できるように1つの構造体にしている。
+typedef struct {
+  Long rd[8];  // データレジスタ
+  Long ra[8];  // アドレスレジスタ
+  Long usp;    // USP
+  Long pc;     // プログラムカウンタ
+  UWord sr;    // ステータスレジスタ
+} Cpu;
+
 /* デバッグ用に実行した命令の情報を保存しておく構造体 */
+//   命令ごとに保存するので、アドレスだけに留める。
+//   オペコードやニーモニックは表示時に逆アセンブルして得る。
 typedef struct {
   Long pc;
-  /* 本当は全レジスタを保存しておきたい。*/
-  // オペコードも保存すべき(ただし先頭ワードだけでは不十分)。
-  Long rmem;         /* READしたメモリ */
-  char rsize;        /* B/W/L or N(READなし) movemの場合は最後の一つ */
-  Long wmem;         /* WRITEしたメモリ */
-  char wsize;        /* B/W/L or N(WRITEなし) movemの場合は最後の一つ */
-  char mnemonic[64]; /* ニーモニック(できれば) */
 } EXEC_INSTRUCTION_INFO;
 
 /* eaaccess.c */
@@ -206,23 +232,19 @@ bool get_data_at_ea_noinc(int AceptAdrMode, int mode, int reg, int size,
                           Long* data);
 
 /* run68.c */
-extern ULong DefaultExceptionHandler[256];
-extern EXEC_INSTRUCTION_INFO OP_info;  // 命令実行情報
-extern FILEINFO finfo[FILE_MAX];       // ファイル管理テーブル
-extern Settings settings;
+extern THREAD_LOCAL ULong DefaultExceptionHandler[256];
+extern THREAD_LOCAL EXEC_INSTRUCTION_INFO OP_info;  // 命令実行情報
+extern THREAD_LOCAL FILEINFO finfo[FILE_MAX];  // ファイル管理テーブル
+extern THREAD_LOCAL Settings settings;
 extern const char size_char[3];
-extern Long ra[8];              // アドレスレジスタ
-extern Long rd[8];              // データレジスタ
-extern Long usp;                // USP
-extern Long pc;                 // プログラムカウンタ
-extern UWord sr;                // ステータスレジスタ
-extern Long superjsr_ret;       // DOSCALL SUPER_JSRの戻りアドレス
-extern Long psp[NEST_MAX];      // PSP
-extern Long nest_pc[NEST_MAX];  // 親プロセスへの戻りアドレスを保存
-extern Long nest_sp[NEST_MAX];  // 親プロセスのスタックポインタを保存
-extern unsigned int nest_cnt;   // 子プロセスを起動するたびに+1
-extern jmp_buf jmp_when_abort;  // アボート処理のためのジャンプバッファ
-extern UWord cwatchpoint;       // 命令ウォッチ
+extern THREAD_LOCAL Cpu cpu;
+extern THREAD_LOCAL Long superjsr_ret;  // DOSCALL SUPER_JSRの戻りアドレス
+extern THREAD_LOCAL Long psp[NEST_MAX];  // PSP
+extern THREAD_LOCAL Long nest_pc[NEST_MAX];  // 親プロセスへの戻りアドレス
+extern THREAD_LOCAL Long nest_sp[NEST_MAX];  // 親プロセスのスタックポインタ
+extern THREAD_LOCAL unsigned int nest_cnt;  // 子プロセスを起動するたびに+1
+extern THREAD_LOCAL jmp_buf jmp_when_abort;  // アボート処理のジャンプバッファ
+extern THREAD_LOCAL UWord cwatchpoint;  // 命令ウォッチ
 
 void print(const char* message);
 void printFmt(const char* fmt, ...) GCC_FORMAT(1, 2);
@@ -239,12 +261,26 @@ typedef struct {
 
 FILE* prog_open(char*, ULong, void (*)(const char*));
 Long prog_read(FILE*, char*, Long, Long*, Long*, void (*)(const char*),
-               ExecType);
+               ExecType, bool);
+typedef struct ExecImageCache ExecImageCache;
+ExecImageCache* CreateExecImageCache(void);
+void DestroyExecImageCache(ExecImageCache* cache);
+void AttachExecImageCache(ExecImageCache* cache);
+void ClearExecImageStatistics(void);
+void PrintExecImageStatistics(void);
 void BuildPsp(ULong psp, ULong envptr, ULong cmdline, UWord parentSr,
               ULong parentSsp, const ProgramSpec* progSpec,
               const Human68kPathName* pathname);
 
 /* exec.c */
+// 命令ハンドラ
+//   命令コードの上位バイト、下位バイトを受け取る。
+//   戻り値： true = 実行終了 false = 実行継続
+typedef bool (*InstructionHandler)(char code1, char code2);
+
+void InitInstructionTable(void);
+InstructionHandler GetInstructionHandler(UWord code);
+InstructionHandler GetFusedInstructionHandler(UWord code);
 bool prog_exec(void);
 bool get_cond(char);
 NORETURN void err68(const char*);
@@ -265,29 +301,30 @@ bool dos_call(UByte);
 Long gets2(char* str, int max);
 
 /* key.c */
+void clear_fnckey(void);
 void get_fnckey(int, char*);
 void put_fnckey(int, char*);
 
 /* line?.c */
-bool line0(char*);
-bool line2(char*);
-bool line4(char*);
-bool line5(char*);
-bool line6(char*);
-bool line7(char*);
-bool line8(char*);
-bool line9(char*);
-bool lineb(char*);
-bool linec(char*);
-bool lined(char*);
-bool linee(char*);
-bool linef(char*);
-
-// line_8.c
-Long SubBcd(Long x, Long y);
+InstructionHandler decodeLine0(char code1, char code2);
+InstructionHandler decodeLine2(char code1, char code2);
+InstructionHandler decodeLine4(char code1, char code2);
+InstructionHandler decodeLine5(char code1, char code2);
+InstructionHandler decodeLine6(char code1, char code2);
+InstructionHandler decodeLine7(char code1, char code2);
+InstructionHandler decodeLine8(char code1, char code2);
+InstructionHandler decodeLine9(char code1, char code2);
+InstructionHandler decodeLineB(char code1, char code2);
+InstructionHandler decodeLineC(char code1, char code2);
+InstructionHandler decodeLineD(char code1, char code2);
+InstructionHandler decodeLineE(char code1, char code2);
+InstructionHandler decodeLineF(char code1, char code2);
+InstructionHandler fuseLine4(InstructionHandler handler);
+InstructionHandler fuseLine5(InstructionHandler handler);
+InstructionHandler fuseLineB(InstructionHandler handler);
 
 /* debugger.c */
-extern ULong stepcount;
+extern THREAD_LOCAL ULong stepcount;
 
 typedef enum {
   RUN68_COMMAND_BREAK,   /* ブレークポイントの設定 */
@@ -311,6 +348,45 @@ typedef enum {
 RUN68_COMMAND debugger(bool running);
 
 /* conditions.c */
+// コンディションコードの遅延評価
+//   演算結果からN、Z、V、Cを求めるのは参照される時まで遅らせる。
+typedef enum {
+  LAZY_CC_NONE,     // srのN、Z、V、Cは評価済み
+  LAZY_CC_GENERAL,  // general_conditions()
+  LAZY_CC_ADD,      // add_conditions()
+  LAZY_CC_CMP,      // cmp_conditions()、sub_conditions()
+} LazyConditionsKind;
+
+typedef struct {
+  LazyConditionsKind kind;
+  int size;
+  Long src;
+  Long dest;
+  Long result;
+} LazyConditions;
+
+extern THREAD_LOCAL LazyConditions lazyConditions;
+
+UWord GetConditions(void);
+void EvaluateConditionsSlow(void);
+
+// 遅延評価中のN、Z、V、Cを評価してsrに反映する。
+static inline void EvaluateConditions(void) {
+  if (lazyConditions.kind != LAZY_CC_NONE) EvaluateConditionsSlow();
+}
+
+// コンディションコードを評価済みのsrの値を得る。
+static inline UWord GetSr(void) {
+  EvaluateConditions();
+  return cpu.sr;
+}
+
+// srに値を設定する(遅延評価中のコンディションコードは破棄する)。
+static inline void SetSr(UWord value) {
+  lazyConditions.kind = LAZY_CC_NONE;
+  cpu.sr = value;
+}
+
 void general_conditions(Long dest, int size);
 void add_conditions(Long src, Long dest, Long result, int size, bool zero_flag);
 void cmp_conditions(Long src, Long dest, Long result, int size);
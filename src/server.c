@@ -0,0 +1,321 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#include "server.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "redirect.h"
+
+extern char** environ;
+
+// 常駐サーバー(-server)
+//   Unixドメインソケットでクライアント(run68c)からの要求を待ち、
+//   要求ごとにクライアントのカレントディレクトリ、環境変数、標準入出力で
+//   プログラムを実行して終了コードを返す。
+//   プロセスの起動や命令テーブルの作成などの初期化は一度だけで済むが、
+//   マシンの状態は要求ごとに初期化する。
+//   要求は1つずつ処理し、処理中に届いた要求は待たせる。
+
+#define MAX_ARGS 1024
+#define MAX_LOG_LENGTH 256
+
+// 要求の受信を待つ時間(秒)
+//   接続したまま送信しないクライアントで、後続の要求が止まらないようにする。
+#define RECEIVE_TIMEOUT_SEC 10
+
+static double wallClock(void) {
+  struct timespec ts;
+  if (timespec_get(&ts, TIME_UTC) == 0) return 0;
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// 指定バイト数を受信する。
+static bool receiveAll(int conn, void* buf, size_t size) {
+  char* p = buf;
+  while (size > 0) {
+    ssize_t n = recv(conn, p, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+// 指定バイト数を送信する。
+static bool sendAll(int conn, const void* buf, size_t size) {
+  const char* p = buf;
+  while (size > 0) {
+    ssize_t n = send(conn, p, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+static void closeFds(int* fds, int count) {
+  for (int i = 0; i < count; i += 1) close(fds[i]);
+}
+
+// 要求のヘッダと標準入出力のファイルディスクリプタを受け取る。
+static bool receiveHeader(int conn, ServerRequestHeader* header, int* fds) {
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int) * SERVER_FD_COUNT)];
+  } control;
+  struct iovec iov = {header, sizeof(*header)};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  ssize_t n;
+  do {
+    n = recvmsg(conn, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) return false;
+
+  int count = 0;
+  for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+    if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+
+    size_t received = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (size_t i = 0; i < received; i += 1) {
+      int fd;
+      memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(fd));
+      if (count < SERVER_FD_COUNT) {
+        fds[count++] = fd;
+      } else {
+        close(fd);
+      }
+    }
+  }
+
+  // ヘッダの残りは通常のデータとして届くことがある
+  bool ok = receiveAll(conn, (char*)header + n, sizeof(*header) - (size_t)n);
+  if (!ok || count != SERVER_FD_COUNT || (msg.msg_flags & MSG_CTRUNC) ||
+      header->magic != SERVER_REQUEST_MAGIC ||
+      header->payloadSize > SERVER_PAYLOAD_MAX) {
+    closeFds(fds, count);
+    return false;
+  }
+  return true;
+}
+
+// ペイロードをカレントディレクトリ、コマンドライン、環境変数に分ける。
+//   環境変数の配列はmalloc()で確保して*envpに返す。
+//   戻り値はargvの要素数(-1 = 不正なペイロード)。
+static int parsePayload(char* payload, size_t size, uint32_t argCount,
+                        const char* run68Path, const char** cwd, char** argv,
+                        char*** envp) {
+  if (size == 0 || payload[size - 1] != '\0') return -1;
+  if (argCount >= MAX_ARGS) return -1;
+
+  char* const end = payload + size;
+  *cwd = payload;
+  char* p = payload + strlen(payload) + 1;
+
+  int argc = 0;
+  argv[argc++] = (char*)run68Path;
+  for (; argc <= (int)argCount; p += strlen(p) + 1) {
+    if (p >= end) return -1;
+    argv[argc++] = p;
+  }
+  argv[argc] = NULL;
+
+  size_t envCount = 0;
+  for (char* q = p; q < end; q += strlen(q) + 1) envCount += 1;
+  char** env = malloc(sizeof(char*) * (envCount + 1));
+  if (!env) return -1;
+  for (size_t i = 0; i < envCount; i += 1, p += strlen(p) + 1) env[i] = p;
+  env[envCount] = NULL;
+
+  *envp = env;
+  return argc;
+}
+
+// ログ用にコマンドラインを1行にまとめる。
+static void joinArgs(char* buf, size_t size, int argc, char** argv) {
+  size_t len = 0;
+  buf[0] = '\0';
+  for (int i = 1; i < argc && len < size; i += 1) {
+    int n = snprintf(buf + len, size - len, (i == 1) ? "%s" : " %s", argv[i]);
+    if (n < 0) break;
+    len += (size_t)n;
+  }
+}
+
+// 要求を受け取ってプログラムを実行し、終了コードを返す。
+static void handleRequest(Run68Machine* machine, const char* run68Path,
+                          const char* startDir, int conn) {
+  static char* argv[MAX_ARGS + 1];
+  double start = wallClock();
+
+  struct timeval timeout = {RECEIVE_TIMEOUT_SEC, 0};
+  setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  ServerRequestHeader header;
+  int fds[SERVER_FD_COUNT];
+  if (!receiveHeader(conn, &header, fds)) {
+    fprintf(stderr, "run68:不正な要求を受け取りました。\n");
+    return;
+  }
+
+  char* payload = malloc(header.payloadSize + 1);
+  const char* cwd = NULL;
+  char** envp = NULL;
+  int argc = -1;
+  if (payload && receiveAll(conn, payload, header.payloadSize)) {
+    argc = parsePayload(payload, header.payloadSize, header.argCount,
+                        run68Path, &cwd, argv, &envp);
+  }
+  if (argc < 0) {
+    fprintf(stderr, "run68:不正な要求を受け取りました。\n");
+    closeFds(fds, SERVER_FD_COUNT);
+    free(payload);
+    return;
+  }
+
+  int32_t exitCode = EXIT_FAILURE;
+  if (chdir(cwd) != 0) {
+    // エラーメッセージはクライアントに表示させる
+    dprintf(fds[2], "run68:ディレクトリに移動できません。(\"%s\")\n", cwd);
+  } else {
+    // 実行ファイルの検索(PATH)などでホストの環境変数を参照するので、
+    // 実行中はクライアントの環境変数に置き換える
+    char** savedEnviron = environ;
+    environ = envp;
+
+    int savedIn = RedirectStream(stdin, fds[0]);
+    int savedOut = RedirectStream(stdout, fds[1]);
+    int savedErr = RedirectStream(stderr, fds[2]);
+    if (savedIn >= 0 && savedOut >= 0 && savedErr >= 0) {
+      exitCode = Run68Execute(machine, argc, argv);
+    }
+    RestoreStream(stderr, savedErr);
+    RestoreStream(stdout, savedOut);
+    RestoreStream(stdin, savedIn);
+
+    environ = savedEnviron;
+
+    if (chdir(startDir) != 0) {
+      fprintf(stderr, "run68:ディレクトリに戻れません。(\"%s\")\n", startDir);
+    }
+  }
+  closeFds(fds, SERVER_FD_COUNT);
+  sendAll(conn, &exitCode, sizeof(exitCode));
+
+  char command[MAX_LOG_LENGTH];
+  joinArgs(command, sizeof(command), argc, argv);
+  fprintf(stderr, "run68:%.3fms exit=%d cwd=%s %s\n",
+          (wallClock() - start) * 1000, exitCode, cwd, command);
+  free(envp);
+  free(payload);
+}
+
+// ソケットを作成して待ち受けを開始する。
+//   戻り値：ソケット(-1 = 失敗)
+static int listenSocket(const char* socketPath) {
+  struct sockaddr_un addr = {0};
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "run68:ソケットのパス名が長すぎます。\n");
+    return -1;
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  // 前回のサーバーが残したソケットは削除する(ソケット以外は削除しない)
+  struct stat st;
+  if (lstat(socketPath, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      fprintf(stderr, "run68:ソケット以外のファイルが存在します。(\"%s\")\n",
+              socketPath);
+      return -1;
+    }
+    unlink(socketPath);
+  }
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) {
+    fprintf(stderr, "run68:ソケットが作成できません。\n");
+    return -1;
+  }
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(sock, SOMAXCONN) != 0) {
+    fprintf(stderr, "run68:ソケットで待ち受けできません。(\"%s\")\n",
+            socketPath);
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+/*
+   機能：
+     常駐して、クライアントから要求されたプログラムを実行する
+   パラメータ：
+     Run68Machine*  machine     <in>  実行に使うマシン
+     const char*    run68Path   <in>  run68自身のパス名(絶対パス)
+     const char*    socketPath  <in>  待ち受けるソケットのパス名
+   戻り値：
+     終了コード(待ち受けに失敗した場合だけ戻る)
+*/
+int RunServer(Run68Machine* machine, const char* run68Path,
+              const char* socketPath) {
+  static char startDir[4096];
+  if (getcwd(startDir, sizeof(startDir)) == NULL) {
+    fprintf(stderr, "run68:カレントディレクトリが取得できません。\n");
+    return EXIT_FAILURE;
+  }
+
+  int sock = listenSocket(socketPath);
+  if (sock < 0) return EXIT_FAILURE;
+
+  // クライアントが先に終了しても、書き込みエラーとして扱う
+  signal(SIGPIPE, SIG_IGN);
+
+  fprintf(stderr, "run68:サーバーを起動しました。(\"%s\")\n", socketPath);
+  for (;;) {
+    int conn = accept(sock, NULL, NULL);
+    if (conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      fprintf(stderr, "run68:接続を受け付けられません。\n");
+      break;
+    }
+    handleRequest(machine, run68Path, startDir, conn);
+    close(conn);
+  }
+
+  close(sock);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,53 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+
+#include "librun68.h"
+
+// 常駐サーバー(-server)とクライアント(run68c)の間のプロトコル
+//
+//   Unixドメインソケット(SOCK_STREAM)で1回の接続につき1つのジョブを扱う。
+//   要求：ヘッダ、ペイロードの順に送る。ヘッダの送信時にSCM_RIGHTSで
+//         標準入力、標準出力、標準エラー出力のファイルディスクリプタを渡す。
+//         ペイロードはNULで終わる文字列の並びで、カレントディレクトリ、
+//         run68のコマンドライン(argv[1]以降、argCount個)、
+//         クライアントの環境変数("名前=値"、ペイロードの末尾まで)の順。
+//   応答：終了コード(int32_t)。
+//   数値はホストのバイトオーダー(同じホスト内の通信なので変換しない)。
+
+#define SERVER_REQUEST_MAGIC 0x4b383652  // "R68K"
+#define SERVER_PAYLOAD_MAX (256 * 1024)
+#define SERVER_FD_COUNT 3
+
+// クライアントがソケットのパス名を得る環境変数
+#define SERVER_SOCKET_ENV "RUN68_SOCKET"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t payloadSize;
+  uint32_t argCount;  // ペイロードに含まれるコマンドラインの引数の数
+} ServerRequestHeader;
+
+int RunServer(Run68Machine* machine, const char* run68Path,
+              const char* socketPath);
+
+#endif
@@ -0,0 +1,174 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+// BCD演算(abcd、sbcd、nbcd)の等価性テスト
+//   bcd.hのAddBcd()、SubBcd()と、それを使う命令ハンドラ(データレジスタ
+//   を対象とする形式)を、条件分岐でフラグを設定する以前の実装と比較する。
+//   全てのオペランドの組(BCDとして不正な値を含む)と、実行前のX、N、Z、V、Cの
+//   全ての組み合わせについて、結果とMC68000では未定義のN、Vを含む
+//   コンディションコードが一致することを調べる。
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bcd.h"
+#include "run68.h"
+
+#define MAX_ERRORS 20
+
+static unsigned long long testCount;
+static int errorCount;
+
+// 以前のBCD加算
+//   Makoto Kamada氏のXEiJ (https://stdkmd.net/xeij/)
+//   MC68000.javaを参考にしています。
+static Long referenceAddBcd(Long x, Long y, UWord* ccr) {
+  Long ccrX = (*ccr & CCR_X) ? 1 : 0;
+  Long t = (x & 0xff) + (y & 0xff) + ccrX;
+  Long result = t;
+
+  if (10 <= ((x & 0x0f) + (y & 0x0f) + ccrX)) result = result + 0x10 - 10;
+  if ((10 << 4) <= result) {
+    result = result + 0x100 - (10 << 4);
+    *ccr |= CCR_X | CCR_C;
+  } else
+    *ccr &= ~(CCR_X | CCR_C);
+
+  result &= 0xff;
+  if (result != 0) *ccr &= ~CCR_Z;
+
+  if (result & 0x80)
+    *ccr |= CCR_N;
+  else
+    *ccr &= ~CCR_N;
+
+  Long a = result - t;
+  if (((t ^ result) & (a ^ result)) & 0x80)
+    *ccr |= CCR_V;
+  else
+    *ccr &= ~CCR_V;
+
+  return result;
+}
+
+// 以前のBCD減算
+static Long referenceSubBcd(Long x, Long y, UWord* ccr) {
+  Long ccrX = (*ccr & CCR_X) ? 1 : 0;
+  Long t = (x & 0xff) - (y & 0xff) - ccrX;
+  Long result = t;
+
+  if ((x & 0x0f) < ((y & 0x0f) + ccrX)) result = result - 0x10 + 10;
+  if (result < 0) {
+    if (t < 0) result = result - 0x100 + (10 << 4);
+    *ccr |= CCR_X | CCR_C;
+  } else
+    *ccr &= ~(CCR_X | CCR_C);
+
+  result &= 0xff;
+  if (result != 0) *ccr &= ~CCR_Z;
+
+  if (result & 0x80)
+    *ccr |= CCR_N;
+  else
+    *ccr &= ~CCR_N;
+
+  Long a = result - t;
+  if (((t ^ result) & (a ^ result)) & 0x80)
+    *ccr |= CCR_V;
+  else
+    *ccr &= ~CCR_V;
+
+  return result;
+}
+
+static void compare(const char* name, Long x, Long y, UWord ccrIn,
+                    Long result, UWord ccr, Long expected,
+                    UWord expectedCcr) {
+  testCount += 1;
+  if (result == expected && ccr == expectedCcr) return;
+
+  errorCount += 1;
+  if (errorCount <= MAX_ERRORS) {
+    printf(
+        "%s $%02x,$%02x ccr=$%02x: result $%08x ccr $%02x "
+        "(expected $%08x ccr $%02x)\n",
+        name, x, y, ccrIn, result, ccr, expected, expectedCcr);
+  }
+}
+
+// AddBcd()、SubBcd()を直接呼び出して比較する。
+static void testFunctions(Long x, Long y, UWord ccrIn) {
+  UWord ccr = ccrIn, expectedCcr = ccrIn;
+  Long expected = referenceAddBcd(x, y, &expectedCcr);
+  Long result = AddBcd(x, y, &ccr);
+  compare("AddBcd", x, y, ccrIn, result, ccr, expected, expectedCcr);
+
+  ccr = expectedCcr = ccrIn;
+  expected = referenceSubBcd(x, y, &expectedCcr);
+  result = SubBcd(x, y, &ccr);
+  compare("SubBcd", x, y, ccrIn, result, ccr, expected, expectedCcr);
+}
+
+// 命令ハンドラを実行し、d0の値とコンディションコードを返す。
+//   d0にdst、d1にsrcを設定しておく(上位ビットが保存されることも確かめる)。
+static Long execute(InstructionHandler (*decode)(char, char), UWord opcode,
+                    Long dst, Long src, UWord ccrIn, UWord* ccr) {
+  cpu.rd[0] = 0x5a3c9600 | dst;
+  cpu.rd[1] = 0xa5c36900 | src;
+  SetSr(SR_S | ccrIn);
+  InstructionHandler handler = decode((char)(opcode >> 8), (char)opcode);
+  handler((char)(opcode >> 8), (char)opcode);
+  *ccr = GetSr() & CCR_MASK;
+  return cpu.rd[0];
+}
+
+// abcd d1,d0、sbcd d1,d0、nbcd d0を実行して比較する。
+static void testInstructions(Long x, Long y, UWord ccrIn) {
+  const Long upper = 0x5a3c9600;
+  UWord ccr, expectedCcr = ccrIn;
+  Long expected = upper | referenceAddBcd(x, y, &expectedCcr);
+  Long result = execute(decodeLineC, 0xc101, x, y, ccrIn, &ccr);
+  compare("abcd", x, y, ccrIn, result, ccr, expected, expectedCcr);
+
+  expectedCcr = ccrIn;
+  expected = upper | referenceSubBcd(x, y, &expectedCcr);
+  result = execute(decodeLine8, 0x8101, x, y, ccrIn, &ccr);
+  compare("sbcd", x, y, ccrIn, result, ccr, expected, expectedCcr);
+
+  if (y == 0) {
+    expectedCcr = ccrIn;
+    expected = upper | referenceSubBcd(0, x, &expectedCcr);
+    result = execute(decodeLine4, 0x4800, x, 0, ccrIn, &ccr);
+    compare("nbcd", 0, x, ccrIn, result, ccr, expected, expectedCcr);
+  }
+}
+
+int main(void) {
+  for (Long x = 0; x <= 0xff; x += 1) {
+    for (Long y = 0; y <= 0xff; y += 1) {
+      for (UWord ccrIn = 0; ccrIn <= CCR_MASK; ccrIn += 1) {
+        testFunctions(x, y, ccrIn);
+        testInstructions(x, y, ccrIn);
+      }
+    }
+  }
+
+  printf("bcd: %llu cases, %d errors\n", testCount, errorCount);
+  return (errorCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,92 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+// DBcc命令による1命令だけのループのテスト
+//   まとめて実行する場合(通常)と1命令ずつ実行する場合(-trを指定すると
+//   まとめて実行しない)で、ループを実行した結果が実機と同じになるか調べる。
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "librun68.h"
+
+#define PROGRAM "dbcc_test_fill.r"
+
+// ループカウンタを書き込む埋め尽くしループ
+//   move.w d0,(a0)+ / dbra d0,*-2 は3、2、1、0を書き込む。
+//   書き込んだ4ワードの下位4ビットを並べた値を終了コードにする。
+static const unsigned char fillProgram[] = {
+    0x70, 0x03,              // moveq #3,d0
+    0x41, 0xfa, 0x00, 0x1e,  // lea (buf,pc),a0
+    0x30, 0xc0,              // @@: move.w d0,(a0)+
+    0x51, 0xc8, 0xff, 0xfc,  // dbra d0,@b
+    0x41, 0xfa, 0x00, 0x14,  // lea (buf,pc),a0
+    0x32, 0x18,              // move.w (a0)+,d1
+    0xe9, 0x49,              // lsl.w #4,d1
+    0x82, 0x58,              // or.w (a0)+,d1
+    0xe9, 0x49,              // lsl.w #4,d1
+    0x82, 0x58,              // or.w (a0)+,d1
+    0xe9, 0x49,              // lsl.w #4,d1
+    0x82, 0x58,              // or.w (a0)+,d1
+    0x3f, 0x01,              // move.w d1,-(sp)
+    0xff, 0x4c,              // DOS _EXIT2
+    0x00, 0x00, 0x00, 0x00,  // buf: .ds.w 4
+    0x00, 0x00, 0x00, 0x00,
+};
+#define FILL_EXPECTED 0x3210
+
+static int errorCount;
+
+static int run(Run68Machine* machine, int argc, char* argv[]) {
+  int exitCode = Run68Execute(machine, argc, argv);
+  fflush(stdout);
+  return exitCode;
+}
+
+static void check(const char* name, int exitCode, int expected) {
+  if (exitCode == expected) return;
+  printf("%s: exit code $%04x, expected $%04x\n", name, exitCode, expected);
+  errorCount += 1;
+}
+
+int main(void) {
+  FILE* fp = fopen(PROGRAM, "wb");
+  if (!fp || fwrite(fillProgram, sizeof(fillProgram), 1, fp) != 1 ||
+      fclose(fp) != 0) {
+    printf("dbcc: cannot write %s\n", PROGRAM);
+    return EXIT_FAILURE;
+  }
+
+  Run68Machine* machine = Run68CreateMachine();
+  if (!machine) {
+    printf("dbcc: cannot create a machine\n");
+    return EXIT_FAILURE;
+  }
+
+  char* fast[] = {"run68", PROGRAM, NULL};
+  check("fill (fast)", run(machine, 2, fast), FILL_EXPECTED);
+
+  char* slow[] = {"run68", "-tr", "00fffffe", PROGRAM, NULL};
+  check("fill (step)", run(machine, 4, slow), FILL_EXPECTED);
+
+  Run68DestroyMachine(machine);
+  remove(PROGRAM);
+
+  printf("dbcc: %d errors\n", errorCount);
+  return (errorCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,187 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+// マシンを別のスレッドで続けて実行するテスト
+//   2回目以降の実行では保存しておいたメモリの状態に戻すだけで
+//   Human68kを初期化し直さないので、ホスト側の状態(例外ベクタの初期値、
+//   FCBのバッファ)も実行するスレッドに設定し直されているか調べる。
+//   1つのマシンを別々のスレッドで実行する場合と、2つのマシンを
+//   1つのスレッドで交互に実行する場合について、trap #0とDOS _GETFCBの
+//   結果が最初の実行と同じになることを確かめる。
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "librun68.h"
+
+#define TRAP_PROGRAM "machine_test_trap.r"
+#define FCB_PROGRAM "machine_test_fcb.r"
+#define OUTPUT_FILE "machine_test_output.txt"
+#define INPUT_FILE "machine_test_input.txt"
+#define TRAP_MESSAGE "trap #0命令を実行しました"
+
+// trap #0を実行する(実行時エラーになる)
+static const unsigned char trapProgram[] = {
+    0x4e, 0x40,  // trap #0
+    0xff, 0x00,  // DOS _EXIT
+};
+
+// 標準出力のFCBのアドレスを終了コードにする
+static const unsigned char fcbProgram[] = {
+    0x3f, 0x3c, 0x00, 0x01,  // move.w #1,-(sp)
+    0xff, 0x7c,              // DOS _GETFCB
+    0x3e, 0x80,              // move.w d0,(sp)
+    0xff, 0x4c,              // DOS _EXIT2
+};
+
+static int errorCount;
+
+typedef struct {
+  Run68Machine* machine;
+  const char* program;
+  int exitCode;
+} Job;
+
+static bool writeFile(const char* path, const void* data, size_t size) {
+  FILE* fp = fopen(path, "wb");
+  if (!fp) return false;
+  bool ok = fwrite(data, 1, size, fp) == size;
+  return (fclose(fp) == 0) && ok;
+}
+
+static void* runJob(void* arg) {
+  Job* job = arg;
+  char* argv[] = {"run68", (char*)job->program, NULL};
+  job->exitCode = Run68Execute(job->machine, 2, argv);
+  return NULL;
+}
+
+// 新しいスレッドでプログラムを実行する。
+//   実行中の標準入出力はファイルに付け替え、出力を*outputに読み込む。
+//   実行時エラーで起動するデバッガには入力ファイルからquitを与える。
+static int runOnThread(Run68Machine* machine, const char* program,
+                       char* output, size_t outputSize) {
+  Job job = {machine, program, -1};
+
+  fflush(stdout);
+  fflush(stderr);
+  int savedIn = dup(STDIN_FILENO);
+  int savedOut = dup(STDOUT_FILENO);
+  int savedErr = dup(STDERR_FILENO);
+  int in = open(INPUT_FILE, O_RDONLY);
+  int out = open(OUTPUT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  dup2(in, STDIN_FILENO);
+  dup2(out, STDOUT_FILENO);
+  dup2(out, STDERR_FILENO);
+  close(in);
+  close(out);
+
+  pthread_t thread;
+  bool started = pthread_create(&thread, NULL, runJob, &job) == 0;
+  if (started) pthread_join(thread, NULL);
+
+  fflush(stdout);
+  fflush(stderr);
+  dup2(savedIn, STDIN_FILENO);
+  dup2(savedOut, STDOUT_FILENO);
+  dup2(savedErr, STDERR_FILENO);
+  close(savedIn);
+  close(savedOut);
+  close(savedErr);
+  clearerr(stdin);
+
+  output[0] = '\0';
+  FILE* fp = fopen(OUTPUT_FILE, "r");
+  if (fp) {
+    size_t n = fread(output, 1, outputSize - 1, fp);
+    output[n] = '\0';
+    fclose(fp);
+  }
+
+  if (!started) {
+    printf("pthread_create() failed\n");
+    errorCount += 1;
+  }
+  return job.exitCode;
+}
+
+// trap #0とDOS _GETFCBを実行し、結果を調べる。
+static void check(const char* name, Run68Machine* machine, int expectedFcb) {
+  static char output[4096];
+
+  runOnThread(machine, TRAP_PROGRAM, output, sizeof(output));
+  if (strstr(output, TRAP_MESSAGE) == NULL) {
+    printf("%s: trap #0: unexpected output\n%s\n", name, output);
+    errorCount += 1;
+  }
+
+  int fcb = runOnThread(machine, FCB_PROGRAM, output, sizeof(output));
+  if (fcb != expectedFcb) {
+    printf("%s: DOS _GETFCB: exit code %d, expected %d\n", name, fcb,
+           expectedFcb);
+    errorCount += 1;
+  }
+}
+
+int main(void) {
+  if (!writeFile(TRAP_PROGRAM, trapProgram, sizeof(trapProgram)) ||
+      !writeFile(FCB_PROGRAM, fcbProgram, sizeof(fcbProgram)) ||
+      !writeFile(INPUT_FILE, "quit\n", 5)) {
+    printf("machine: cannot write test files\n");
+    return EXIT_FAILURE;
+  }
+
+  Run68Machine* a = Run68CreateMachine();
+  Run68Machine* b = Run68CreateMachine();
+  if (!a || !b) {
+    printf("machine: cannot create machines\n");
+    return EXIT_FAILURE;
+  }
+
+  // 最初の実行はHuman68kを初期化するので、その結果を期待値にする
+  static char output[4096];
+  int expectedFcb = runOnThread(a, FCB_PROGRAM, output, sizeof(output));
+  if (expectedFcb == 0) {
+    printf("machine: DOS _GETFCB returned 0\n");
+    errorCount += 1;
+  }
+
+  // 同じマシンを別々のスレッドで実行する
+  for (int i = 0; i < 3; i += 1) check("thread", a, expectedFcb);
+
+  // 2つのマシンを交互に実行する
+  for (int i = 0; i < 3; i += 1) {
+    check("alternate(b)", b, expectedFcb);
+    check("alternate(a)", a, expectedFcb);
+  }
+
+  Run68DestroyMachine(b);
+  Run68DestroyMachine(a);
+  remove(TRAP_PROGRAM);
+  remove(FCB_PROGRAM);
+  remove(INPUT_FILE);
+  remove(OUTPUT_FILE);
+
+  printf("machine: %d errors\n", errorCount);
+  return (errorCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
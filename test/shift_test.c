@@ -0,0 +1,193 @@
+// run68x - Human68k CUI Emulator based on run68
+// Copyright (C) 2025 TcbnErik
+//
+// This program is free software; you can redistribute it and /or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110 - 1301 USA.
+
+
+// シフト・ローテート命令(Eライン)の等価性テスト
+//   データレジスタを対象とする形式の命令ハンドラを実行し、
+//   MC68000のマニュアルの定義どおり1ビットずつ処理する参照実装と
+//   結果およびX、N、Z、V、Cを比較する。
+//   バイト、ワードは全ての値、ロングワードは境界値と擬似乱数の値について、
+//   回数0～63、実行前のXが0と1の組み合わせを全て調べる。
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "run68.h"
+
+// 命令コードのビット配置と同じ値
+enum { SHIFT_AS, SHIFT_LS, SHIFT_ROX, SHIFT_RO };
+
+static const char* const names[2][4] = {
+    {"asr", "lsr", "roxr", "ror"},
+    {"asl", "lsl", "roxl", "rol"},
+};
+
+#define DATA_REG 0
+#define COUNT_REG 1
+#define MAX_ERRORS 20
+
+static unsigned long long testCount;
+static int errorCount;
+
+// 1ビットずつシフト・ローテートする参照実装の状態
+//   回数を1つずつ増やしながら調べるので、1ビット分ずつ進める。
+typedef struct {
+  int type;
+  bool left;
+  ULong msb;
+  ULong mask;
+
+  ULong value;
+  UWord x;
+  bool c;
+  bool overflow;
+} ReferenceShift;
+
+static void initReference(ReferenceShift* ref, int type, bool left, int size,
+                          ULong value, UWord ccrIn) {
+  ref->type = type;
+  ref->left = left;
+  ref->msb = (ULong)1 << ((8 << size) - 1);
+  ref->mask = ref->msb | (ref->msb - 1);
+  ref->value = value & ref->mask;
+  ref->x = ccrIn & CCR_X;
+  ref->c = (type == SHIFT_ROX) && ref->x;  // 回数が0ならroxl、roxrはC=X
+  ref->overflow = false;
+}
+
+// 1ビットだけシフト・ローテートする。
+static void stepReference(ReferenceShift* ref) {
+  const ULong msb = ref->msb;
+  ULong v = ref->value;
+  bool out = ref->left ? (v & msb) != 0 : (v & 1) != 0;
+  ULong in;
+
+  switch (ref->type) {
+    default:  // SHIFT_AS, SHIFT_LS
+      in = (ref->type == SHIFT_AS && !ref->left) ? (v & msb) : 0;
+      break;
+    case SHIFT_ROX:
+      in = ref->x ? (ref->left ? 1 : msb) : 0;
+      break;
+    case SHIFT_RO:
+      in = out ? (ref->left ? 1 : msb) : 0;
+      break;
+  }
+  ULong next = ((ref->left ? (v << 1) : (v >> 1)) & ref->mask) | in;
+
+  // asl: 最上位ビットが一度でも変化したらV=1
+  if (ref->type == SHIFT_AS && ref->left && ((v ^ next) & msb)) {
+    ref->overflow = true;
+  }
+
+  ref->value = next;
+  ref->c = out;
+  if (ref->type != SHIFT_RO) ref->x = out ? CCR_X : 0;
+}
+
+static UWord referenceCcr(const ReferenceShift* ref) {
+  return ref->x | ((ref->value & ref->msb) ? CCR_N : 0) |
+         ((ref->value == 0) ? CCR_Z : 0) | (ref->overflow ? CCR_V : 0) |
+         (ref->c ? CCR_C : 0);
+}
+
+// 命令を1つ実行して参照実装と比較する。
+static void testOne(UWord opcode, const ReferenceShift* ref, int size,
+                    ULong value, int count, ULong countReg, UWord ccrIn) {
+  // 対象外の上位ビットが保存されることも確かめる
+  const ULong mask = ref->mask;
+  ULong regIn = (value & mask) | (0xa5c3e187 & ~mask);
+  ULong expected = ref->value | (regIn & ~mask);
+  UWord expectedCcr = referenceCcr(ref);
+
+  cpu.rd[DATA_REG] = regIn;
+  cpu.rd[COUNT_REG] = countReg;
+  SetSr(SR_S | ccrIn);
+  InstructionHandler handler = decodeLineE((char)(opcode >> 8), (char)opcode);
+  handler((char)(opcode >> 8), (char)opcode);
+  ULong result = cpu.rd[DATA_REG];
+  UWord ccr = GetSr() & CCR_MASK;
+
+  testCount += 1;
+  if (result == expected && ccr == expectedCcr) return;
+
+  errorCount += 1;
+  if (errorCount <= MAX_ERRORS) {
+    printf(
+        "%s.%c d0=$%08x count=%d ccr=$%02x: "
+        "result $%08x ccr $%02x (expected $%08x ccr $%02x)\n",
+        names[ref->left][ref->type], size_char[size], regIn, count, ccrIn,
+        result, ccr, expected, expectedCcr);
+  }
+}
+
+// 1つの値について回数0～63を調べる。
+//   回数はデータレジスタで指定する形式と、1～8なら即値の形式(命令コード上の
+//   0は8)でも調べる。
+static void testCounts(int type, bool left, int size, ULong value,
+                       UWord ccrIn) {
+  const UWord base = 0xe000 | (left << 8) | (size << 6) | (type << 3) |
+                     DATA_REG;
+  ReferenceShift ref;
+  initReference(&ref, type, left, size, value, ccrIn);
+
+  for (int count = 0; count < 64; count += 1) {
+    // 回数はレジスタの下位6ビットだけが有効
+    ULong countReg = (ULong)count | ((value & 3) << 6) | (value << 16);
+    testOne(base | (COUNT_REG << 9) | 0x20, &ref, size, value, count,
+            countReg, ccrIn);
+
+    if (1 <= count && count <= 8) {
+      testOne(base | ((count & 7) << 9), &ref, size, value, count, 0, ccrIn);
+    }
+    stepReference(&ref);
+  }
+}
+
+static void testValue(int size, ULong value) {
+  for (int left = 0; left < 2; left += 1) {
+    for (int type = SHIFT_AS; type <= SHIFT_RO; type += 1) {
+      // X以外のフラグは結果で置き換えられることも確かめる
+      UWord stale = (value & 1) ? (CCR_N | CCR_Z | CCR_V | CCR_C) : 0;
+      testCounts(type, left, size, value, stale);
+      testCounts(type, left, size, value, stale | CCR_X);
+    }
+  }
+}
+
+int main(void) {
+  for (ULong v = 0; v <= 0xff; v += 1) testValue(S_BYTE, v);
+  for (ULong v = 0; v <= 0xffff; v += 1) testValue(S_WORD, v);
+
+  static const ULong longValues[] = {
+      0x00000000, 0x00000001, 0x7fffffff, 0x80000000, 0x80000001,
+      0xffffffff, 0xfffffffe, 0x40000000, 0xc0000000, 0x55555555,
+      0xaaaaaaaa, 0x0000ffff, 0xffff0000, 0x12345678, 0x87654321,
+  };
+  for (size_t i = 0; i < sizeof(longValues) / sizeof(longValues[0]); i += 1) {
+    testValue(S_LONG, longValues[i]);
+  }
+  ULong seed = 1;
+  for (int i = 0; i < 20000; i += 1) {
+    seed = seed * 1103515245 + 12345;
+    testValue(S_LONG, seed ^ (seed << 13));
+  }
+
+  printf("shift: %llu cases, %d errors\n", testCount, errorCount);
+  return (errorCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}